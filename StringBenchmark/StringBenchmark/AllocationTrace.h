@@ -0,0 +1,477 @@
+#pragma once
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// String Allocation Traces: compact binary format, recorder and synthetic generator
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <crtdbg.h>     // _ASSERTE
+#include <algorithm>    // std::min
+#include <atomic>       // std::atomic
+#include <cmath>        // std::pow
+#include <mutex>        // std::mutex
+#include <random>       // std::mt19937, distributions
+#include <stdexcept>    // std::runtime_error, std::length_error
+#include <unordered_map>    // std::unordered_map
+#include <vector>       // std::vector
+
+#include <atlbase.h>    // CHandle
+
+#include <Windows.h>    // Windows Platform SDK
+
+#include "StringPool.h" // Custom string pool allocator
+
+
+//---------------------------------------------------------------------------------------
+// Trace Format
+//
+// A trace file is a TraceFileHeader followed by recordCount TraceRecords, in the order
+// the operations happened.
+//
+// Strings are grouped in *lifetimes*: sets of strings released all together (e.g. the
+// strings of a request, or of a pool). A lifetime id is unique in the trace, and all the
+// operations on a lifetime happen on the same thread; so, the records of each thread can
+// be replayed on a thread of their own, deterministically.
+//
+// Only lengths are recorded, never the string contents.
+//---------------------------------------------------------------------------------------
+
+enum class TraceOp : BYTE
+{
+    Alloc   = 1,    // Allocate a string of cch WCHARs in the lifetime
+    Release = 2     // Release all the strings of the lifetime
+};
+
+struct TraceRecord
+{
+    UINT32  lifetimeId;
+    UINT32  cch;        // Alloc: string length in WCHARs, excluding the terminating NUL
+    UINT16  thread;     // Small index of the thread that did the operation
+    BYTE    op;         // TraceOp
+    BYTE    reserved;   // Zero
+};
+
+static_assert(sizeof(TraceRecord) == 12, "Trace records must stay compact.");
+
+struct TraceFileHeader
+{
+    DWORD       dwMagic;        // kTraceMagic
+    DWORD       dwVersion;      // kTraceVersion
+    ULONGLONG   recordCount;
+};
+
+constexpr DWORD kTraceMagic   = 0x43525453;   // "STRC"
+constexpr DWORD kTraceVersion = 1;
+
+// Thread indices are UINT16: a trace has at most this many threads, indexed from 0
+constexpr UINT32 kMaxTraceThreads = 0xFFFF;
+
+
+// Write a trace file. Throw std::runtime_error on failure.
+inline void SaveAllocationTrace(const wchar_t* path, const std::vector<TraceRecord>& records);
+
+// Read a trace file. Throw std::runtime_error on failure, or if the file is not a valid trace.
+inline std::vector<TraceRecord> LoadAllocationTrace(const wchar_t* path);
+
+
+//---------------------------------------------------------------------------------------
+// Allocation Trace Recorder
+//
+// Thread-safe sink for the records of a trace. Threads are given small indices in the
+// order they record their first operation; recording from more than kMaxTraceThreads
+// threads throws std::length_error rather than reusing an index.
+//---------------------------------------------------------------------------------------
+class CAllocationTraceRecorder
+{
+public:
+    CAllocationTraceRecorder() = default;
+
+    // Return a new lifetime id, unique in this recorder
+    UINT32 NewLifetimeId() noexcept;
+
+    // Record the allocation of a string of cch WCHARs (excluding the NUL) in a lifetime
+    void RecordAlloc(UINT32 lifetimeId, SIZE_T cch);
+
+    // Record the release of all the strings of a lifetime
+    void RecordRelease(UINT32 lifetimeId);
+
+    // Return a copy of the records so far
+    std::vector<TraceRecord> GetRecords() const;
+
+    // Write the records so far to a trace file. Throw std::runtime_error on failure.
+    void Save(const wchar_t* path) const;
+
+
+    //
+    // Ban Copy
+    //
+private:
+    CAllocationTraceRecorder(const CAllocationTraceRecorder&) = delete;
+    CAllocationTraceRecorder& operator=(const CAllocationTraceRecorder&) = delete;
+
+
+    //
+    // IMPLEMENTATION
+    //
+private:
+    mutable std::mutex                  m_lock;
+    std::vector<TraceRecord>            m_records;
+    std::unordered_map<DWORD, UINT16>   m_threadIndices;    // Thread id -> index
+    std::atomic<UINT32>                 m_nextLifetimeId{ 1 };
+
+    void Record(TraceOp op, UINT32 lifetimeId, UINT32 cch);
+};
+
+
+//---------------------------------------------------------------------------------------
+// Recording String Pool
+//
+// Drop-in replacement for CStringPoolAllocator that records its allocations: the pool is
+// one lifetime, released when the pool is destroyed. Swap it in to capture a trace of
+// real traffic (as /bench:server /record-trace does with its request-scoped pools).
+//---------------------------------------------------------------------------------------
+class CRecordingStringPool
+{
+public:
+    explicit CRecordingStringPool(CAllocationTraceRecorder& recorder) noexcept;
+
+    // Pass the minimum chunk size of the underlying pool, as to CStringPoolAllocator
+    CRecordingStringPool(CAllocationTraceRecorder& recorder, SIZE_T cbMinChunkSize) noexcept;
+    ~CRecordingStringPool() noexcept;
+
+    PWSTR AllocString(const WCHAR* pchBegin, const WCHAR* pchEnd);
+    PWSTR AllocString(PCWSTR pszSource);
+
+
+    //
+    // Ban Copy
+    //
+private:
+    CRecordingStringPool(const CRecordingStringPool&) = delete;
+    CRecordingStringPool& operator=(const CRecordingStringPool&) = delete;
+
+
+    //
+    // IMPLEMENTATION
+    //
+private:
+    CAllocationTraceRecorder&   m_recorder;
+    CStringPoolAllocator        m_pool;
+    UINT32                      m_lifetimeId;
+};
+
+
+//---------------------------------------------------------------------------------------
+// Generate a synthetic trace: each thread runs request-like lifetimes of 8-64 strings
+// with log-uniform lengths, up to 8 of them overlapping; the threads' records are
+// interleaved at random. The same arguments always produce the same trace.
+//---------------------------------------------------------------------------------------
+inline std::vector<TraceRecord> GenerateSyntheticTrace(unsigned threadCount, unsigned lifetimesPerThread,
+                                                       unsigned seed);
+
+
+//=======================================================================================
+//                          Inline Method Implementations
+//=======================================================================================
+
+namespace AllocationTraceDetail
+{
+
+// ReadFile/WriteFile take 32-bit sizes: split bigger transfers
+constexpr DWORD kcbMaxTransfer = 1024 * 1024 * 1024;
+
+inline void WriteAll(HANDLE hFile, const void* pv, ULONGLONG cb)
+{
+    const BYTE* pb = static_cast<const BYTE*>(pv);
+    while (cb > 0)
+    {
+        const DWORD cbChunk = static_cast<DWORD>((std::min)(cb, static_cast<ULONGLONG>(kcbMaxTransfer)));
+        DWORD cbWritten = 0;
+        if (!WriteFile(hFile, pb, cbChunk, &cbWritten, nullptr) || cbWritten != cbChunk)
+        {
+            throw std::runtime_error("Can't write the allocation trace file.");
+        }
+        pb += cbChunk;
+        cb -= cbChunk;
+    }
+}
+
+inline void ReadAll(HANDLE hFile, void* pv, ULONGLONG cb)
+{
+    BYTE* pb = static_cast<BYTE*>(pv);
+    while (cb > 0)
+    {
+        const DWORD cbChunk = static_cast<DWORD>((std::min)(cb, static_cast<ULONGLONG>(kcbMaxTransfer)));
+        DWORD cbRead = 0;
+        if (!ReadFile(hFile, pb, cbChunk, &cbRead, nullptr) || cbRead != cbChunk)
+        {
+            throw std::runtime_error("Can't read the allocation trace file (truncated?).");
+        }
+        pb += cbChunk;
+        cb -= cbChunk;
+    }
+}
+
+} // namespace AllocationTraceDetail
+
+
+inline void SaveAllocationTrace(const wchar_t* path, const std::vector<TraceRecord>& records)
+{
+    CHandle file(CreateFileW(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        file.Detach();
+        throw std::runtime_error("Can't create the allocation trace file.");
+    }
+
+    TraceFileHeader header = {};
+    header.dwMagic     = kTraceMagic;
+    header.dwVersion   = kTraceVersion;
+    header.recordCount = records.size();
+
+    AllocationTraceDetail::WriteAll(file, &header, sizeof(header));
+    AllocationTraceDetail::WriteAll(file, records.data(), records.size() * sizeof(TraceRecord));
+}
+
+
+inline std::vector<TraceRecord> LoadAllocationTrace(const wchar_t* path)
+{
+    CHandle file(CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        file.Detach();
+        throw std::runtime_error("Can't open the allocation trace file.");
+    }
+
+    LARGE_INTEGER cbFile = {};
+    if (!GetFileSizeEx(file, &cbFile))
+    {
+        throw std::runtime_error("Can't get the size of the allocation trace file.");
+    }
+
+    TraceFileHeader header = {};
+    AllocationTraceDetail::ReadAll(file, &header, sizeof(header));
+    if (header.dwMagic != kTraceMagic || header.dwVersion != kTraceVersion)
+    {
+        throw std::runtime_error("Not an allocation trace file, or unsupported version.");
+    }
+
+    // Check the record count against the file size before allocating the records
+    const ULONGLONG cbRecords = static_cast<ULONGLONG>(cbFile.QuadPart) - sizeof(header);
+    if (cbRecords % sizeof(TraceRecord) != 0 || header.recordCount != cbRecords / sizeof(TraceRecord))
+    {
+        throw std::runtime_error("The allocation trace file is truncated or corrupt.");
+    }
+
+    std::vector<TraceRecord> records(static_cast<size_t>(header.recordCount));
+    AllocationTraceDetail::ReadAll(file, records.data(), records.size() * sizeof(TraceRecord));
+
+    for (const TraceRecord& record : records)
+    {
+        if (record.op != static_cast<BYTE>(TraceOp::Alloc) && record.op != static_cast<BYTE>(TraceOp::Release))
+        {
+            throw std::runtime_error("Invalid operation in the allocation trace file.");
+        }
+
+        // A recorder that wrapped the thread indices would have merged threads
+        if (record.thread >= kMaxTraceThreads)
+        {
+            throw std::runtime_error("Too many threads in the allocation trace file.");
+        }
+    }
+
+    return records;
+}
+
+
+inline UINT32 CAllocationTraceRecorder::NewLifetimeId() noexcept
+{
+    return m_nextLifetimeId.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+inline void CAllocationTraceRecorder::RecordAlloc(UINT32 lifetimeId, SIZE_T cch)
+{
+    _ASSERTE(cch <= MAXUINT32);
+    Record(TraceOp::Alloc, lifetimeId, static_cast<UINT32>(cch));
+}
+
+
+inline void CAllocationTraceRecorder::RecordRelease(UINT32 lifetimeId)
+{
+    Record(TraceOp::Release, lifetimeId, 0);
+}
+
+
+inline std::vector<TraceRecord> CAllocationTraceRecorder::GetRecords() const
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    return m_records;
+}
+
+
+inline void CAllocationTraceRecorder::Save(const wchar_t* path) const
+{
+    SaveAllocationTrace(path, GetRecords());
+}
+
+
+inline void CAllocationTraceRecorder::Record(TraceOp op, UINT32 lifetimeId, UINT32 cch)
+{
+    const DWORD threadId = GetCurrentThreadId();
+
+    std::lock_guard<std::mutex> guard(m_lock);
+
+    // New threads get the next index, which must fit in the record
+    auto it = m_threadIndices.find(threadId);
+    if (it == m_threadIndices.end())
+    {
+        if (m_threadIndices.size() >= kMaxTraceThreads)
+        {
+            throw std::length_error("CAllocationTraceRecorder: too many recording threads.");
+        }
+        it = m_threadIndices.emplace(threadId, static_cast<UINT16>(m_threadIndices.size())).first;
+    }
+
+    TraceRecord record = {};
+    record.lifetimeId = lifetimeId;
+    record.cch        = cch;
+    record.thread     = it->second;
+    record.op         = static_cast<BYTE>(op);
+    m_records.push_back(record);
+}
+
+
+inline CRecordingStringPool::CRecordingStringPool(CAllocationTraceRecorder& recorder) noexcept
+    : m_recorder(recorder)
+    , m_lifetimeId(recorder.NewLifetimeId())
+{
+}
+
+
+inline CRecordingStringPool::CRecordingStringPool(CAllocationTraceRecorder& recorder, SIZE_T cbMinChunkSize) noexcept
+    : m_recorder(recorder)
+    , m_pool(cbMinChunkSize)
+    , m_lifetimeId(recorder.NewLifetimeId())
+{
+}
+
+
+inline CRecordingStringPool::~CRecordingStringPool() noexcept
+{
+    try
+    {
+        m_recorder.RecordRelease(m_lifetimeId);
+    }
+    catch (...)
+    {
+        // Out of memory while recording: the replayer releases the lifetimes
+        // still alive at the end of the trace anyway
+    }
+}
+
+
+inline PWSTR CRecordingStringPool::AllocString(const WCHAR* pchBegin, const WCHAR* pchEnd)
+{
+    const PWSTR psz = m_pool.AllocString(pchBegin, pchEnd);
+    m_recorder.RecordAlloc(m_lifetimeId, pchEnd - pchBegin);
+    return psz;
+}
+
+
+inline PWSTR CRecordingStringPool::AllocString(PCWSTR pszSource)
+{
+    _ASSERTE(pszSource != nullptr);
+    return AllocString(pszSource, pszSource + wcslen(pszSource));
+}
+
+
+inline std::vector<TraceRecord> GenerateSyntheticTrace(unsigned threadCount, unsigned lifetimesPerThread,
+                                                       unsigned seed)
+{
+    _ASSERTE(threadCount <= kMaxTraceThreads);
+
+    constexpr size_t kMaxOpenLifetimes = 8;
+    constexpr double kMinLength = 4.0;
+    constexpr double kMaxLength = 256.0;
+
+    std::mt19937 prng(seed);
+    std::uniform_int_distribution<unsigned> stringCount(8, 64);
+    std::uniform_real_distribution<double> logLength(0.0, 1.0);
+
+    // Per-thread record sequences
+    std::vector<std::vector<TraceRecord>> threadRecords(threadCount);
+    UINT32 nextLifetimeId = 1;
+
+    for (unsigned thread = 0; thread < threadCount; ++thread)
+    {
+        struct OpenLifetime
+        {
+            UINT32      id;
+            unsigned    remaining;  // Strings still to be allocated
+        };
+        std::vector<OpenLifetime> open;
+        unsigned started = 0;
+
+        auto emit = [&](TraceOp op, UINT32 lifetimeId, UINT32 cch)
+        {
+            TraceRecord record = {};
+            record.lifetimeId = lifetimeId;
+            record.cch        = cch;
+            record.thread     = static_cast<UINT16>(thread);
+            record.op         = static_cast<BYTE>(op);
+            threadRecords[thread].push_back(record);
+        };
+
+        while (started < lifetimesPerThread || !open.empty())
+        {
+            // Keep a few lifetimes overlapping
+            if (open.size() < kMaxOpenLifetimes && started < lifetimesPerThread)
+            {
+                open.push_back(OpenLifetime{ nextLifetimeId++, stringCount(prng) });
+                ++started;
+            }
+
+            // Allocate a string in one of them, and release it once complete
+            const size_t i = prng() % open.size();
+            const double length = kMinLength * std::pow(kMaxLength / kMinLength, logLength(prng));
+            emit(TraceOp::Alloc, open[i].id, static_cast<UINT32>(length));
+
+            if (--open[i].remaining == 0)
+            {
+                emit(TraceOp::Release, open[i].id, 0);
+                open[i] = open.back();
+                open.pop_back();
+            }
+        }
+    }
+
+    // Interleave the threads at random, keeping the order of each thread
+    std::vector<TraceRecord> records;
+    std::vector<size_t> next(threadCount);
+    std::vector<unsigned> pending;
+    size_t totalCount = 0;
+    for (unsigned thread = 0; thread < threadCount; ++thread)
+    {
+        totalCount += threadRecords[thread].size();
+        if (!threadRecords[thread].empty())
+        {
+            pending.push_back(thread);
+        }
+    }
+
+    records.reserve(totalCount);
+    while (!pending.empty())
+    {
+        const size_t i = prng() % pending.size();
+        const unsigned thread = pending[i];
+        records.push_back(threadRecords[thread][next[thread]++]);
+        if (next[thread] == threadRecords[thread].size())
+        {
+            pending[i] = pending.back();
+            pending.pop_back();
+        }
+    }
+
+    return records;
+}
@@ -0,0 +1,257 @@
+#pragma once
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Common helpers shared by the benchmarks
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+//
+// Define TEST_TINY_STRINGS to run the benchmark with tiny strings
+// (STL friendly thanks to SSO).
+//
+// Uncomment the following line for testing with tiny strings:
+//#define TEST_TINY_STRINGS     1
+//
+
+
+#include <algorithm>    // std::shuffle, std::nth_element
+#include <iostream>     // std::cout
+#include <random>       // std::mt19937
+#include <string>       // std::wstring
+#include <vector>       // std::vector
+
+#include <wchar.h>      // wcslen, wcsncmp, wcstoull, wcstod
+
+#include <windows.h>    // Windows SDK API
+#include <psapi.h>      // GetProcessMemoryInfo
+
+#include "TimelineTrace.h"  // Timeline tracer
+
+
+//---------------------------------------------------------------------------------------
+// Performance Counter Helpers
+//---------------------------------------------------------------------------------------
+
+inline long long PerfCounter() noexcept
+{
+    LARGE_INTEGER li;
+    QueryPerformanceCounter(&li);
+    return li.QuadPart;
+}
+
+inline long long PerfFrequency() noexcept
+{
+    LARGE_INTEGER li;
+    QueryPerformanceFrequency(&li);
+    return li.QuadPart;
+}
+
+// Also records the phase on the timeline trace, when enabled
+inline void PrintTime(const long long start, const long long finish, const char* const message)
+{
+    GetTimelineTracer().RecordComplete(message, start, finish);
+    std::cout << message << ": " << (finish - start) * 1000.0 / PerfFrequency() << " ms" << std::endl;
+}
+
+// Median of performance counter durations, in ms (ticks must not be empty)
+inline double MedianMs(std::vector<long long> ticks)
+{
+    std::nth_element(ticks.begin(), ticks.begin() + ticks.size() / 2, ticks.end());
+    return ticks[ticks.size() / 2] * 1000.0 / PerfFrequency();
+}
+
+
+//---------------------------------------------------------------------------------------
+// Process Memory Helpers
+//---------------------------------------------------------------------------------------
+
+constexpr double kMB = 1024.0 * 1024.0;
+
+struct ProcessMemory
+{
+    ULONGLONG   cbWorkingSet;   // Resident (RSS)
+    ULONGLONG   cbPrivate;      // Committed private bytes
+};
+
+inline ProcessMemory GetProcessMemory() noexcept
+{
+    PROCESS_MEMORY_COUNTERS_EX pmc = {};
+    pmc.cb = sizeof(pmc);
+    GetProcessMemoryInfo(GetCurrentProcess(),
+                         reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&pmc),
+                         sizeof(pmc));
+
+    ProcessMemory memory;
+    memory.cbWorkingSet = pmc.WorkingSetSize;
+    memory.cbPrivate    = pmc.PrivateUsage;
+    return memory;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Build a vector of shuffled strings that will be used for the benchmarks
+//---------------------------------------------------------------------------------------
+
+#ifdef _DEBUG
+// Just a few strings in *slow running* debug builds
+constexpr int kStringRepeatCount = 10;
+#else
+// Lots of strings in release builds
+constexpr int kStringRepeatCount = 400 * 1000; // 400K
+#endif // _DEBUG
+
+// The lines the strings are made of
+constexpr const wchar_t* kLoremLines[] =
+{
+    L"Lorem ipsum dolor sit amet, consectetuer adipiscing elit.",
+    L"Maecenas porttitor congue massa. Fusce posuere, magna sed",
+    L"pulvinar ultricies, purus lectus malesuada libero,",
+    L"sit amet commodo magna eros quis urna.",
+    L"Nunc viverra imperdiet enim. Fusce est. Vivamus a tellus.",
+    L"Pellentesque habitant morbi tristique senectus et netus et",
+    L"malesuada fames ac turpis egestas. Proin pharetra nonummy pede.",
+    L"Mauris et orci. [*** add more chars to prevent SSO ***]"
+};
+
+constexpr size_t kLoremLineCount = sizeof(kLoremLines) / sizeof(kLoremLines[0]);
+
+// Return the i-th string, before shuffling: the lines repeated, each numbered with its
+// repetition
+inline std::wstring BuildSourceString(size_t i)
+{
+#ifdef TEST_TINY_STRINGS
+    // Tiny strings
+    return L"#" + std::to_wstring(i / kLoremLineCount);
+#else
+    return kLoremLines[i % kLoremLineCount] + (L" (#" + std::to_wstring(i / kLoremLineCount) + L")");
+#endif
+}
+
+inline std::vector<std::wstring> BuildShuffledStrings()
+{
+    std::vector<std::wstring> v;
+
+    for (size_t i = 0; i < kStringRepeatCount * kLoremLineCount; ++i)
+    {
+        v.push_back(BuildSourceString(i));
+    }
+
+    std::mt19937 prng(1987);    // 1987 : Amiga 500! :)
+
+    std::shuffle(v.begin(), v.end(), prng);
+
+    return v;
+}
+
+// Return a vector of raw *observing* pointers to the input strings
+inline std::vector<const wchar_t*> BuildStringPointers(const std::vector<std::wstring>& strings)
+{
+    std::vector<const wchar_t*> v;
+    v.reserve(strings.size());
+
+    for (const auto& s : strings)
+    {
+        v.push_back(s.c_str());
+    }
+
+    return v;
+}
+
+
+// Convert an ASCII-only wide string (like a benchmark name) for printing with std::cout
+inline std::string NarrowAscii(const wchar_t* psz)
+{
+    std::string s;
+    for (; *psz != L'\0'; ++psz)
+    {
+        s.push_back(static_cast<char>(*psz));
+    }
+    return s;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Simple command line parser for "/name" and "/name:value" options
+//---------------------------------------------------------------------------------------
+class CCommandLine
+{
+public:
+    CCommandLine(int argc, wchar_t* argv[]) noexcept
+        : m_argc(argc)
+        , m_argv(argv)
+    {
+    }
+
+    // Return the value following "/name:", an empty string for a bare "/name" option,
+    // or nullptr if the option is not present
+    const wchar_t* Find(const wchar_t* name) const noexcept
+    {
+        const size_t cchName = wcslen(name);
+        for (int i = 1; i < m_argc; ++i)
+        {
+            const wchar_t* const arg = m_argv[i];
+            if (wcsncmp(arg, name, cchName) != 0)
+            {
+                continue;
+            }
+
+            if (arg[cchName] == L'\0')
+            {
+                return arg + cchName;
+            }
+
+            if (arg[cchName] == L':')
+            {
+                return arg + cchName + 1;
+            }
+        }
+        return nullptr;
+    }
+
+    bool Has(const wchar_t* name) const noexcept
+    {
+        return Find(name) != nullptr;
+    }
+
+    // Return the numeric value of "/name:value", or defaultValue if not present
+    unsigned long long GetNumber(const wchar_t* name, unsigned long long defaultValue) const noexcept
+    {
+        const wchar_t* const value = Find(name);
+        if (value == nullptr || *value == L'\0')
+        {
+            return defaultValue;
+        }
+        return wcstoull(value, nullptr, 0);
+    }
+
+    // Return the floating-point value of "/name:value", or defaultValue if not present
+    double GetReal(const wchar_t* name, double defaultValue) const noexcept
+    {
+        const wchar_t* const value = Find(name);
+        if (value == nullptr || *value == L'\0')
+        {
+            return defaultValue;
+        }
+        return wcstod(value, nullptr);
+    }
+
+    // Full path of the running executable, e.g. to launch worker processes
+    static std::wstring GetExecutablePath()
+    {
+        std::wstring path(MAX_PATH, L'\0');
+        for (;;)
+        {
+            const DWORD cch = GetModuleFileNameW(nullptr, &path[0], static_cast<DWORD>(path.size()));
+            if (cch < path.size())
+            {
+                path.resize(cch);
+                return path;
+            }
+            path.resize(path.size() * 2);
+        }
+    }
+
+private:
+    int         m_argc;
+    wchar_t**   m_argv;
+};
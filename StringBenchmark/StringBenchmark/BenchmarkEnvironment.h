@@ -0,0 +1,500 @@
+#pragma once
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Benchmark Environment: CPU topology, thread pinning, and a report of the conditions
+// that make results vary from run to run (power, CPU frequency, SMT, background load)
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::min, std::max
+#include <iostream>     // std::ostream
+#include <stdexcept>    // std::runtime_error
+#include <string>       // std::string, std::to_string
+#include <thread>       // std::thread::hardware_concurrency
+#include <vector>       // std::vector
+
+#include <wchar.h>      // wcscmp, wcstoul
+
+#include <Windows.h>    // Windows Platform SDK
+#include <powerbase.h>  // CallNtPowerInformation
+#include <powrprof.h>   // PowerGetActiveScheme
+
+
+//---------------------------------------------------------------------------------------
+// CPU Topology
+//
+// Logical processors grouped by physical core: with SMT (Hyper-Threading) enabled, the
+// logical processors of a core are siblings sharing its execution units and caches.
+// Only the processor group of the process is considered (at most 64 logical processors).
+//---------------------------------------------------------------------------------------
+struct CpuTopology
+{
+    unsigned                logicalCount;   // Logical processors
+    std::vector<ULONG_PTR>  coreMasks;      // Logical processors of each physical core
+
+    // Physical core of the given logical processor, or -1 if unknown
+    int FindCore(unsigned processor) const noexcept
+    {
+        for (size_t core = 0; core < coreMasks.size(); ++core)
+        {
+            if (coreMasks[core] & (static_cast<ULONG_PTR>(1) << processor))
+            {
+                return static_cast<int>(core);
+            }
+        }
+        return -1;
+    }
+};
+
+inline CpuTopology GetCpuTopology()
+{
+    CpuTopology topology = {};
+
+    DWORD cb = 0;
+    GetLogicalProcessorInformation(nullptr, &cb);
+    std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> infos(cb / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+    if (!infos.empty() && GetLogicalProcessorInformation(infos.data(), &cb))
+    {
+        for (const auto& info : infos)
+        {
+            if (info.Relationship == RelationProcessorCore)
+            {
+                topology.coreMasks.push_back(info.ProcessorMask);
+                for (ULONG_PTR mask = info.ProcessorMask; mask != 0; mask &= mask - 1)
+                {
+                    ++topology.logicalCount;
+                }
+            }
+        }
+    }
+
+    // Without topology information, assume one logical processor per core
+    if (topology.coreMasks.empty())
+    {
+        topology.logicalCount = (std::max)(std::thread::hardware_concurrency(), 1u);
+        for (unsigned i = 0; i < topology.logicalCount && i < 8 * sizeof(ULONG_PTR); ++i)
+        {
+            topology.coreMasks.push_back(static_cast<ULONG_PTR>(1) << i);
+        }
+    }
+
+    return topology;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Thread Pinning
+//
+// The benchmark threads can be pinned to a list of logical processors, to stop the
+// scheduler from migrating them (and their warm caches) from core to core.
+// Benchmark thread #i is pinned to the processor #(i % count) of the list: the main
+// thread is #0, and threads started by a benchmark are numbered from 1 (or from 0, when
+// the main thread just waits for them).
+//---------------------------------------------------------------------------------------
+class CThreadPinning
+{
+public:
+    CThreadPinning() noexcept = default;
+
+    // Pin the benchmark threads to the given logical processors (empty to stop pinning)
+    void SetProcessors(const std::vector<unsigned>& processors);
+
+    bool IsEnabled() const noexcept;
+    const std::vector<unsigned>& GetProcessors() const noexcept;
+
+    // Pin the calling thread, as benchmark thread #threadIndex; no-op if not enabled.
+    // Return false if the thread couldn't be pinned.
+    bool PinCurrentThread(unsigned threadIndex) const noexcept;
+
+    // Parse a comma-separated list of logical processors (e.g. "0,2,4");
+    // "cores" selects the first logical processor of each physical core (no SMT siblings).
+    // Throw std::runtime_error on invalid lists.
+    static std::vector<unsigned> ParseProcessors(const wchar_t* list, const CpuTopology& topology);
+
+
+    //
+    // Ban Copy
+    //
+private:
+    CThreadPinning(const CThreadPinning&) = delete;
+    CThreadPinning& operator=(const CThreadPinning&) = delete;
+
+
+    //
+    // IMPLEMENTATION
+    //
+private:
+    std::vector<unsigned>   m_processors;
+};
+
+
+// Process-wide pinning of the benchmark threads, set from the command line (/pin)
+inline CThreadPinning& GetThreadPinning() noexcept
+{
+    static CThreadPinning s_pinning;
+    return s_pinning;
+}
+
+// Pin the calling thread, as benchmark thread #threadIndex (see CThreadPinning)
+inline bool PinBenchmarkThread(unsigned threadIndex) noexcept
+{
+    return GetThreadPinning().PinCurrentThread(threadIndex);
+}
+
+// Default number of benchmark threads: one per pinned processor, if pinning is enabled,
+// or one per logical processor
+inline unsigned GetDefaultThreadCount() noexcept
+{
+    const CThreadPinning& pinning = GetThreadPinning();
+    if (pinning.IsEnabled())
+    {
+        return static_cast<unsigned>(pinning.GetProcessors().size());
+    }
+    return (std::max)(std::thread::hardware_concurrency(), 1u);
+}
+
+
+//---------------------------------------------------------------------------------------
+// Benchmark Environment
+//
+// Snapshot of the conditions that make results vary from run to run, to record along
+// with the results, and to warn about the noisy ones
+//---------------------------------------------------------------------------------------
+struct BenchmarkEnvironment
+{
+    CpuTopology     topology;
+
+    bool            bOnBattery;         // Running on battery power
+    bool            bBatterySaver;      // Battery saver enabled
+    std::string     powerScheme;        // Active power scheme ("governor")
+
+    ULONG           maxMhz;             // Rated (nominal) frequency
+    ULONG           currentMhz;         // Highest current frequency among the processors, when
+                                        // sampled: idle processors run at or below maxMhz
+    ULONG           limitMhz;           // Lowest frequency limit among the processors
+    LONG            frequencyStatus;    // NTSTATUS of the frequency query: 0 on success,
+                                        // otherwise the frequencies above are 0
+
+    double          busyPercent;        // CPU load of the system (mostly other processes)
+    DWORD           priorityClass;      // Priority class of this process
+};
+
+// Take a snapshot of the environment, sampling the system load for sampleMs
+inline BenchmarkEnvironment QueryBenchmarkEnvironment(DWORD sampleMs = 100);
+
+// Print the environment, with a warning for each noisy condition; return the warning count
+inline unsigned PrintBenchmarkEnvironment(std::ostream& os, const BenchmarkEnvironment& environment,
+                                          const CThreadPinning& pinning);
+
+
+//=======================================================================================
+//                          Inline Method Implementations
+//=======================================================================================
+
+inline void CThreadPinning::SetProcessors(const std::vector<unsigned>& processors)
+{
+    m_processors = processors;
+}
+
+
+inline bool CThreadPinning::IsEnabled() const noexcept
+{
+    return !m_processors.empty();
+}
+
+
+inline const std::vector<unsigned>& CThreadPinning::GetProcessors() const noexcept
+{
+    return m_processors;
+}
+
+
+inline bool CThreadPinning::PinCurrentThread(unsigned threadIndex) const noexcept
+{
+    if (m_processors.empty())
+    {
+        return true;
+    }
+
+    const unsigned processor = m_processors[threadIndex % m_processors.size()];
+    return SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << processor) != 0;
+}
+
+
+inline std::vector<unsigned> CThreadPinning::ParseProcessors(const wchar_t* list, const CpuTopology& topology)
+{
+    std::vector<unsigned> processors;
+
+    if (wcscmp(list, L"cores") == 0)
+    {
+        for (ULONG_PTR mask : topology.coreMasks)
+        {
+            unsigned processor = 0;
+            while ((mask & (static_cast<ULONG_PTR>(1) << processor)) == 0)
+            {
+                ++processor;
+            }
+            processors.push_back(processor);
+        }
+        return processors;
+    }
+
+    const wchar_t* pch = list;
+    while (*pch != L'\0')
+    {
+        wchar_t* pchEnd = nullptr;
+        const unsigned long processor = wcstoul(pch, &pchEnd, 10);
+        if (pchEnd == pch || processor >= topology.logicalCount || processor >= 8 * sizeof(ULONG_PTR))
+        {
+            throw std::runtime_error("Invalid processor list: expected \"cores\", or logical processors "
+                                     "in [0, " + std::to_string(topology.logicalCount) + ") separated by commas.");
+        }
+        processors.push_back(static_cast<unsigned>(processor));
+
+        pch = pchEnd;
+        if (*pch == L',')
+        {
+            ++pch;
+        }
+    }
+
+    if (processors.empty())
+    {
+        throw std::runtime_error("Empty processor list.");
+    }
+    return processors;
+}
+
+
+namespace BenchmarkEnvironmentDetail
+{
+
+// Not defined in the SDK headers (see the CallNtPowerInformation documentation)
+struct ProcessorPowerInformation
+{
+    ULONG   Number;
+    ULONG   MaxMhz;
+    ULONG   CurrentMhz;
+    ULONG   MhzLimit;
+    ULONG   MaxIdleState;
+    ULONG   CurrentIdleState;
+};
+
+inline ULONGLONG FileTimeToTicks(const FILETIME& ft) noexcept
+{
+    return (static_cast<ULONGLONG>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+}
+
+inline std::string GetActivePowerSchemeName()
+{
+    // The built-in schemes (GUID_MIN_POWER_SAVINGS etc. in winnt.h)
+    static const GUID kHighPerformance  = { 0x8c5e7fda, 0xe8bf, 0x4a96, { 0x9a, 0x85, 0xa6, 0xe2, 0x3a, 0x8c, 0x63, 0x5c } };
+    static const GUID kBalanced         = { 0x381b4222, 0xf694, 0x41f0, { 0x96, 0x85, 0xff, 0x5b, 0xb2, 0x60, 0xdf, 0x2e } };
+    static const GUID kPowerSaver       = { 0xa1841308, 0x3541, 0x4fab, { 0xbc, 0x81, 0xf7, 0x15, 0x56, 0xf2, 0x0b, 0x4a } };
+    static const GUID kUltimate         = { 0xe9a42b02, 0xd5df, 0x448d, { 0xaa, 0x00, 0x03, 0xf1, 0x47, 0x49, 0xeb, 0x61 } };
+
+    GUID* pScheme = nullptr;
+    if (PowerGetActiveScheme(nullptr, &pScheme) != ERROR_SUCCESS)
+    {
+        return "unknown";
+    }
+
+    const GUID scheme = *pScheme;
+    LocalFree(pScheme);
+
+    if (scheme == kHighPerformance)
+    {
+        return "High performance";
+    }
+    if (scheme == kUltimate)
+    {
+        return "Ultimate performance";
+    }
+    if (scheme == kBalanced)
+    {
+        return "Balanced";
+    }
+    if (scheme == kPowerSaver)
+    {
+        return "Power saver";
+    }
+    return "custom";
+}
+
+} // namespace BenchmarkEnvironmentDetail
+
+
+inline BenchmarkEnvironment QueryBenchmarkEnvironment(DWORD sampleMs)
+{
+    using namespace BenchmarkEnvironmentDetail;
+
+    BenchmarkEnvironment environment = {};
+    environment.topology = GetCpuTopology();
+    environment.priorityClass = GetPriorityClass(GetCurrentProcess());
+    environment.powerScheme = GetActivePowerSchemeName();
+
+    SYSTEM_POWER_STATUS powerStatus = {};
+    if (GetSystemPowerStatus(&powerStatus))
+    {
+        environment.bOnBattery = (powerStatus.ACLineStatus == 0);
+        environment.bBatterySaver = (powerStatus.SystemStatusFlag != 0);
+    }
+
+    // One entry per processor of the system, in all the processor groups (not only the
+    // processors of the topology, which covers the process group only)
+    std::vector<ProcessorPowerInformation> processors(GetActiveProcessorCount(ALL_PROCESSOR_GROUPS));
+    environment.frequencyStatus = CallNtPowerInformation(ProcessorInformation, nullptr, 0, processors.data(),
+        static_cast<ULONG>(processors.size() * sizeof(ProcessorPowerInformation)));
+    if (environment.frequencyStatus == 0)
+    {
+        environment.limitMhz = ~0UL;
+        for (const auto& processor : processors)
+        {
+            environment.maxMhz = (std::max)(environment.maxMhz, processor.MaxMhz);
+            environment.currentMhz = (std::max)(environment.currentMhz, processor.CurrentMhz);
+            environment.limitMhz = (std::min)(environment.limitMhz, processor.MhzLimit);
+        }
+    }
+
+    // System load while this process sleeps: all of it comes from somebody else
+    FILETIME idle0 = {}, kernel0 = {}, user0 = {};
+    FILETIME idle1 = {}, kernel1 = {}, user1 = {};
+    if (GetSystemTimes(&idle0, &kernel0, &user0))
+    {
+        Sleep(sampleMs);
+        if (GetSystemTimes(&idle1, &kernel1, &user1))
+        {
+            // Kernel time includes the idle time
+            const ULONGLONG idle = FileTimeToTicks(idle1) - FileTimeToTicks(idle0);
+            const ULONGLONG total = (FileTimeToTicks(kernel1) - FileTimeToTicks(kernel0))
+                                  + (FileTimeToTicks(user1) - FileTimeToTicks(user0));
+            if (total != 0)
+            {
+                environment.busyPercent = 100.0 * (total - (std::min)(idle, total)) / total;
+            }
+        }
+    }
+
+    return environment;
+}
+
+
+inline unsigned PrintBenchmarkEnvironment(std::ostream& os, const BenchmarkEnvironment& environment,
+                                          const CThreadPinning& pinning)
+{
+    const CpuTopology& topology = environment.topology;
+    const bool bSmt = topology.logicalCount > topology.coreMasks.size();
+
+    os << "Environment:\n"
+       << "  CPU:      " << topology.logicalCount << " logical processors on "
+       << topology.coreMasks.size() << " cores (SMT " << (bSmt ? "on" : "off") << ")";
+    const bool bFrequencyKnown = (environment.frequencyStatus == 0);
+    if (bFrequencyKnown)
+    {
+        os << ", " << environment.maxMhz << " MHz nominal, " << environment.currentMhz
+           << " MHz current, " << environment.limitMhz << " MHz limit";
+    }
+    else
+    {
+        os << ", frequency unknown (CallNtPowerInformation failed, NTSTATUS 0x" << std::hex
+           << static_cast<ULONG>(environment.frequencyStatus) << std::dec << ")";
+    }
+    // Turbo can't be read from the power information: it is only known to be active when
+    // a processor was sampled above the rated frequency
+    const bool bTurboSeen = bFrequencyKnown && environment.currentMhz > environment.maxMhz;
+    os << "\n  Turbo:    "
+       << (bTurboSeen ? "active (a processor ran above the rated frequency when sampled)"
+           : bFrequencyKnown ? "unknown (no processor ran above the rated frequency when sampled)"
+                             : "unknown (the CPU frequency couldn't be read)");
+    os << "\n  Power:    " << environment.powerScheme << " scheme, "
+       << (environment.bOnBattery ? "on battery" : "on AC power")
+       << (environment.bBatterySaver ? ", battery saver on" : "") << '\n'
+       << "  Load:     " << environment.busyPercent << "% system load\n"
+       << "  Pinning:  ";
+    if (pinning.IsEnabled())
+    {
+        const char* separator = "logical processors ";
+        for (unsigned processor : pinning.GetProcessors())
+        {
+            os << separator << processor;
+            separator = ",";
+        }
+    }
+    else
+    {
+        os << "none";
+    }
+    os << '\n';
+
+    unsigned warningCount = 0;
+    auto warn = [&](const std::string& message)
+    {
+        os << "WARNING: " << message << '\n';
+        ++warningCount;
+    };
+
+#ifdef _DEBUG
+    warn("debug build: timings are not representative.");
+#endif // _DEBUG
+
+    if (environment.bOnBattery)
+    {
+        warn("running on battery power.");
+    }
+    if (environment.bBatterySaver)
+    {
+        warn("battery saver is on.");
+    }
+    if (environment.powerScheme != "High performance" && environment.powerScheme != "Ultimate performance")
+    {
+        warn("power scheme is " + environment.powerScheme + ": the CPU frequency ramps up and down "
+             "with the load (select High performance).");
+    }
+    if (!bFrequencyKnown)
+    {
+        warn("the CPU frequency couldn't be read: throttling and turbo boost go undetected.");
+    }
+    if (bFrequencyKnown && environment.limitMhz < environment.maxMhz)
+    {
+        warn("CPU frequency limited to " + std::to_string(environment.limitMhz) + " MHz "
+             "(thermal or power throttling).");
+    }
+    if (bTurboSeen)
+    {
+        warn("turbo boost is active: the frequency depends on temperature and on the number "
+             "of busy cores.");
+    }
+    if (environment.busyPercent > 10.0)
+    {
+        warn("system load is " + std::to_string(static_cast<int>(environment.busyPercent)) +
+             "% before the benchmark starts: other processes compete for the CPU.");
+    }
+    if (environment.priorityClass != HIGH_PRIORITY_CLASS && environment.priorityClass != REALTIME_PRIORITY_CLASS)
+    {
+        warn("process priority is not high (use /high-priority).");
+    }
+
+    if (!pinning.IsEnabled())
+    {
+        warn("threads are not pinned: the scheduler may migrate them (use /pin).");
+    }
+    else
+    {
+        // Benchmark threads sharing a physical core compete for its execution units
+        const auto& processors = pinning.GetProcessors();
+        for (size_t i = 0; i < processors.size(); ++i)
+        {
+            for (size_t j = i + 1; j < processors.size(); ++j)
+            {
+                if (processors[i] != processors[j] &&
+                    topology.FindCore(processors[i]) == topology.FindCore(processors[j]))
+                {
+                    warn("pinned processors " + std::to_string(processors[i]) + " and " +
+                         std::to_string(processors[j]) + " are SMT siblings (use /pin:cores).");
+                }
+            }
+        }
+    }
+
+    return warningCount;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Entry points of the benchmarks selected with "/bench:<name>"
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <vector>       // std::vector
+
+#include <Windows.h>    // SIZE_T
+
+#include "BenchmarkCommon.h"    // CCommandLine
+
+
+struct TraceRecord;     // AllocationTrace.h
+
+
+//
+// Each benchmark returns the process exit code.
+// Multi-process benchmarks also have a worker entry point, run in the child processes
+// they spawn (with "/worker:<name>").
+//
+
+// SharedPoolBenchmark.cpp
+int RunSharedPoolBenchmark(const CCommandLine& cmdLine);
+int RunSharedPoolWorker(const CCommandLine& cmdLine);
+
+// SharedStringPoolBenchmark.cpp
+int RunSharedStringPoolBenchmark(const CCommandLine& cmdLine);
+int RunSharedStringPoolWorker(const CCommandLine& cmdLine);
+
+// ThreadPoolBenchmark.cpp
+int RunThreadPoolBenchmark(const CCommandLine& cmdLine);
+
+// HashBuildBenchmark.cpp
+int RunHashBuildBenchmark(const CCommandLine& cmdLine);
+
+// HashLookupBenchmark.cpp
+int RunHashLookupBenchmark(const CCommandLine& cmdLine);
+
+// HandoffBenchmark.cpp
+int RunHandoffBenchmark(const CCommandLine& cmdLine);
+
+// ServerBenchmark.cpp
+int RunServerBenchmark(const CCommandLine& cmdLine);
+
+// ChurnBenchmark.cpp
+int RunChurnBenchmark(const CCommandLine& cmdLine);
+
+// TraceReplayBenchmark.cpp
+int RunTraceReplayBenchmark(const CCommandLine& cmdLine);
+
+// Replay a loaded or recorded trace against ATL, STL and POL (see AllocationTrace.h);
+// return 1 on a checksum mismatch
+int ReplayAllocationTrace(const std::vector<TraceRecord>& records, SIZE_T cbChunkSize);
+
+// WordCountBenchmark.cpp
+int RunWordCountBenchmark(const CCommandLine& cmdLine);
+
+// HashJoinBenchmark.cpp
+int RunHashJoinBenchmark(const CCommandLine& cmdLine);
+
+// ColdCacheBenchmark.cpp
+int RunColdCacheBenchmark(const CCommandLine& cmdLine);
+
+// ScanBenchmark.cpp
+int RunScanBenchmark(const CCommandLine& cmdLine);
+
+// RooflineBenchmark.cpp
+int RunRooflineBenchmark(const CCommandLine& cmdLine);
+
+// NoisyNeighbourBenchmark.cpp
+int RunNoisyNeighbourBenchmark(const CCommandLine& cmdLine);
+
+// MicroBenchmark.cpp
+int RunMicroBenchmarks(const CCommandLine& cmdLine);
+
+// ScalingBenchmark.cpp
+int RunScalingBenchmark(const CCommandLine& cmdLine);
+
+// PhaseLoopBenchmark.cpp
+int RunPhaseLoopBenchmark(const CCommandLine& cmdLine);
+
+// EnergyBenchmark.cpp
+int RunEnergyBenchmark(const CCommandLine& cmdLine);
+
+// LocalityBenchmark.cpp
+int RunLocalityBenchmark(const CCommandLine& cmdLine);
+
+// BudgetBenchmark.cpp
+int RunBudgetBenchmark(const CCommandLine& cmdLine);
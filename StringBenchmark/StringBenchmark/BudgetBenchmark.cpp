@@ -0,0 +1,220 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Pool Budget Benchmark
+//
+// Measures the cost of the byte budget checks of CStringPoolAllocator (see SetBudget),
+// which live on the slow path only: every string allocated here is larger than half a
+// chunk, so each AllocString call allocates a new chunk. Compares, in ns per new chunk:
+//
+//  no budget           the pool as before
+//  within budget       soft and hard limits set, never reached
+//  soft limit          a soft limit of 1 byte: the (empty) callback runs for every chunk
+//  soft limit + Reset  a soft limit of 2 chunks, whose callback resets the pool: Reset
+//                      frees the older chunk and decommits the used pages of the kept one
+//  hard limit          a hard limit of 1 byte: every call fails, without a system call
+//
+// The configurations run in interleaved rounds; the best round of each is printed. After
+// each Reset from the callback, the pool statistics are checked: one chunk committed,
+// nothing used.
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::min
+#include <iostream>     // std::cout
+#include <new>          // std::bad_alloc
+#include <string>       // std::wstring
+#include <vector>       // std::vector
+
+#include <windows.h>    // Windows SDK API
+
+#include "StringPool.h"         // Custom string pool allocator
+#include "BenchmarkCommon.h"    // Common benchmark helpers
+#include "Benchmarks.h"         // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+using std::wstring;
+
+
+namespace
+{
+
+#ifdef _DEBUG
+constexpr unsigned long long kDefaultChunkCount = 200;
+#else
+constexpr unsigned long long kDefaultChunkCount = 2000;
+#endif // _DEBUG
+
+constexpr int kRoundCount = 3;
+
+enum
+{
+    // Chunks of the pools: the minimum accepted, rounded up to 64KB chunks
+    kcbMinChunkSize = 32000,
+
+    // Each string takes more than half a 64KB chunk, so it gets a chunk of its own
+    kcbString = 40000,
+
+    // Soft limit of the Reset configuration: two of those chunks
+    kcbResetSoftLimit = 2 * 64 * 1024
+};
+
+
+enum
+{
+    kConfigNoBudget,
+    kConfigWithinBudget,
+    kConfigSoftLimit,
+    kConfigSoftLimitReset,
+    kConfigHardLimit,
+    kConfigCount
+};
+
+const char* const kConfigNames[kConfigCount] =
+{
+    "no budget", "within budget", "soft limit (callback each chunk)", "soft limit + Reset (callback every 2 chunks)",
+    "hard limit (refused)"
+};
+
+
+void CountSoftLimitCall(CStringPoolAllocator& /* pool */, void* pContext)
+{
+    ++*static_cast<unsigned long long*>(pContext);
+}
+
+
+// Context of ResetOnSoftLimit
+struct SoftLimitReset
+{
+    unsigned long long& calls;
+    unsigned long long& statsMismatches;
+};
+
+// Reset the pool, as an owner flushing it would: only the chunk kept must stay
+// committed, with nothing used
+void ResetOnSoftLimit(CStringPoolAllocator& pool, void* pContext)
+{
+    SoftLimitReset& context = *static_cast<SoftLimitReset*>(pContext);
+    ++context.calls;
+
+    pool.Reset();
+
+    const CStringPoolAllocator::Stats stats = pool.GetStats();
+    if (stats.chunkCount != 1 || stats.cbCommitted > kcbResetSoftLimit / 2 || stats.cbUsed != 0)
+    {
+        ++context.statsMismatches;
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+// Allocate chunkCount strings (one chunk each) from a pool with the given budget
+// configuration; return the elapsed ticks, not counting the pool's destruction
+//---------------------------------------------------------------------------------------
+long long MeasureChunks(int config, const wstring& s, unsigned long long chunkCount,
+                        unsigned long long& softLimitCalls, unsigned long long& refusals,
+                        unsigned long long& statsMismatches)
+{
+    CStringPoolAllocator pool(kcbMinChunkSize);
+    SoftLimitReset resetContext = { softLimitCalls, statsMismatches };
+    switch (config)
+    {
+    case kConfigWithinBudget:
+        pool.SetBudget(static_cast<SIZE_T>(-1) / 2, static_cast<SIZE_T>(-1), CountSoftLimitCall, &softLimitCalls);
+        break;
+
+    case kConfigSoftLimit:
+        pool.SetBudget(1, 0, CountSoftLimitCall, &softLimitCalls);
+        break;
+
+    case kConfigSoftLimitReset:
+        pool.SetBudget(kcbResetSoftLimit, 0, ResetOnSoftLimit, &resetContext);
+        break;
+
+    case kConfigHardLimit:
+        pool.SetBudget(0, 1);
+        break;
+    }
+
+    const long long start = PerfCounter();
+    for (unsigned long long i = 0; i < chunkCount; ++i)
+    {
+        try
+        {
+            pool.AllocString(s.c_str(), s.c_str() + s.size());
+        }
+        catch (const std::bad_alloc&)
+        {
+            ++refusals;
+        }
+    }
+    const long long finish = PerfCounter();
+
+    GetTimelineTracer().RecordComplete(kConfigNames[config], start, finish);
+    return finish - start;
+}
+
+} // namespace
+
+
+int RunBudgetBenchmark(const CCommandLine& cmdLine)
+{
+    const unsigned long long chunkCount = cmdLine.GetNumber(L"/chunks", kDefaultChunkCount);
+    if (chunkCount == 0)
+    {
+        cout << "/chunks must be at least 1.\n";
+        return 1;
+    }
+
+    const wstring s(kcbString / sizeof(wchar_t), L'x');
+
+    cout << "=== Pool Budget Checks (" << chunkCount << " new chunks per round, best of "
+         << kRoundCount << " rounds) === \n";
+
+    long long bestTicks[kConfigCount] = {};
+    unsigned long long softLimitCalls[kConfigCount] = {};
+    unsigned long long refusals[kConfigCount] = {};
+    unsigned long long statsMismatches = 0;
+    for (int round = 0; round < kRoundCount; ++round)
+    {
+        for (int config = 0; config < kConfigCount; ++config)
+        {
+            const long long ticks = MeasureChunks(config, s, chunkCount, softLimitCalls[config], refusals[config],
+                                                  statsMismatches);
+            bestTicks[config] = (round == 0) ? ticks : (std::min)(bestTicks[config], ticks);
+        }
+    }
+
+    for (int config = 0; config < kConfigCount; ++config)
+    {
+        cout << kConfigNames[config] << ": "
+             << bestTicks[config] * 1e9 / PerfFrequency() / chunkCount << " ns per AllocString ("
+             << softLimitCalls[config] / kRoundCount << " soft-limit calls, "
+             << refusals[config] / kRoundCount << " refused per round)\n";
+    }
+
+    // The budget must only refuse allocations past the hard limit
+    if (refusals[kConfigNoBudget] + refusals[kConfigWithinBudget] + refusals[kConfigSoftLimit]
+            + refusals[kConfigSoftLimitReset] != 0
+        || refusals[kConfigHardLimit] != chunkCount * kRoundCount)
+    {
+        cout << "Budget check mismatch!\n";
+        return 1;
+    }
+
+    // Each Reset from the callback must have left one empty chunk
+    if (chunkCount > 2 && softLimitCalls[kConfigSoftLimitReset] == 0)
+    {
+        cout << "The soft-limit callback never ran!\n";
+        return 1;
+    }
+    if (statsMismatches != 0)
+    {
+        cout << "Pool statistics mismatch after Reset (" << statsMismatches << " times)!\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Cache and Working Set Eviction, for cold-cache measurements
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <memory>       // std::unique_ptr
+#include <vector>       // std::vector
+
+#include <intrin.h>     // _mm_clflush, _mm_mfence
+
+#include <Windows.h>    // Windows Platform SDK
+
+
+//---------------------------------------------------------------------------------------
+// Size in bytes of the largest (last-level) CPU cache, or 0 if it can't be determined
+//---------------------------------------------------------------------------------------
+inline SIZE_T GetLastLevelCacheSize()
+{
+    DWORD cb = 0;
+    GetLogicalProcessorInformation(nullptr, &cb);
+    if (cb == 0)
+    {
+        return 0;
+    }
+
+    std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> infos(cb / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+    if (!GetLogicalProcessorInformation(infos.data(), &cb))
+    {
+        return 0;
+    }
+
+    SIZE_T cbLastLevel = 0;
+    BYTE lastLevel = 0;
+    for (const auto& info : infos)
+    {
+        if (info.Relationship == RelationCache && info.Cache.Level >= lastLevel)
+        {
+            if (info.Cache.Level > lastLevel || info.Cache.Size > cbLastLevel)
+            {
+                cbLastLevel = info.Cache.Size;
+            }
+            lastLevel = info.Cache.Level;
+        }
+    }
+    return cbLastLevel;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Cache Evictor
+//
+// Two ways to start a measurement with cold caches:
+//  - Sweep: read and write a buffer several times bigger than the last-level cache,
+//    evicting everything else (on all the cache levels, with an inclusive LLC)
+//  - Flush: clflush the cache lines of a given memory range only
+//---------------------------------------------------------------------------------------
+class CCacheEvictor
+{
+public:
+    enum
+    {
+        kcbCacheLine = 64
+    };
+
+    // Prepare a sweep buffer of cbSweep bytes; pass 0 for four times the last-level cache
+    // (or 64MB, if its size can't be determined)
+    explicit CCacheEvictor(SIZE_T cbSweep = 0);
+
+    // Size of the sweep buffer, in bytes
+    SIZE_T GetSweepSize() const noexcept;
+
+    // Evict the caches by sweeping the buffer
+    void Sweep() noexcept;
+
+    // Flush the cache lines of a memory range from all the cache levels.
+    // Call FlushFence() after the last range, before starting the measurement.
+    static void Flush(const void* pv, SIZE_T cb) noexcept;
+    static void FlushFence() noexcept;
+
+    // Drop the pages of the process from its working set (string pools included), so the
+    // next accesses take soft page faults, as after the pages were trimmed by the system
+    static void DropWorkingSet() noexcept;
+
+
+    //
+    // Ban Copy
+    //
+private:
+    CCacheEvictor(const CCacheEvictor&) = delete;
+    CCacheEvictor& operator=(const CCacheEvictor&) = delete;
+
+
+    //
+    // IMPLEMENTATION
+    //
+private:
+    SIZE_T                              m_cbSweep;
+    std::unique_ptr<volatile BYTE[]>    m_sweep;    // Buffer swept to evict the caches
+};
+
+
+//=======================================================================================
+//                          Inline Method Implementations
+//=======================================================================================
+
+inline CCacheEvictor::CCacheEvictor(SIZE_T cbSweep)
+    : m_cbSweep(cbSweep)
+{
+    if (m_cbSweep == 0)
+    {
+        const SIZE_T cbLastLevel = GetLastLevelCacheSize();
+        m_cbSweep = (cbLastLevel != 0) ? 4 * cbLastLevel : 64 * 1024 * 1024;
+    }
+
+    m_sweep.reset(new volatile BYTE[m_cbSweep]());
+}
+
+
+inline SIZE_T CCacheEvictor::GetSweepSize() const noexcept
+{
+    return m_cbSweep;
+}
+
+
+inline void CCacheEvictor::Sweep() noexcept
+{
+    // Write one byte per cache line: the lines are read for ownership, then dirtied,
+    // so they also push the lines they replace out of the caches
+    for (SIZE_T i = 0; i < m_cbSweep; i += kcbCacheLine)
+    {
+        m_sweep[i] = static_cast<BYTE>(m_sweep[i] + 1);
+    }
+}
+
+
+inline void CCacheEvictor::Flush(const void* pv, SIZE_T cb) noexcept
+{
+    const BYTE* const pbBegin = static_cast<const BYTE*>(pv);
+    const BYTE* const pbEnd = pbBegin + cb;
+
+    // Start from the cache line containing the first byte
+    const BYTE* pb = reinterpret_cast<const BYTE*>(
+        reinterpret_cast<ULONG_PTR>(pbBegin) & ~static_cast<ULONG_PTR>(kcbCacheLine - 1));
+    for (; pb < pbEnd; pb += kcbCacheLine)
+    {
+        _mm_clflush(pb);
+    }
+}
+
+
+inline void CCacheEvictor::FlushFence() noexcept
+{
+    _mm_mfence();
+}
+
+
+inline void CCacheEvictor::DropWorkingSet() noexcept
+{
+    SetProcessWorkingSetSize(GetCurrentProcess(), static_cast<SIZE_T>(-1), static_cast<SIZE_T>(-1));
+}
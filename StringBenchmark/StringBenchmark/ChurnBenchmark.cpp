@@ -0,0 +1,337 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Fragmentation Churn Benchmark
+//
+// Simulates a long-running process over many epochs. In each epoch, strings whose
+// lifetime has expired are released, and a batch of new strings of varying lengths is
+// allocated, each with a random lifetime (mostly short, with a long tail):
+//
+//  - STL: std::wstring objects, released one by one to the heap
+//  - POL: epoch-scoped pools -- the strings expiring in the same epoch are allocated from
+//         the same CStringPoolAllocator, which is released as a whole when they expire
+//         (or Reset and reused, with /reuse)
+//
+// Prints a time series of throughput, live strings, working set and private (committed)
+// bytes, as CSV rows, to plot the memory drift. The other lines of the output (the title
+// and the notes, and the program's banner and environment report) start with '#', so the
+// output loads as is in most CSV readers.
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::min
+#include <cmath>        // std::pow
+#include <iostream>     // std::cout
+#include <memory>       // std::unique_ptr
+#include <random>       // std::mt19937, distributions
+#include <string>       // std::wstring, std::to_string
+#include <vector>       // std::vector
+
+#include <wchar.h>      // wcslen
+
+#include <windows.h>    // Windows SDK API
+
+#include "StringPool.h"         // Custom string pool allocator
+#include "BenchmarkCommon.h"    // Common benchmark helpers
+#include "Benchmarks.h"         // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+using std::wstring;
+
+
+namespace
+{
+
+#ifdef _DEBUG
+constexpr unsigned long long kDefaultStringsPerEpoch = 1000;
+#else
+constexpr unsigned long long kDefaultStringsPerEpoch = 200 * 1000;    // 200K
+#endif // _DEBUG
+
+// Range of the string lengths, in WCHARs (excluding the terminating NUL)
+constexpr size_t kMinStringLength = 4;
+constexpr size_t kMaxStringLength = 1024;
+
+
+struct ChurnOptions
+{
+    unsigned    epochs;
+    unsigned    sampleEvery;    // Epochs between two rows of the time series
+    unsigned    maxLifetime;    // Longest string lifetime, in epochs
+    size_t      stringsPerEpoch;
+    bool        bReusePools;    // POL: Reset expired pools instead of releasing them
+};
+
+
+//---------------------------------------------------------------------------------------
+// Deterministic sequence of allocations: a slice of a long text, and a lifetime
+//---------------------------------------------------------------------------------------
+class CChurnWorkload
+{
+public:
+    struct Allocation
+    {
+        const wchar_t*  pchBegin;
+        const wchar_t*  pchEnd;
+        unsigned        lifetime;   // In epochs, in [1, maxLifetime]
+    };
+
+    CChurnWorkload(const wstring& text, unsigned maxLifetime)
+        : m_text(text)
+        , m_maxLifetime(maxLifetime)
+        , m_prng(2024)
+        , m_shortLifetime(0.3)
+        , m_logLength(0.0, 1.0)
+        , m_offset(0, text.size() - kMaxStringLength)
+    {
+    }
+
+    Allocation Next()
+    {
+        Allocation a;
+
+        // Log-uniform lengths: many short strings, some long ones
+        const double ratio = static_cast<double>(kMaxStringLength) / kMinStringLength;
+        const size_t length = static_cast<size_t>(kMinStringLength * std::pow(ratio, m_logLength(m_prng)));
+
+        a.pchBegin = m_text.c_str() + m_offset(m_prng);
+        a.pchEnd   = a.pchBegin + length;
+
+        // 1% of the strings live as long as possible, the others have geometric lifetimes
+        if (m_prng() % 100 == 0)
+        {
+            a.lifetime = m_maxLifetime;
+        }
+        else
+        {
+            a.lifetime = (std::min)(1 + static_cast<unsigned>(m_shortLifetime(m_prng)), m_maxLifetime);
+        }
+
+        return a;
+    }
+
+private:
+    const wstring&                              m_text;
+    unsigned                                    m_maxLifetime;
+    std::mt19937                                m_prng;
+    std::geometric_distribution<unsigned>       m_shortLifetime;
+    std::uniform_real_distribution<double>      m_logLength;
+    std::uniform_int_distribution<size_t>       m_offset;
+};
+
+
+//---------------------------------------------------------------------------------------
+// Contenders: the live strings are kept in buckets, one per expiry epoch modulo
+// (maxLifetime + 1). Expire() releases a whole bucket, and returns the sum of the
+// lengths of its strings (reading them, as a checksum).
+//---------------------------------------------------------------------------------------
+
+class CStlChurn
+{
+public:
+    explicit CStlChurn(const ChurnOptions& options)
+        : m_buckets(options.maxLifetime + 1)
+    {
+    }
+
+    void Allocate(size_t bucket, const wchar_t* pchBegin, const wchar_t* pchEnd)
+    {
+        m_buckets[bucket].emplace_back(pchBegin, pchEnd);
+    }
+
+    unsigned long long Expire(size_t bucket)
+    {
+        unsigned long long checksum = 0;
+        for (const auto& s : m_buckets[bucket])
+        {
+            checksum += wcslen(s.c_str());
+        }
+        m_buckets[bucket].clear();
+        return checksum;
+    }
+
+private:
+    vector<vector<wstring>> m_buckets;
+};
+
+class CPooledChurn
+{
+public:
+    explicit CPooledChurn(const ChurnOptions& options)
+        : m_buckets(options.maxLifetime + 1)
+        , m_pools(options.maxLifetime + 1)
+        , m_bReusePools(options.bReusePools)
+    {
+        for (size_t bucket = 0; bucket < m_pools.size(); ++bucket)
+        {
+            NewPool(bucket);
+        }
+    }
+
+    void Allocate(size_t bucket, const wchar_t* pchBegin, const wchar_t* pchEnd)
+    {
+        m_buckets[bucket].push_back(m_pools[bucket]->AllocString(pchBegin, pchEnd));
+    }
+
+    unsigned long long Expire(size_t bucket)
+    {
+        unsigned long long checksum = 0;
+        for (const wchar_t* psz : m_buckets[bucket])
+        {
+            checksum += wcslen(psz);
+        }
+        m_buckets[bucket].clear();
+
+        // All the strings of the pool expire together
+        if (m_bReusePools)
+        {
+            m_pools[bucket]->Reset();
+        }
+        else
+        {
+            NewPool(bucket);
+        }
+        return checksum;
+    }
+
+private:
+    // Named, so Ctrl+Break lists the pools with their statistics
+    void NewPool(size_t bucket)
+    {
+        m_pools[bucket].reset(new CStringPoolAllocator());
+#ifdef STRING_POOL_REGISTRY
+        m_pools[bucket]->SetName(("churn lifetime #" + std::to_string(bucket)).c_str());
+#endif // STRING_POOL_REGISTRY
+    }
+
+    vector<vector<const wchar_t*>>                  m_buckets;
+    vector<std::unique_ptr<CStringPoolAllocator>>   m_pools;
+    bool                                            m_bReusePools;
+};
+
+
+//---------------------------------------------------------------------------------------
+// Run the epochs against a contender, printing a CSV row every options.sampleEvery
+// epochs, and a last one after all the strings have been released.
+// Return the checksum of all the released strings.
+//---------------------------------------------------------------------------------------
+template <typename Contender>
+unsigned long long RunChurn(const char* name, const ChurnOptions& options, const wstring& text)
+{
+    Contender contender(options);
+    CChurnWorkload workload(text, options.maxLifetime);
+
+    const size_t bucketCount = options.maxLifetime + 1;
+    vector<size_t> bucketSizes(bucketCount);
+    size_t liveCount = 0;
+    unsigned long long checksum = 0;
+
+    const long long start = PerfCounter();
+    long long windowStart = start;
+    unsigned long long windowAllocations = 0;
+
+    auto printRow = [&](unsigned epoch)
+    {
+        const long long now = PerfCounter();
+        const double windowSeconds = static_cast<double>(now - windowStart) / PerfFrequency();
+        const ProcessMemory memory = GetProcessMemory();
+
+        cout << name << ',' << epoch << ','
+             << (now - start) * 1000.0 / PerfFrequency() << ','
+             << (windowSeconds > 0.0 ? windowAllocations / windowSeconds / 1e6 : 0.0) << ','
+             << liveCount << ','
+             << memory.cbWorkingSet / kMB << ','
+             << memory.cbPrivate / kMB << '\n';
+
+        windowStart = PerfCounter();
+        windowAllocations = 0;
+    };
+
+    for (unsigned epoch = 0; epoch < options.epochs; ++epoch)
+    {
+        // Release the strings expiring now
+        const size_t expiring = epoch % bucketCount;
+        checksum += contender.Expire(expiring);
+        liveCount -= bucketSizes[expiring];
+        bucketSizes[expiring] = 0;
+
+        // Allocate the new ones
+        for (size_t i = 0; i < options.stringsPerEpoch; ++i)
+        {
+            const CChurnWorkload::Allocation a = workload.Next();
+            const size_t bucket = (epoch + a.lifetime) % bucketCount;
+            contender.Allocate(bucket, a.pchBegin, a.pchEnd);
+            ++bucketSizes[bucket];
+        }
+        liveCount += options.stringsPerEpoch;
+        windowAllocations += options.stringsPerEpoch;
+
+        if ((epoch + 1) % options.sampleEvery == 0)
+        {
+            printRow(epoch + 1);
+        }
+    }
+
+    // Drain: shows how much memory stays in the process once everything is released
+    for (size_t bucket = 0; bucket < bucketCount; ++bucket)
+    {
+        checksum += contender.Expire(bucket);
+    }
+    liveCount = 0;
+    printRow(options.epochs);
+
+    return checksum;
+}
+
+} // namespace
+
+
+int RunChurnBenchmark(const CCommandLine& cmdLine)
+{
+    ChurnOptions options;
+    options.epochs          = static_cast<unsigned>(cmdLine.GetNumber(L"/epochs", 200));
+    options.sampleEvery     = static_cast<unsigned>(cmdLine.GetNumber(L"/sample", 10));
+    options.maxLifetime     = static_cast<unsigned>(cmdLine.GetNumber(L"/max-lifetime", 32));
+    options.stringsPerEpoch = static_cast<size_t>(cmdLine.GetNumber(L"/per-epoch", kDefaultStringsPerEpoch));
+    options.bReusePools     = cmdLine.Has(L"/reuse");
+    if (options.epochs == 0 || options.sampleEvery == 0 || options.maxLifetime == 0)
+    {
+        cout << "# /epochs, /sample and /max-lifetime must be at least 1.\n";
+        return 1;
+    }
+
+    cout << "# === Fragmentation Churn (" << options.epochs << " epochs, "
+         << options.stringsPerEpoch << " strings per epoch, lifetimes up to "
+         << options.maxLifetime << " epochs" << (options.bReusePools ? ", reused pools" : "")
+         << ") === \n";
+
+    // The strings are slices of a long text made of the usual test strings
+    wstring text;
+    for (const auto& s : BuildShuffledStrings())
+    {
+        text += s;
+        if (text.size() >= 64 * kMaxStringLength)
+        {
+            break;
+        }
+    }
+    while (text.size() < 64 * kMaxStringLength)
+    {
+        text += text;
+    }
+
+    // The last row of each contender is taken after releasing all its strings
+    cout << "contender,epoch,ms,m_strings_per_s,live_strings,working_set_mb,private_mb\n";
+    const unsigned long long stlChecksum = RunChurn<CStlChurn>("STL", options, text);
+    const unsigned long long poolChecksum = RunChurn<CPooledChurn>("POL", options, text);
+
+    if (stlChecksum != poolChecksum)
+    {
+        cout << "# Checksum mismatch!\n";
+        return 1;
+    }
+
+    return 0;
+}
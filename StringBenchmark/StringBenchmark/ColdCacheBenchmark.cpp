@@ -0,0 +1,215 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Cold-Cache Benchmark
+//
+// Runs the creation and sorting phases of the classic benchmark for ATL, STL and POL
+// several times, warm (back-to-back, as in the classic benchmark) and cold (with the
+// caches evicted before each phase), and prints the median times side by side.
+//
+// Eviction (/evict:sweep, the default, or /evict:flush):
+//  - sweep: sweep a buffer larger than the last-level cache before each phase
+//  - flush: clflush the data the phase is about to read (the source strings before
+//           creation, the created strings before sorting)
+// With /drop-pages, the process working set (including the string pool chunks) is also
+// trimmed before each cold phase, so the phase takes soft page faults too.
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <iostream>     // std::cout
+#include <string>       // std::wstring
+#include <vector>       // std::vector
+
+#include <wchar.h>      // wcscmp, wcslen
+
+#include <windows.h>    // Windows SDK API
+
+#include "Contenders.h"         // ATL, STL and POL contenders
+#include "CacheEviction.h"      // Cache evictor
+#include "BenchmarkCommon.h"    // Common benchmark helpers
+#include "Benchmarks.h"         // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+using std::wstring;
+
+
+namespace
+{
+
+enum class EvictionMode
+{
+    Sweep,
+    Flush
+};
+
+struct ColdCacheOptions
+{
+    unsigned        iterations;
+    EvictionMode    eviction;
+    bool            bDropPages;
+};
+
+
+//---------------------------------------------------------------------------------------
+// Flush a contender's strings from the caches: the vector of strings, and the
+// characters of each string (for the pooled strings, the used part of the pool's chunks)
+//---------------------------------------------------------------------------------------
+template <typename Strings>
+void FlushStrings(const Strings& strings) noexcept
+{
+    CCacheEvictor::Flush(strings.strings.data(), strings.strings.size() * sizeof(strings.strings[0]));
+    for (size_t i = 0; i < strings.size(); ++i)
+    {
+        const wchar_t* const psz = strings.GetString(i);
+        CCacheEvictor::Flush(psz, (wcslen(psz) + 1) * sizeof(wchar_t));
+    }
+}
+
+void FlushStrings(const PooledStrings& strings)
+{
+    CCacheEvictor::Flush(strings.strings.data(), strings.strings.size() * sizeof(strings.strings[0]));
+    for (const auto& chunk : strings.pool->GetChunks())
+    {
+        // Only the part written so far: flushing the rest would touch pages the pool has
+        // never used, adding their page faults to the cold measurement
+        CCacheEvictor::Flush(chunk.pvBase, chunk.cbUsed);
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+// Measure a contender warm and cold, and print a line with the median times
+//---------------------------------------------------------------------------------------
+template <typename Strings>
+void MeasureColdWarm(const char* name, const ColdCacheOptions& options, CCacheEvictor& evictor,
+                     const vector<wstring>& shuffled, const vector<const wchar_t*>& shuffled_ptrs)
+{
+    auto evict = [&](const Strings* pStrings)
+    {
+        if (options.eviction == EvictionMode::Sweep)
+        {
+            evictor.Sweep();
+        }
+        else
+        {
+            // Source strings (read by creation), or the created strings (read by sorting)
+            if (pStrings == nullptr)
+            {
+                CCacheEvictor::Flush(shuffled_ptrs.data(), shuffled_ptrs.size() * sizeof(shuffled_ptrs[0]));
+                for (const auto& s : shuffled)
+                {
+                    CCacheEvictor::Flush(s.c_str(), (s.size() + 1) * sizeof(wchar_t));
+                }
+            }
+            else
+            {
+                FlushStrings(*pStrings);
+            }
+            CCacheEvictor::FlushFence();
+        }
+
+        if (options.bDropPages)
+        {
+            CCacheEvictor::DropWorkingSet();
+        }
+    };
+
+    vector<long long> warmCreation;
+    vector<long long> warmSort;
+    vector<long long> coldCreation;
+    vector<long long> coldSort;
+
+    // Warm: back-to-back runs, after one untimed warm-up run
+    for (unsigned i = 0; i <= options.iterations; ++i)
+    {
+        Strings strings;
+
+        const long long start = PerfCounter();
+        strings.Create(shuffled_ptrs);
+        const long long created = PerfCounter();
+        strings.Sort();
+        const long long finish = PerfCounter();
+
+        if (i > 0)
+        {
+            warmCreation.push_back(created - start);
+            warmSort.push_back(finish - created);
+        }
+    }
+
+    // Cold: evict before each phase
+    for (unsigned i = 0; i < options.iterations; ++i)
+    {
+        Strings strings;
+
+        evict(nullptr);
+        long long start = PerfCounter();
+        strings.Create(shuffled_ptrs);
+        long long finish = PerfCounter();
+        coldCreation.push_back(finish - start);
+
+        evict(&strings);
+        start = PerfCounter();
+        strings.Sort();
+        finish = PerfCounter();
+        coldSort.push_back(finish - start);
+    }
+
+    cout << name << ": creation " << MedianMs(warmCreation) << " / " << MedianMs(coldCreation) << " ms, "
+         << "sort " << MedianMs(warmSort) << " / " << MedianMs(coldSort) << " ms (warm / cold)\n";
+}
+
+} // namespace
+
+
+int RunColdCacheBenchmark(const CCommandLine& cmdLine)
+{
+    ColdCacheOptions options;
+    options.iterations = static_cast<unsigned>(cmdLine.GetNumber(L"/iterations", 5));
+    options.bDropPages = cmdLine.Has(L"/drop-pages");
+    options.eviction   = EvictionMode::Sweep;
+
+    const wchar_t* const eviction = cmdLine.Find(L"/evict");
+    if (eviction != nullptr && wcscmp(eviction, L"flush") == 0)
+    {
+        options.eviction = EvictionMode::Flush;
+    }
+    else if (eviction != nullptr && wcscmp(eviction, L"sweep") != 0)
+    {
+        cout << "/evict must be sweep or flush.\n";
+        return 1;
+    }
+
+    if (options.iterations == 0)
+    {
+        cout << "/iterations must be at least 1.\n";
+        return 1;
+    }
+
+    // Only allocate the sweep buffer when it's going to be used
+    CCacheEvictor evictor(options.eviction == EvictionMode::Sweep
+                          ? static_cast<SIZE_T>(cmdLine.GetNumber(L"/sweep-mb", 0)) * 1024 * 1024
+                          : static_cast<SIZE_T>(CCacheEvictor::kcbCacheLine));
+
+    cout << "=== Cold vs. Warm Caches (" << options.iterations << " iterations, ";
+    if (options.eviction == EvictionMode::Sweep)
+    {
+        cout << "sweeping " << evictor.GetSweepSize() / kMB << " MB";
+    }
+    else
+    {
+        cout << "clflush";
+    }
+    cout << (options.bDropPages ? ", dropping pages" : "") << ") === \n";
+
+    const auto shuffled = BuildShuffledStrings();
+    const auto shuffled_ptrs = BuildStringPointers(shuffled);
+
+    MeasureColdWarm<AtlStrings>("ATL", options, evictor, shuffled, shuffled_ptrs);
+    MeasureColdWarm<StlStrings>("STL", options, evictor, shuffled, shuffled_ptrs);
+    MeasureColdWarm<PooledStrings>("POL", options, evictor, shuffled, shuffled_ptrs);
+
+    return 0;
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Contenders of the phase benchmarks: the classic benchmark's ATL, STL and pooled
+// strings, behind one interface
+//
+//  Create(source)  builds the strings from the source pointers, in their order
+//  Sort()          sorts them with wcscmp (std::wstring compares with wmemcmp, while ATL
+//                  CString already uses wcscmp: the comparisons are kept uniform)
+//  Scan()          reads them in order and returns a checksum of their characters
+//  Lookup(psz)     binary-searches a string in the sorted strings
+//  Clear()         releases them (teardown)
+//  size(), GetString(i)    the strings, in their current order
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::sort, std::lower_bound
+#include <memory>       // std::unique_ptr
+#include <string>       // std::wstring
+#include <utility>      // std::move
+#include <vector>       // std::vector
+
+#include <wchar.h>      // wcscmp
+
+#include <atlstr.h>     // CString
+
+#include "StringPool.h"     // Custom string pool allocator
+
+
+//---------------------------------------------------------------------------------------
+// ATL: one CStringW per string
+//---------------------------------------------------------------------------------------
+struct AtlStrings
+{
+    std::vector<ATL::CStringW> strings;
+
+    void Create(const std::vector<const wchar_t*>& source)
+    {
+        strings.assign(source.begin(), source.end());
+    }
+
+    void Sort()
+    {
+        std::sort(strings.begin(), strings.end());
+    }
+
+    unsigned long long Scan() const noexcept
+    {
+        unsigned long long checksum = 0;
+        for (const auto& s : strings)
+        {
+            for (const wchar_t* pch = s.GetString(); *pch != L'\0'; ++pch)
+            {
+                checksum += *pch;
+            }
+        }
+        return checksum;
+    }
+
+    bool Lookup(const wchar_t* psz) const
+    {
+        const auto it = std::lower_bound(strings.begin(), strings.end(), psz,
+            [](const ATL::CStringW& s, const wchar_t* pszKey) { return wcscmp(s.GetString(), pszKey) < 0; });
+        return it != strings.end() && wcscmp(it->GetString(), psz) == 0;
+    }
+
+    void Clear()
+    {
+        strings = std::vector<ATL::CStringW>();
+    }
+
+    size_t size() const noexcept
+    {
+        return strings.size();
+    }
+
+    const wchar_t* GetString(size_t i) const noexcept
+    {
+        return strings[i].GetString();
+    }
+};
+
+
+//---------------------------------------------------------------------------------------
+// STL: one std::wstring per string
+//---------------------------------------------------------------------------------------
+struct StlStrings
+{
+    std::vector<std::wstring> strings;
+
+    void Create(const std::vector<const wchar_t*>& source)
+    {
+        strings.assign(source.begin(), source.end());
+    }
+
+    void Sort()
+    {
+        std::sort(strings.begin(), strings.end(),
+            [](const std::wstring& s1, const std::wstring& s2) { return wcscmp(s1.c_str(), s2.c_str()) < 0; });
+    }
+
+    unsigned long long Scan() const noexcept
+    {
+        unsigned long long checksum = 0;
+        for (const auto& s : strings)
+        {
+            for (const wchar_t* pch = s.c_str(); *pch != L'\0'; ++pch)
+            {
+                checksum += *pch;
+            }
+        }
+        return checksum;
+    }
+
+    bool Lookup(const wchar_t* psz) const
+    {
+        const auto it = std::lower_bound(strings.begin(), strings.end(), psz,
+            [](const std::wstring& s, const wchar_t* pszKey) { return wcscmp(s.c_str(), pszKey) < 0; });
+        return it != strings.end() && wcscmp(it->c_str(), psz) == 0;
+    }
+
+    void Clear()
+    {
+        strings = std::vector<std::wstring>();
+    }
+
+    size_t size() const noexcept
+    {
+        return strings.size();
+    }
+
+    const wchar_t* GetString(size_t i) const noexcept
+    {
+        return strings[i].c_str();
+    }
+};
+
+
+//---------------------------------------------------------------------------------------
+// POL: pointers to strings packed in a pool, which Create() replaces
+//---------------------------------------------------------------------------------------
+struct PooledStrings
+{
+    std::unique_ptr<CStringPoolAllocator>   pool;
+    std::vector<const wchar_t*>             strings;
+
+    void Create(const std::vector<const wchar_t*>& source)
+    {
+        Create(source, std::unique_ptr<CStringPoolAllocator>(new CStringPoolAllocator()));
+    }
+
+    // Create the strings in a pool set up by the caller (e.g. named, or recording the
+    // AllocString latencies), which replaces the current one
+    void Create(const std::vector<const wchar_t*>& source, std::unique_ptr<CStringPoolAllocator> newPool)
+    {
+        pool = std::move(newPool);
+        strings.clear();
+        strings.reserve(source.size());
+        for (const wchar_t* psz : source)
+        {
+            strings.push_back(pool->AllocString(psz));
+        }
+    }
+
+    void Sort()
+    {
+        std::sort(strings.begin(), strings.end(),
+            [](const wchar_t* psz1, const wchar_t* psz2) { return wcscmp(psz1, psz2) < 0; });
+    }
+
+    unsigned long long Scan() const noexcept
+    {
+        unsigned long long checksum = 0;
+        for (const wchar_t* psz : strings)
+        {
+            for (const wchar_t* pch = psz; *pch != L'\0'; ++pch)
+            {
+                checksum += *pch;
+            }
+        }
+        return checksum;
+    }
+
+    bool Lookup(const wchar_t* psz) const
+    {
+        const auto it = std::lower_bound(strings.begin(), strings.end(), psz,
+            [](const wchar_t* psz1, const wchar_t* psz2) { return wcscmp(psz1, psz2) < 0; });
+        return it != strings.end() && wcscmp(*it, psz) == 0;
+    }
+
+    void Clear()
+    {
+        strings = std::vector<const wchar_t*>();
+        pool.reset();
+    }
+
+    size_t size() const noexcept
+    {
+        return strings.size();
+    }
+
+    const wchar_t* GetString(size_t i) const noexcept
+    {
+        return strings[i];
+    }
+};
@@ -0,0 +1,223 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Energy Benchmark
+//
+// Reads the energy meters of the machine (the RAPL package and DRAM counters, when the
+// platform exposes them, see EnergyMeter.h) around the creation, sort, scan and teardown
+// phases of ATL, STL and POL, and prints joules and nJ per string for each meter.
+// Fewer allocations and less memory traffic should show up as less energy, DRAM
+// energy especially.
+//
+// The meters count the energy of the whole package (or of all the DRAM), other cores
+// and idle power included: run on a quiet machine, and with enough /runs that each
+// phase spans many updates of the counters (about 1 ms for RAPL).
+//
+// When no meter is readable, the benchmark says so and is skipped.
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <iostream>     // std::cout
+#include <string>       // std::string, std::wstring
+#include <vector>       // std::vector
+
+#include <windows.h>    // Windows SDK API
+
+#include "Contenders.h"         // ATL, STL and POL contenders
+#include "EnergyMeter.h"        // RAPL energy counters
+#include "BenchmarkCommon.h"    // Common benchmark helpers
+#include "Benchmarks.h"         // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+using std::wstring;
+
+
+namespace
+{
+
+#ifdef _DEBUG
+constexpr unsigned long long kDefaultRuns = 1;
+#else
+constexpr unsigned long long kDefaultRuns = 5;
+#endif // _DEBUG
+
+
+enum
+{
+    kPhaseCreation,
+    kPhaseSort,
+    kPhaseScan,
+    kPhaseTeardown,
+    kPhaseCount
+};
+
+const char* const kPhaseNames[kPhaseCount] = { "creation", "sort", "scan", "teardown" };
+
+
+//---------------------------------------------------------------------------------------
+// Time and energy spent in the phases, summed over the runs
+//---------------------------------------------------------------------------------------
+struct PhaseEnergy
+{
+    long long           ticks = 0;
+    vector<double>      joules;             // One per meter channel
+    unsigned long long  meteredRuns = 0;    // Runs whose joules are counted
+};
+
+
+//---------------------------------------------------------------------------------------
+// Read the meters and the performance counter at a phase boundary; add the time and
+// energy since the previous boundary to the phase that just ended (if any).
+// The energy of a phase is only counted when the meters were read at both its ends:
+// a failed reading leaves the phase unmetered for that run, and the previous reading
+// stays as the last good one.
+//---------------------------------------------------------------------------------------
+class CPhaseMeter
+{
+public:
+    CPhaseMeter(const CEnergyMeters& meters, PhaseEnergy (&phases)[kPhaseCount])
+        : m_meters(meters)
+        , m_phases(phases)
+        , m_ticks(PerfCounter())
+        , m_bMetered(meters.ReadJoules(m_joules))
+    {
+    }
+
+    void EndPhase(int phase)
+    {
+        vector<double> joules;
+        const bool bRead = m_meters.ReadJoules(joules);
+        const long long ticks = PerfCounter();
+
+        PhaseEnergy& energy = m_phases[phase];
+        energy.ticks += ticks - m_ticks;
+        if (bRead && m_bMetered)
+        {
+            energy.joules.resize(joules.size());
+            for (size_t channel = 0; channel < joules.size(); ++channel)
+            {
+                energy.joules[channel] += joules[channel] - m_joules[channel];
+            }
+            ++energy.meteredRuns;
+        }
+
+        GetTimelineTracer().RecordComplete(kPhaseNames[phase], m_ticks, ticks);
+        m_ticks = ticks;
+        if (bRead)
+        {
+            m_joules.swap(joules);
+        }
+        m_bMetered = bRead;
+    }
+
+private:
+    const CEnergyMeters&    m_meters;
+    PhaseEnergy             (&m_phases)[kPhaseCount];
+    long long               m_ticks;
+    vector<double>          m_joules;       // Last good reading
+    bool                    m_bMetered;     // Was the last reading good?
+};
+
+
+//---------------------------------------------------------------------------------------
+// Run the phases of a contender runCount times, reading the meters around each phase,
+// and print the time and energy of each phase; return the checksum of the scans
+//---------------------------------------------------------------------------------------
+template <typename Strings>
+unsigned long long MeasureEnergy(const char* name, const CEnergyMeters& meters,
+                                 const vector<const wchar_t*>& source, unsigned long long runCount)
+{
+    PhaseEnergy phases[kPhaseCount];
+    unsigned long long checksum = 0;
+
+    for (unsigned long long run = 0; run < runCount; ++run)
+    {
+        Strings strings;
+
+        CPhaseMeter phaseMeter(meters, phases);
+        strings.Create(source);
+        phaseMeter.EndPhase(kPhaseCreation);
+        strings.Sort();
+        phaseMeter.EndPhase(kPhaseSort);
+        checksum += strings.Scan();
+        phaseMeter.EndPhase(kPhaseScan);
+        strings.Clear();
+        phaseMeter.EndPhase(kPhaseTeardown);
+    }
+
+    const auto& channelNames = meters.GetChannelNames();
+    for (int phase = 0; phase < kPhaseCount; ++phase)
+    {
+        const PhaseEnergy& energy = phases[phase];
+        cout << name << ' ' << kPhaseNames[phase] << ": "
+             << energy.ticks * 1000.0 / PerfFrequency() / runCount << " ms per run";
+        if (energy.meteredRuns == 0)
+        {
+            cout << ", energy unavailable (the meters couldn't be read)\n";
+            continue;
+        }
+
+        // Energy per run and per string over the metered runs only
+        const double stringCount = static_cast<double>(source.size()) * energy.meteredRuns;
+        for (size_t channel = 0; channel < channelNames.size(); ++channel)
+        {
+            cout << ", " << channelNames[channel] << ' ' << energy.joules[channel] / energy.meteredRuns << " J ("
+                 << energy.joules[channel] * 1e9 / stringCount << " nJ/string)";
+        }
+        if (energy.meteredRuns < runCount)
+        {
+            cout << " (energy over " << energy.meteredRuns << " of " << runCount
+                 << " runs: the meters couldn't be read in the others)";
+        }
+        cout << '\n';
+    }
+
+    return checksum;
+}
+
+} // namespace
+
+
+int RunEnergyBenchmark(const CCommandLine& cmdLine)
+{
+    const unsigned long long runCount = cmdLine.GetNumber(L"/runs", kDefaultRuns);
+    if (runCount == 0)
+    {
+        cout << "/runs must be at least 1.\n";
+        return 1;
+    }
+
+    const CEnergyMeters meters;
+    if (!meters.IsAvailable())
+    {
+        cout << "=== Energy === \n"
+             << "No readable energy meter (the Energy Meter Interface needs Windows 10 1809 or later, "
+             << "RAPL support, and usually administrator rights): skipped.\n";
+        return 0;
+    }
+
+    const auto shuffled = BuildShuffledStrings();
+    const auto shuffled_ptrs = BuildStringPointers(shuffled);
+
+    cout << "=== Energy (" << shuffled_ptrs.size() << " strings, " << runCount << " runs, per run) === \n";
+    cout << "Meters:";
+    for (const auto& channelName : meters.GetChannelNames())
+    {
+        cout << ' ' << channelName;
+    }
+    cout << '\n';
+
+    const unsigned long long atlChecksum = MeasureEnergy<AtlStrings>("ATL", meters, shuffled_ptrs, runCount);
+    const unsigned long long stlChecksum = MeasureEnergy<StlStrings>("STL", meters, shuffled_ptrs, runCount);
+    const unsigned long long poolChecksum = MeasureEnergy<PooledStrings>("POL", meters, shuffled_ptrs, runCount);
+
+    if (atlChecksum != stlChecksum || stlChecksum != poolChecksum)
+    {
+        cout << "Checksum mismatch!\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Energy Meters: cumulative energy counters (e.g. RAPL package and DRAM domains) read
+// through the Windows Energy Meter Interface
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <memory>       // std::unique_ptr
+#include <string>       // std::string
+#include <utility>      // std::move
+#include <vector>       // std::vector
+
+#include <atlbase.h>    // CHandle
+
+#include <Windows.h>    // Windows Platform SDK
+#include <SetupAPI.h>   // SetupDiGetClassDevs, SetupDiEnumDeviceInterfaces
+#include <emi.h>        // Energy Meter Interface IOCTLs
+
+
+//---------------------------------------------------------------------------------------
+// Energy Meters
+//
+// On Windows, the RAPL energy counters of Intel and AMD processors (and other metered
+// rails) are exposed as Energy Meter Interface (EMI) devices, each with one or more
+// channels, e.g. "RAPL_Package0_PKG" and "RAPL_Package0_DRAM". Each channel counts the
+// energy used since boot, in picowatt-hours.
+//
+// All the channels of all the meters are opened; meters that can't be opened or read
+// (EMI needs Windows 10 1809 or later, hardware support, and usually administrator
+// rights) are skipped, so the meters may well be unavailable: check IsAvailable.
+//---------------------------------------------------------------------------------------
+class CEnergyMeters
+{
+public:
+    // Open the energy meters of the machine; never fail, see IsAvailable
+    CEnergyMeters();
+
+    // Is at least one channel readable?
+    bool IsAvailable() const noexcept;
+
+    // Names of the channels, e.g. "RAPL_Package0_DRAM"
+    const std::vector<std::string>& GetChannelNames() const noexcept;
+
+    // Read the energy counted by each channel, in joules, since an arbitrary origin (take
+    // the difference of two readings). Return false, leaving joules unchanged, if a meter
+    // can't be read.
+    bool ReadJoules(std::vector<double>& joules) const;
+
+
+    //
+    // Ban Copy
+    //
+private:
+    CEnergyMeters(const CEnergyMeters&) = delete;
+    CEnergyMeters& operator=(const CEnergyMeters&) = delete;
+
+
+    //
+    // IMPLEMENTATION
+    //
+private:
+    // 1 pWh = 3600e-12 J
+    static constexpr double kJoulesPerPicowattHour = 3.6e-9;
+
+    struct Meter
+    {
+        ATL::CHandle    device;
+        size_t          channelCount;
+    };
+
+    std::vector<std::unique_ptr<Meter>> m_meters;
+    std::vector<std::string>            m_channelNames;
+
+    void OpenMeter(const wchar_t* devicePath);
+
+    static std::string NarrowName(const WCHAR* pch, size_t cch);
+};
+
+
+//=======================================================================================
+//                          Inline Method Implementations
+//=======================================================================================
+
+inline CEnergyMeters::CEnergyMeters()
+{
+    const HDEVINFO hDevInfo = SetupDiGetClassDevsW(&GUID_DEVICE_ENERGY_METER, nullptr, nullptr,
+                                                   DIGCF_PRESENT | DIGCF_DEVICEINTERFACE);
+    if (hDevInfo == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+
+    SP_DEVICE_INTERFACE_DATA interfaceData = {};
+    interfaceData.cbSize = sizeof(interfaceData);
+    for (DWORD index = 0;
+         SetupDiEnumDeviceInterfaces(hDevInfo, nullptr, &GUID_DEVICE_ENERGY_METER, index, &interfaceData);
+         ++index)
+    {
+        DWORD cbDetail = 0;
+        SetupDiGetDeviceInterfaceDetailW(hDevInfo, &interfaceData, nullptr, 0, &cbDetail, nullptr);
+        if (cbDetail < sizeof(SP_DEVICE_INTERFACE_DETAIL_DATA_W))
+        {
+            continue;
+        }
+
+        std::vector<BYTE> detailBuffer(cbDetail);
+        auto* const pDetail = reinterpret_cast<SP_DEVICE_INTERFACE_DETAIL_DATA_W*>(detailBuffer.data());
+        pDetail->cbSize = sizeof(SP_DEVICE_INTERFACE_DETAIL_DATA_W);
+        if (SetupDiGetDeviceInterfaceDetailW(hDevInfo, &interfaceData, pDetail, cbDetail, nullptr, nullptr))
+        {
+            OpenMeter(pDetail->DevicePath);
+        }
+    }
+
+    SetupDiDestroyDeviceInfoList(hDevInfo);
+}
+
+
+inline bool CEnergyMeters::IsAvailable() const noexcept
+{
+    return !m_channelNames.empty();
+}
+
+
+inline const std::vector<std::string>& CEnergyMeters::GetChannelNames() const noexcept
+{
+    return m_channelNames;
+}
+
+
+inline bool CEnergyMeters::ReadJoules(std::vector<double>& joules) const
+{
+    std::vector<double> reading;
+    reading.reserve(m_channelNames.size());
+
+    for (const auto& pMeter : m_meters)
+    {
+        // V1 meters have a single channel, whose data is laid out as a V2 channel
+        std::vector<EMI_CHANNEL_MEASUREMENT_DATA> data(pMeter->channelCount);
+        DWORD cbReturned = 0;
+        if (!DeviceIoControl(pMeter->device, IOCTL_EMI_GET_MEASUREMENT, nullptr, 0,
+                             data.data(), static_cast<DWORD>(data.size() * sizeof(data[0])),
+                             &cbReturned, nullptr))
+        {
+            return false;
+        }
+
+        for (const auto& channel : data)
+        {
+            reading.push_back(channel.AbsoluteEnergy * kJoulesPerPicowattHour);
+        }
+    }
+
+    joules.swap(reading);
+    return true;
+}
+
+
+inline void CEnergyMeters::OpenMeter(const wchar_t* devicePath)
+{
+    std::unique_ptr<Meter> pMeter(new Meter);
+    pMeter->device.Attach(CreateFileW(devicePath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                      nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+    if (pMeter->device == INVALID_HANDLE_VALUE)
+    {
+        pMeter->device.Detach();
+        return;
+    }
+
+    EMI_VERSION version = {};
+    EMI_METADATA_SIZE metadataSize = {};
+    DWORD cbReturned = 0;
+    if (!DeviceIoControl(pMeter->device, IOCTL_EMI_GET_VERSION, nullptr, 0,
+                         &version, sizeof(version), &cbReturned, nullptr)
+        || !DeviceIoControl(pMeter->device, IOCTL_EMI_GET_METADATA_SIZE, nullptr, 0,
+                            &metadataSize, sizeof(metadataSize), &cbReturned, nullptr))
+    {
+        return;
+    }
+
+    std::vector<BYTE> metadata(metadataSize.MetadataSize);
+    if (!DeviceIoControl(pMeter->device, IOCTL_EMI_GET_METADATA, nullptr, 0,
+                         metadata.data(), static_cast<DWORD>(metadata.size()), &cbReturned, nullptr))
+    {
+        return;
+    }
+
+    if (version.EmiVersion == EMI_VERSION_V1)
+    {
+        const auto* const pMetadata = reinterpret_cast<const EMI_METADATA_V1*>(metadata.data());
+        if (pMetadata->MeasurementUnit != EmiMeasurementUnitPicowattHours)
+        {
+            return;
+        }
+        m_channelNames.push_back(NarrowName(pMetadata->MeteredHardwareName,
+                                            pMetadata->MeteredHardwareNameSize / sizeof(WCHAR)));
+        pMeter->channelCount = 1;
+    }
+    else if (version.EmiVersion == EMI_VERSION_V2)
+    {
+        const auto* const pMetadata = reinterpret_cast<const EMI_METADATA_V2*>(metadata.data());
+        const EMI_CHANNEL_V2* pChannel = pMetadata->Channels;
+        for (USHORT i = 0; i < pMetadata->ChannelCount; ++i)
+        {
+            // Picowatt-hours are the only unit defined for V2 channels
+            m_channelNames.push_back(NarrowName(pChannel->ChannelName, pChannel->ChannelNameSize / sizeof(WCHAR)));
+            pChannel = EMI_CHANNEL_V2_NEXT_CHANNEL(pChannel);
+        }
+        pMeter->channelCount = pMetadata->ChannelCount;
+    }
+    else
+    {
+        return;
+    }
+
+    m_meters.push_back(std::move(pMeter));
+}
+
+
+inline std::string CEnergyMeters::NarrowName(const WCHAR* pch, size_t cch)
+{
+    std::string name;
+    for (size_t i = 0; i < cch && pch[i] != L'\0'; ++i)
+    {
+        name += (pch[i] < 0x80) ? static_cast<char>(pch[i]) : '?';
+    }
+    return name;
+}
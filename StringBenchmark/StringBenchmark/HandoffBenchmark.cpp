@@ -0,0 +1,338 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Cross-Thread Handoff Benchmark
+//
+// A producer thread creates strings and hands them over a lock-free SPSC ring to a
+// consumer thread, which reads and then releases them:
+//
+//  - STL: each std::wstring is allocated on the producer and deleted on the consumer,
+//         which exercises the heap's remote-free path
+//  - POL: strings are allocated from a CStringPoolAllocator owned by the producer; every
+//         /retire:N strings the whole pool is handed over as well, and the consumer
+//         retires it at once after it has consumed its strings
+//
+// The main thread samples the throughput and the process memory while the pair runs,
+// and prints them as a time series.
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <atomic>       // std::atomic
+#include <iostream>     // std::cout
+#include <string>       // std::wstring
+#include <thread>       // std::thread
+#include <vector>       // std::vector
+
+#include <wchar.h>      // wcslen
+
+#include <windows.h>    // Windows SDK API
+
+#include "StringPool.h"         // Custom string pool allocator
+#include "SpscRing.h"           // Lock-free SPSC ring
+#include "BenchmarkCommon.h"    // Common benchmark helpers
+#include "BenchmarkEnvironment.h"   // Thread pinning
+#include "Benchmarks.h"         // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+using std::wstring;
+
+
+namespace
+{
+
+struct HandoffOptions
+{
+    unsigned    passes;         // Times the producer goes through the whole corpus
+    unsigned    intervalMs;     // Sampling period of the time series
+    size_t      retireCount;    // Strings per pool generation (POL)
+    size_t      ringCapacity;   // Items in flight between producer and consumer
+};
+
+// One point of the time series
+struct HandoffSample
+{
+    double          ms;         // Time since the start
+    ULONGLONG       consumed;   // Strings consumed so far
+    ProcessMemory   memory;
+};
+
+// State shared by the producer, the consumer and the sampling thread
+struct HandoffProgress
+{
+    std::atomic<ULONGLONG>  consumed;
+    std::atomic<bool>       bDone;
+};
+
+// The consumer publishes its progress every so many strings
+constexpr ULONGLONG kProgressStep = 4096;
+
+
+template <typename T>
+void PushSpin(CSpscRing<T>& ring, const T& item) noexcept
+{
+    while (!ring.TryPush(item))
+    {
+        YieldProcessor();
+    }
+}
+
+template <typename T>
+T PopSpin(CSpscRing<T>& ring) noexcept
+{
+    T item;
+    while (!ring.TryPop(item))
+    {
+        YieldProcessor();
+    }
+    return item;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Run the producer and the consumer on their own threads, sample the progress and the
+// memory from the calling thread, and print the time series.
+//
+// produce() pushes the items and a final end marker; consume(progress) pops and releases
+// them, updating progress.consumed, until it sees the end marker. Both return the sum of
+// the lengths of the strings they produced/consumed, as a checksum.
+//---------------------------------------------------------------------------------------
+template <typename Produce, typename Consume>
+bool RunHandoff(const char* name, const HandoffOptions& options,
+                const Produce& produce, const Consume& consume)
+{
+    cout << "--- " << name << " ---\n";
+
+    HandoffProgress progress;
+    progress.consumed.store(0);
+    progress.bDone.store(false);
+
+    vector<HandoffSample> samples;
+    const ProcessMemory baseline = GetProcessMemory();
+    samples.push_back(HandoffSample{ 0.0, 0, baseline });
+
+    ULONGLONG producedChecksum = 0;
+    ULONGLONG consumedChecksum = 0;
+
+    const long long start = PerfCounter();
+
+    // The main thread mostly sleeps between samples
+    std::thread consumer([&]
+    {
+        PinBenchmarkThread(1);
+        consumedChecksum = consume(progress);
+        progress.bDone.store(true);
+    });
+    std::thread producer([&]
+    {
+        PinBenchmarkThread(0);
+        producedChecksum = produce();
+    });
+
+    while (!progress.bDone.load())
+    {
+        Sleep(options.intervalMs);
+        samples.push_back(HandoffSample{
+            (PerfCounter() - start) * 1000.0 / PerfFrequency(),
+            progress.consumed.load(std::memory_order_relaxed),
+            GetProcessMemory() });
+    }
+
+    producer.join();
+    consumer.join();
+
+    const long long finish = PerfCounter();
+    const double totalMs = (finish - start) * 1000.0 / PerfFrequency();
+    const ULONGLONG totalConsumed = progress.consumed.load();
+
+    //
+    // Time series: the throughput is measured over each sampling interval
+    //
+    cout << "    ms   M strings/s   WS MB   Private MB\n";
+    ULONGLONG cbPeakWorkingSet = baseline.cbWorkingSet;
+    for (size_t i = 1; i < samples.size(); ++i)
+    {
+        const HandoffSample& prev = samples[i - 1];
+        const HandoffSample& curr = samples[i];
+        const double rate = (curr.ms > prev.ms)
+            ? (curr.consumed - prev.consumed) / (curr.ms - prev.ms) / 1000.0
+            : 0.0;
+
+        cout << "  " << curr.ms << "  " << rate << "  "
+             << curr.memory.cbWorkingSet / kMB << "  " << curr.memory.cbPrivate / kMB << '\n';
+
+        if (curr.memory.cbWorkingSet > cbPeakWorkingSet)
+        {
+            cbPeakWorkingSet = curr.memory.cbWorkingSet;
+        }
+    }
+
+    cout << name << ": " << totalMs << " ms, "
+         << totalConsumed / totalMs / 1000.0 << " M strings/s, "
+         << "peak working set growth " << (cbPeakWorkingSet - baseline.cbWorkingSet) / kMB << " MB\n\n";
+
+    if (producedChecksum != consumedChecksum)
+    {
+        cout << name << ": consumer checksum mismatch!\n";
+        return false;
+    }
+    return true;
+}
+
+
+//---------------------------------------------------------------------------------------
+// STL: one heap allocation per string, freed by the consumer thread
+//---------------------------------------------------------------------------------------
+bool RunStlHandoff(const HandoffOptions& options, const vector<const wchar_t*>& source)
+{
+    // nullptr marks the end of the stream
+    CSpscRing<wstring*> ring(options.ringCapacity);
+
+    auto produce = [&]() -> ULONGLONG
+    {
+        ULONGLONG checksum = 0;
+        for (unsigned pass = 0; pass < options.passes; ++pass)
+        {
+            for (const wchar_t* psz : source)
+            {
+                wstring* pstr = new wstring(psz);
+                checksum += pstr->size();
+                PushSpin(ring, pstr);
+            }
+        }
+        PushSpin<wstring*>(ring, nullptr);
+        return checksum;
+    };
+
+    auto consume = [&](HandoffProgress& progress) -> ULONGLONG
+    {
+        ULONGLONG checksum = 0;
+        ULONGLONG consumed = 0;
+        for (;;)
+        {
+            wstring* const pstr = PopSpin(ring);
+            if (pstr == nullptr)
+            {
+                break;
+            }
+
+            checksum += wcslen(pstr->c_str());
+            delete pstr;
+
+            if (++consumed % kProgressStep == 0)
+            {
+                progress.consumed.store(consumed, std::memory_order_relaxed);
+            }
+        }
+        progress.consumed.store(consumed);
+        return checksum;
+    };
+
+    return RunHandoff("STL", options, produce, consume);
+}
+
+
+//---------------------------------------------------------------------------------------
+// POL: pooled strings, with the pool handed over and retired as a whole
+//---------------------------------------------------------------------------------------
+
+// Either a string, or a pool whose strings have all been sent before it;
+// both null at the end of the stream
+struct PooledItem
+{
+    const wchar_t*          psz;
+    CStringPoolAllocator*   pRetiredPool;
+};
+
+bool RunPooledHandoff(const HandoffOptions& options, const vector<const wchar_t*>& source)
+{
+    CSpscRing<PooledItem> ring(options.ringCapacity);
+
+    auto produce = [&]() -> ULONGLONG
+    {
+        ULONGLONG checksum = 0;
+        CStringPoolAllocator* pPool = new CStringPoolAllocator();
+        size_t allocatedCount = 0;
+
+        for (unsigned pass = 0; pass < options.passes; ++pass)
+        {
+            for (const wchar_t* psz : source)
+            {
+                const wchar_t* const pszPooled = pPool->AllocString(psz);
+                checksum += wcslen(psz);
+                PushSpin(ring, PooledItem{ pszPooled, nullptr });
+
+                if (++allocatedCount == options.retireCount)
+                {
+                    // Hand the pool over: the consumer owns it from now on
+                    PushSpin(ring, PooledItem{ nullptr, pPool });
+                    pPool = new CStringPoolAllocator();
+                    allocatedCount = 0;
+                }
+            }
+        }
+
+        PushSpin(ring, PooledItem{ nullptr, pPool });
+        PushSpin(ring, PooledItem{ nullptr, nullptr });
+        return checksum;
+    };
+
+    auto consume = [&](HandoffProgress& progress) -> ULONGLONG
+    {
+        ULONGLONG checksum = 0;
+        ULONGLONG consumed = 0;
+        for (;;)
+        {
+            const PooledItem item = PopSpin(ring);
+            if (item.psz != nullptr)
+            {
+                checksum += wcslen(item.psz);
+                if (++consumed % kProgressStep == 0)
+                {
+                    progress.consumed.store(consumed, std::memory_order_relaxed);
+                }
+            }
+            else if (item.pRetiredPool != nullptr)
+            {
+                delete item.pRetiredPool;
+            }
+            else
+            {
+                break;
+            }
+        }
+        progress.consumed.store(consumed);
+        return checksum;
+    };
+
+    return RunHandoff("POL", options, produce, consume);
+}
+
+} // namespace
+
+
+int RunHandoffBenchmark(const CCommandLine& cmdLine)
+{
+    HandoffOptions options;
+    options.passes       = static_cast<unsigned>(cmdLine.GetNumber(L"/passes", 5));
+    options.intervalMs   = static_cast<unsigned>(cmdLine.GetNumber(L"/interval", 200));
+    options.retireCount  = static_cast<size_t>(cmdLine.GetNumber(L"/retire", 64 * 1024));
+    options.ringCapacity = static_cast<size_t>(cmdLine.GetNumber(L"/ring", 4096));
+    if (options.passes == 0 || options.intervalMs == 0 || options.retireCount == 0)
+    {
+        cout << "/passes, /interval and /retire must be at least 1.\n";
+        return 1;
+    }
+
+    cout << "=== Cross-Thread Handoff (" << options.passes << " passes, retire every "
+         << options.retireCount << " strings) === \n";
+
+    const auto shuffled = BuildShuffledStrings();
+    const auto shuffled_ptrs = BuildStringPointers(shuffled);
+
+    const bool succeeded = RunStlHandoff(options, shuffled_ptrs)
+                        && RunPooledHandoff(options, shuffled_ptrs);
+
+    return succeeded ? 0 : 1;
+}
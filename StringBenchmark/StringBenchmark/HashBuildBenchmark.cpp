@@ -0,0 +1,128 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Hash Set Build Benchmark
+//
+// Builds a hash set over all the pooled strings in three ways:
+//
+//  - single-threaded CStringHashSet
+//  - CConcurrentStringHashSet, filled by all the threads at once
+//  - CPartitionedStringHashSet: radix-partitioned two-pass build, with no synchronization
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <atomic>       // std::atomic
+#include <iostream>     // std::cout
+#include <vector>       // std::vector
+
+#include <windows.h>    // Windows SDK API
+
+#include "StringPool.h"         // Custom string pool allocator
+#include "StringHashTable.h"    // Hash sets over pooled strings
+#include "ThreadPool.h"         // Work-stealing thread pool
+#include "BenchmarkCommon.h"    // Common benchmark helpers
+#include "BenchmarkEnvironment.h"   // Thread pinning
+#include "Benchmarks.h"         // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+
+
+namespace
+{
+
+// Check that every key is found; return false (and print a message) otherwise
+template <typename Set>
+bool VerifyAll(const Set& set, const vector<PCWSTR>& keys, const char* name)
+{
+    for (PCWSTR psz : keys)
+    {
+        if (!set.Contains(psz, HashString(psz)))
+        {
+            cout << name << ": lookup failed!\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+
+int RunHashBuildBenchmark(const CCommandLine& cmdLine)
+{
+    // Pool workers are benchmark threads #1.., pinned with /pin
+    const unsigned requestedThreads = static_cast<unsigned>(cmdLine.GetNumber(L"/threads", 0));
+    CWorkStealingThreadPool threadPool(requestedThreads != 0 ? requestedThreads : GetDefaultThreadCount(),
+                                       PinBenchmarkThread);
+    const unsigned partitionBits = static_cast<unsigned>(cmdLine.GetNumber(L"/partition-bits", 8));
+    if (partitionBits < 1 || partitionBits > 16)
+    {
+        cout << "/partition-bits must be in [1, 16].\n";
+        return 1;
+    }
+
+    cout << "=== Hash Set Build (" << threadPool.GetThreadCount() << " threads, "
+         << (1u << partitionBits) << " partitions) === \n";
+
+    // Pooled keys
+    CStringPoolAllocator stringPool;
+    vector<PCWSTR> keys;
+    {
+        const auto shuffled = BuildShuffledStrings();
+        keys.reserve(shuffled.size());
+        for (const auto& s : shuffled)
+        {
+            keys.push_back(stringPool.AllocString(s.c_str()));
+        }
+    }
+    const size_t count = keys.size();
+
+    long long start = 0;
+    long long finish = 0;
+
+    //
+    // Single-threaded build
+    //
+    start = PerfCounter();
+    CStringHashSet singleSet(count);
+    for (PCWSTR psz : keys)
+    {
+        singleSet.Insert(psz);
+    }
+    finish = PerfCounter();
+    PrintTime(start, finish, "Single-threaded");
+
+    //
+    // Concurrent build: all threads insert into the same table
+    //
+    start = PerfCounter();
+    CConcurrentStringHashSet concurrentSet(count);
+    threadPool.ParallelFor(0, count, 4096, [&](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; ++i)
+        {
+            concurrentSet.Insert(keys[i], HashString(keys[i]));
+        }
+    });
+    finish = PerfCounter();
+    PrintTime(start, finish, "Concurrent");
+
+    //
+    // Radix-partitioned build
+    //
+    start = PerfCounter();
+    CPartitionedStringHashSet partitionedSet;
+    partitionedSet.Build(threadPool, keys.data(), count, partitionBits);
+    finish = PerfCounter();
+    PrintTime(start, finish, "Partitioned");
+
+    const bool succeeded = VerifyAll(singleSet, keys, "Single-threaded")
+                        && VerifyAll(concurrentSet, keys, "Concurrent")
+                        && VerifyAll(partitionedSet, keys, "Partitioned")
+                        && singleSet.GetSize() == count
+                        && partitionedSet.GetSize() == count;
+
+    return succeeded ? 0 : 1;
+}
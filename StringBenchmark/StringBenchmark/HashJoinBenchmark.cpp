@@ -0,0 +1,365 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Hash-Join Benchmark
+//
+// Joins two string-keyed relations: a build relation R(key, payload) with unique keys,
+// and a probe relation S(key), whose keys match R with probability /overlap:percent and
+// are drawn from R's keys with a Zipf(/skew:theta) distribution (0 = uniform).
+// For each match, R's payload is summed up.
+//
+//  - STL:   std::unordered_map<std::wstring, payload> built over R, probed with S
+//  - POL:   flat open-addressing table over pooled keys (hash, pointer, payload)
+//  - Merge: sort-merge join over the pooled keys, sorted as in the POL sort phase
+//           (std::sort with wcscmp)
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::sort, std::shuffle, std::lower_bound
+#include <cmath>        // std::pow
+#include <iostream>     // std::cout
+#include <random>       // std::mt19937, distributions
+#include <string>       // std::wstring, std::to_wstring
+#include <unordered_map>    // std::unordered_map
+#include <utility>      // std::pair
+#include <vector>       // std::vector
+
+#include <wchar.h>      // wcscmp
+
+#include <windows.h>    // Windows SDK API
+
+#include "StringPool.h"         // Custom string pool allocator
+#include "StringHashTable.h"    // HashString
+#include "BenchmarkCommon.h"    // Common benchmark helpers
+#include "Benchmarks.h"         // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+using std::wstring;
+
+
+namespace
+{
+
+#ifdef _DEBUG
+constexpr unsigned long long kDefaultBuildCount = 1000;
+constexpr unsigned long long kDefaultProbeCount = 4000;
+#else
+constexpr unsigned long long kDefaultBuildCount = 1000 * 1000;      // 1M
+constexpr unsigned long long kDefaultProbeCount = 4 * 1000 * 1000;  // 4M
+#endif // _DEBUG
+
+
+// Result of a join: number of matching probe tuples, and the sum of their build payloads
+struct JoinResult
+{
+    ULONGLONG   matches;
+    ULONGLONG   payloadSum;
+
+    bool operator==(const JoinResult& other) const noexcept
+    {
+        return matches == other.matches && payloadSum == other.payloadSum;
+    }
+};
+
+void PrintJoin(const char* name, long long start, long long built, long long finish,
+               size_t probeCount, const JoinResult& result)
+{
+    const double totalSeconds = static_cast<double>(finish - start) / PerfFrequency();
+    cout << name << ": build " << (built - start) * 1000.0 / PerfFrequency() << " ms, "
+         << "probe " << (finish - built) * 1000.0 / PerfFrequency() << " ms; "
+         << "total " << totalSeconds * 1000.0 << " ms, "
+         << probeCount / totalSeconds / 1e6 << " M probe tuples/s, "
+         << result.matches << " matches\n";
+}
+
+
+//---------------------------------------------------------------------------------------
+// Relations
+//---------------------------------------------------------------------------------------
+
+struct Relations
+{
+    vector<wstring>     buildKeys;      // Unique
+    vector<ULONGLONG>   buildPayloads;
+    vector<wstring>     probeKeys;
+};
+
+Relations GenerateRelations(size_t buildCount, size_t probeCount, unsigned overlapPercent, double skew)
+{
+    const wchar_t* const suffixes[] =
+    {
+        L" -- Lorem ipsum dolor sit amet",
+        L" -- consectetuer adipiscing elit",
+        L" -- Maecenas porttitor congue massa",
+        L" -- Fusce posuere, magna sed pulvinar"
+    };
+    constexpr size_t kSuffixCount = sizeof(suffixes) / sizeof(suffixes[0]);
+
+    std::mt19937 prng(2019);
+
+    Relations relations;
+    relations.buildKeys.reserve(buildCount);
+    relations.buildPayloads.reserve(buildCount);
+    for (size_t i = 0; i < buildCount; ++i)
+    {
+        relations.buildKeys.push_back(L"Customer #" + std::to_wstring(i) + suffixes[i % kSuffixCount]);
+        relations.buildPayloads.push_back(prng() % 1000);
+    }
+
+    // Zipf ranks are mapped to random build keys, so that the hot keys are spread around
+    vector<size_t> rankToKey(buildCount);
+    for (size_t i = 0; i < buildCount; ++i)
+    {
+        rankToKey[i] = i;
+    }
+    std::shuffle(rankToKey.begin(), rankToKey.end(), prng);
+
+    // Cumulative Zipf distribution: P(rank k) ~ 1 / (k + 1)^skew
+    vector<double> cdf(buildCount);
+    double total = 0.0;
+    for (size_t k = 0; k < buildCount; ++k)
+    {
+        total += 1.0 / std::pow(static_cast<double>(k + 1), skew);
+        cdf[k] = total;
+    }
+
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    relations.probeKeys.reserve(probeCount);
+    for (size_t i = 0; i < probeCount; ++i)
+    {
+        if (prng() % 100 < overlapPercent)
+        {
+            const size_t rank = std::lower_bound(cdf.begin(), cdf.end(), uniform(prng) * total) - cdf.begin();
+            relations.probeKeys.push_back(relations.buildKeys[rankToKey[(std::min)(rank, buildCount - 1)]]);
+        }
+        else
+        {
+            // Never in the build relation
+            relations.probeKeys.push_back(L"Prospect #" + std::to_wstring(i) + suffixes[i % kSuffixCount]);
+        }
+    }
+
+    return relations;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Flat open-addressing table over pooled keys, with a payload per key
+//---------------------------------------------------------------------------------------
+class CPooledJoinTable
+{
+public:
+    explicit CPooledJoinTable(size_t count)
+    {
+        size_t slotCount = 16;
+        while (slotCount < count * 2)
+        {
+            slotCount *= 2;
+        }
+        m_slots.resize(slotCount);
+    }
+
+    // Keys must be unique
+    void Insert(PCWSTR psz, ULONGLONG payload) noexcept
+    {
+        const ULONGLONG hash = HashString(psz);
+        const size_t mask = m_slots.size() - 1;
+        size_t i = static_cast<size_t>(hash) & mask;
+        while (m_slots[i].hash != 0)
+        {
+            i = (i + 1) & mask;
+        }
+        m_slots[i] = Slot{ hash, psz, payload };
+    }
+
+    // Return true and the payload if the key is present
+    bool Find(PCWSTR psz, ULONGLONG& payload) const noexcept
+    {
+        const ULONGLONG hash = HashString(psz);
+        const size_t mask = m_slots.size() - 1;
+        for (size_t i = static_cast<size_t>(hash) & mask; m_slots[i].hash != 0; i = (i + 1) & mask)
+        {
+            if (m_slots[i].hash == hash && wcscmp(m_slots[i].psz, psz) == 0)
+            {
+                payload = m_slots[i].payload;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    struct Slot
+    {
+        ULONGLONG   hash;       // 0 for empty slots
+        PCWSTR      psz;
+        ULONGLONG   payload;
+    };
+
+    vector<Slot>    m_slots;    // Power-of-two number of slots, load factor at most 1/2
+};
+
+
+//---------------------------------------------------------------------------------------
+// Joins
+//---------------------------------------------------------------------------------------
+
+JoinResult RunStlJoin(const Relations& relations)
+{
+    JoinResult result = {};
+
+    const long long start = PerfCounter();
+
+    std::unordered_map<wstring, ULONGLONG> table;
+    for (size_t i = 0; i < relations.buildKeys.size(); ++i)
+    {
+        table.emplace(relations.buildKeys[i], relations.buildPayloads[i]);
+    }
+    const long long built = PerfCounter();
+
+    for (const auto& key : relations.probeKeys)
+    {
+        const auto it = table.find(key);
+        if (it != table.end())
+        {
+            ++result.matches;
+            result.payloadSum += it->second;
+        }
+    }
+    const long long finish = PerfCounter();
+
+    PrintJoin("STL", start, built, finish, relations.probeKeys.size(), result);
+    return result;
+}
+
+JoinResult RunPooledHashJoin(const vector<PCWSTR>& buildKeys, const vector<ULONGLONG>& buildPayloads,
+                             const vector<PCWSTR>& probeKeys)
+{
+    JoinResult result = {};
+
+    const long long start = PerfCounter();
+
+    CPooledJoinTable table(buildKeys.size());
+    for (size_t i = 0; i < buildKeys.size(); ++i)
+    {
+        table.Insert(buildKeys[i], buildPayloads[i]);
+    }
+    const long long built = PerfCounter();
+
+    for (PCWSTR psz : probeKeys)
+    {
+        ULONGLONG payload = 0;
+        if (table.Find(psz, payload))
+        {
+            ++result.matches;
+            result.payloadSum += payload;
+        }
+    }
+    const long long finish = PerfCounter();
+
+    PrintJoin("POL", start, built, finish, probeKeys.size(), result);
+    return result;
+}
+
+// Here "build" is sorting both relations, and "probe" is merging them
+JoinResult RunSortMergeJoin(const vector<PCWSTR>& buildKeys, const vector<ULONGLONG>& buildPayloads,
+                            const vector<PCWSTR>& probeKeys)
+{
+    JoinResult result = {};
+
+    const long long start = PerfCounter();
+
+    vector<std::pair<PCWSTR, ULONGLONG>> build;
+    build.reserve(buildKeys.size());
+    for (size_t i = 0; i < buildKeys.size(); ++i)
+    {
+        build.emplace_back(buildKeys[i], buildPayloads[i]);
+    }
+    std::sort(build.begin(), build.end(),
+        [](const std::pair<PCWSTR, ULONGLONG>& t1, const std::pair<PCWSTR, ULONGLONG>& t2)
+        {
+            return wcscmp(t1.first, t2.first) < 0;
+        });
+
+    vector<PCWSTR> probe(probeKeys);
+    std::sort(probe.begin(), probe.end(), [](PCWSTR psz1, PCWSTR psz2) { return wcscmp(psz1, psz2) < 0; });
+    const long long sorted = PerfCounter();
+
+    // Build keys are unique: each run of equal probe keys matches at most one build tuple
+    size_t b = 0;
+    for (size_t p = 0; p < probe.size() && b < build.size(); )
+    {
+        const int cmp = wcscmp(probe[p], build[b].first);
+        if (cmp < 0)
+        {
+            ++p;
+        }
+        else if (cmp > 0)
+        {
+            ++b;
+        }
+        else
+        {
+            ++result.matches;
+            result.payloadSum += build[b].second;
+            ++p;
+        }
+    }
+    const long long finish = PerfCounter();
+
+    PrintJoin("Sort-merge", start, sorted, finish, probeKeys.size(), result);
+    return result;
+}
+
+} // namespace
+
+
+int RunHashJoinBenchmark(const CCommandLine& cmdLine)
+{
+    const size_t buildCount = static_cast<size_t>(cmdLine.GetNumber(L"/build", kDefaultBuildCount));
+    const size_t probeCount = static_cast<size_t>(cmdLine.GetNumber(L"/probe", kDefaultProbeCount));
+    const unsigned overlapPercent = static_cast<unsigned>(cmdLine.GetNumber(L"/overlap", 50));
+    const double skew = cmdLine.GetReal(L"/skew", 0.0);
+    if (buildCount == 0 || overlapPercent > 100 || skew < 0.0)
+    {
+        cout << "/build must be at least 1, /overlap in [0, 100], and /skew non-negative.\n";
+        return 1;
+    }
+
+    cout << "=== Hash Join (" << buildCount << " build x " << probeCount << " probe tuples, "
+         << overlapPercent << "% overlap, skew " << skew << ") === \n";
+
+    const Relations relations = GenerateRelations(buildCount, probeCount, overlapPercent, skew);
+
+    // Both relations loaded in a string pool, for the POL and sort-merge joins
+    const long long start = PerfCounter();
+    CStringPoolAllocator stringPool;
+    vector<PCWSTR> buildKeys;
+    vector<PCWSTR> probeKeys;
+    buildKeys.reserve(buildCount);
+    probeKeys.reserve(probeCount);
+    for (const auto& key : relations.buildKeys)
+    {
+        buildKeys.push_back(stringPool.AllocString(key.c_str()));
+    }
+    for (const auto& key : relations.probeKeys)
+    {
+        probeKeys.push_back(stringPool.AllocString(key.c_str()));
+    }
+    const long long finish = PerfCounter();
+    PrintTime(start, finish, "Loading the relations in the pool");
+
+    const JoinResult stlResult = RunStlJoin(relations);
+    const JoinResult poolResult = RunPooledHashJoin(buildKeys, relations.buildPayloads, probeKeys);
+    const JoinResult mergeResult = RunSortMergeJoin(buildKeys, relations.buildPayloads, probeKeys);
+
+    if (!(stlResult == poolResult && stlResult == mergeResult))
+    {
+        cout << "Join results mismatch!\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Hash Set Lookup Benchmark
+//
+// Looks up every string of a big CStringHashSet over pooled keys, in random order,
+// one at a time (Contains) vs. in batches with group prefetching (ContainsBatch).
+//
+// The queries are separate copies of the keys, so that each lookup may miss the cache
+// twice: on the hash set slot, and on the pooled key string.
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::shuffle, std::min
+#include <iostream>     // std::cout
+#include <memory>       // std::unique_ptr
+#include <random>       // std::mt19937
+#include <vector>       // std::vector
+
+#include <windows.h>    // Windows SDK API
+
+#include "StringPool.h"         // Custom string pool allocator
+#include "StringHashTable.h"    // Hash sets over pooled strings
+#include "BenchmarkCommon.h"    // Common benchmark helpers
+#include "Benchmarks.h"         // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+
+
+namespace
+{
+
+void PrintLookupRate(const char* name, long long start, long long finish, size_t lookups)
+{
+    const double seconds = static_cast<double>(finish - start) / PerfFrequency();
+    cout << name << ": " << (finish - start) * 1000.0 / PerfFrequency() << " ms, "
+         << lookups / seconds / 1e6 << " M lookups/s\n";
+}
+
+} // namespace
+
+
+int RunHashLookupBenchmark(const CCommandLine& cmdLine)
+{
+    // Number of queries handed to each ContainsBatch call
+    const size_t batchSize = static_cast<size_t>(cmdLine.GetNumber(L"/batch", 256));
+    if (batchSize == 0)
+    {
+        cout << "/batch must be at least 1.\n";
+        return 1;
+    }
+
+    cout << "=== Hash Set Lookup (batches of " << batchSize << ") === \n";
+
+    const auto shuffled = BuildShuffledStrings();
+
+    // Build the set over pooled keys
+    CStringPoolAllocator stringPool;
+    CStringHashSet set(shuffled.size());
+    for (const auto& s : shuffled)
+    {
+        set.Insert(stringPool.AllocString(s.c_str()));
+    }
+
+    // Queries: the original strings, in a different random order
+    auto queries = BuildStringPointers(shuffled);
+    std::mt19937 prng(2023);
+    std::shuffle(queries.begin(), queries.end(), prng);
+    const size_t count = queries.size();
+
+    long long start = 0;
+    long long finish = 0;
+
+    //
+    // One lookup at a time
+    //
+    size_t foundOneByOne = 0;
+    start = PerfCounter();
+    for (PCWSTR psz : queries)
+    {
+        if (set.Contains(psz))
+        {
+            ++foundOneByOne;
+        }
+    }
+    finish = PerfCounter();
+    PrintLookupRate("One at a time", start, finish, count);
+
+    //
+    // Batched lookups with group prefetching
+    //
+    std::unique_ptr<bool[]> results(new bool[batchSize]);
+    size_t foundBatched = 0;
+    start = PerfCounter();
+    for (size_t first = 0; first < count; first += batchSize)
+    {
+        const size_t n = (std::min)(batchSize, count - first);
+        set.ContainsBatch(&queries[first], n, results.get());
+        for (size_t i = 0; i < n; ++i)
+        {
+            foundBatched += results[i] ? 1 : 0;
+        }
+    }
+    finish = PerfCounter();
+    PrintLookupRate("Batched", start, finish, count);
+
+    if (foundOneByOne != count || foundBatched != count)
+    {
+        cout << "Lookups failed!\n";
+        return 1;
+    }
+
+    return 0;
+}
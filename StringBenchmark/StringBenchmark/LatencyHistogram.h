@@ -0,0 +1,235 @@
+#pragma once
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Latency Histogram: log-linear (HDR-style) histogram of per-call latencies, measured
+// in time stamp counter ticks
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <crtdbg.h>     // _ASSERTE
+#include <iostream>     // std::ostream
+
+#include <intrin.h>     // __rdtsc, _BitScanReverse
+
+#include <Windows.h>    // Windows Platform SDK
+
+
+//---------------------------------------------------------------------------------------
+// Time Stamp Counter Helpers
+//
+// __rdtsc is much cheaper than QueryPerformanceCounter, so it can time a single call of
+// a few ns. GetTscFrequency calibrates it against the performance counter, once.
+//---------------------------------------------------------------------------------------
+
+inline unsigned long long ReadTsc() noexcept
+{
+    return __rdtsc();
+}
+
+inline double GetTscFrequency() noexcept
+{
+    static const double s_frequency = []
+    {
+        LARGE_INTEGER frequency;
+        LARGE_INTEGER start;
+        LARGE_INTEGER finish;
+        QueryPerformanceFrequency(&frequency);
+
+        QueryPerformanceCounter(&start);
+        const unsigned long long tscStart = __rdtsc();
+        do
+        {
+            QueryPerformanceCounter(&finish);
+        } while (finish.QuadPart - start.QuadPart < frequency.QuadPart / 20);   // 50 ms
+        const unsigned long long tscFinish = __rdtsc();
+
+        return (tscFinish - tscStart) * static_cast<double>(frequency.QuadPart)
+               / (finish.QuadPart - start.QuadPart);
+    }();
+    return s_frequency;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Latency Histogram
+//
+// Values below 16 have a bucket each; above, each power of two is split into 16 linear
+// sub-buckets, so a value is known within 1/16 (6.25%) over the whole 64-bit range, in
+// under 8KB of counts. Record() is a bit scan and an increment.
+//
+// Percentiles are reported as the highest value of their bucket (never understated);
+// the maximum is exact.
+//---------------------------------------------------------------------------------------
+class CLatencyHistogram
+{
+public:
+    CLatencyHistogram() noexcept;
+
+    // Count a latency, in TSC ticks
+    void Record(unsigned long long ticks) noexcept;
+
+    // Forget all the latencies recorded
+    void Reset() noexcept;
+
+    unsigned long long GetCount() const noexcept;
+    unsigned long long GetMax() const noexcept;
+
+    // Latency (in TSC ticks) at or below which percentile% of the recorded latencies are,
+    // e.g. 99.9; 0 if nothing has been recorded
+    unsigned long long GetPercentile(double percentile) const noexcept;
+
+    // Print "message: p50 ... ns, p99 ... ns, p99.9 ... ns, max ... ns (N calls)"
+    void Print(std::ostream& os, const char* message) const;
+
+
+    //
+    // Ban Copy
+    //
+private:
+    CLatencyHistogram(const CLatencyHistogram&) = delete;
+    CLatencyHistogram& operator=(const CLatencyHistogram&) = delete;
+
+
+    //
+    // IMPLEMENTATION
+    //
+private:
+    enum
+    {
+        kSubBucketBits  = 4,
+        kSubBucketCount = 1 << kSubBucketBits,
+
+        // kSubBucketCount exact buckets, then kSubBucketCount per power of two
+        // from 2^kSubBucketBits to 2^63
+        kBucketCount    = kSubBucketCount + (64 - kSubBucketBits) * kSubBucketCount
+    };
+
+    unsigned long long  m_counts[kBucketCount];
+    unsigned long long  m_count;
+    unsigned long long  m_max;
+
+    static unsigned MostSignificantBit(unsigned long long value) noexcept;
+    static unsigned BucketIndex(unsigned long long ticks) noexcept;
+    static unsigned long long BucketHighestValue(unsigned index) noexcept;
+};
+
+
+//=======================================================================================
+//                          Inline Method Implementations
+//=======================================================================================
+
+inline CLatencyHistogram::CLatencyHistogram() noexcept
+{
+    Reset();
+}
+
+
+inline void CLatencyHistogram::Record(unsigned long long ticks) noexcept
+{
+    ++m_counts[BucketIndex(ticks)];
+    ++m_count;
+    if (ticks > m_max)
+    {
+        m_max = ticks;
+    }
+}
+
+
+inline void CLatencyHistogram::Reset() noexcept
+{
+    for (auto& count : m_counts)
+    {
+        count = 0;
+    }
+    m_count = 0;
+    m_max = 0;
+}
+
+
+inline unsigned long long CLatencyHistogram::GetCount() const noexcept
+{
+    return m_count;
+}
+
+
+inline unsigned long long CLatencyHistogram::GetMax() const noexcept
+{
+    return m_max;
+}
+
+
+inline unsigned long long CLatencyHistogram::GetPercentile(double percentile) const noexcept
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+
+    // Rank of the value, from 1 to m_count
+    unsigned long long rank = static_cast<unsigned long long>(percentile / 100.0 * m_count + 0.999999);
+    rank = (rank < 1) ? 1 : (rank > m_count ? m_count : rank);
+
+    unsigned long long cumulative = 0;
+    for (unsigned index = 0; index < kBucketCount; ++index)
+    {
+        cumulative += m_counts[index];
+        if (cumulative >= rank)
+        {
+            const unsigned long long highest = BucketHighestValue(index);
+            return (highest < m_max) ? highest : m_max;
+        }
+    }
+    return m_max;
+}
+
+
+inline void CLatencyHistogram::Print(std::ostream& os, const char* message) const
+{
+    const double nsPerTick = 1e9 / GetTscFrequency();
+    os << message << ": p50 " << GetPercentile(50.0) * nsPerTick
+       << " ns, p99 " << GetPercentile(99.0) * nsPerTick
+       << " ns, p99.9 " << GetPercentile(99.9) * nsPerTick
+       << " ns, max " << m_max * nsPerTick << " ns (" << m_count << " calls)\n";
+}
+
+
+inline unsigned CLatencyHistogram::MostSignificantBit(unsigned long long value) noexcept
+{
+    _ASSERTE(value != 0);
+
+    // _BitScanReverse64 is x64 only
+    unsigned long index = 0;
+    if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32)))
+    {
+        return index + 32;
+    }
+    _BitScanReverse(&index, static_cast<unsigned long>(value & 0xFFFFFFFF));
+    return index;
+}
+
+
+inline unsigned CLatencyHistogram::BucketIndex(unsigned long long ticks) noexcept
+{
+    if (ticks < kSubBucketCount)
+    {
+        return static_cast<unsigned>(ticks);
+    }
+
+    // ticks >> shift is in [kSubBucketCount, 2 * kSubBucketCount)
+    const unsigned shift = MostSignificantBit(ticks) - kSubBucketBits;
+    return kSubBucketCount + shift * kSubBucketCount
+           + static_cast<unsigned>(ticks >> shift) - kSubBucketCount;
+}
+
+
+inline unsigned long long CLatencyHistogram::BucketHighestValue(unsigned index) noexcept
+{
+    if (index < kSubBucketCount)
+    {
+        return index;
+    }
+
+    const unsigned shift = (index - kSubBucketCount) / kSubBucketCount;
+    const unsigned long long subBucket = kSubBucketCount + (index - kSubBucketCount) % kSubBucketCount;
+    return ((subBucket + 1) << shift) - 1;
+}
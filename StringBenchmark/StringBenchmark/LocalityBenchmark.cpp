@@ -0,0 +1,238 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Locality Analysis
+//
+// Scores the memory locality of each string representation: the ATL and STL strings
+// (one heap block per string) and the pooled strings (packed in the pool's chunks).
+// The strings are created as in the classic benchmark, then their characters are
+// visited, without being read, in an access order:
+//
+//  creation    the order the strings were created in
+//  shuffled    a random order
+//  sorted      the order of the sorted strings, i.e. the order the last passes of a sort
+//              and any scan after it touch them
+//
+// For each order, prints the distinct pages and cache lines taken by the strings (the
+// footprint, the same in any order), the average distinct pages and lines touched by
+// each window of /window consecutive strings (the working set, which depends on the
+// order), and the average stride between the starts of consecutive strings.
+//
+// Nothing is timed: these numbers explain the sort and scan times of the other
+// benchmarks, e.g. why sorting pooled strings visits fewer pages.
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::sort, std::shuffle, std::unique
+#include <iostream>     // std::cout
+#include <numeric>      // std::iota
+#include <random>       // std::mt19937
+#include <string>       // std::wstring
+#include <utility>      // std::move
+#include <vector>       // std::vector
+
+#include <stdint.h>     // uintptr_t
+#include <wchar.h>      // wcscmp, wcslen
+
+#include <windows.h>    // Windows SDK API
+
+#include "Contenders.h"         // ATL, STL and POL contenders
+#include "BenchmarkCommon.h"    // Common benchmark helpers
+#include "Benchmarks.h"         // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+using std::wstring;
+
+
+namespace
+{
+
+enum
+{
+    kcbPage = 4096,
+    kcbCacheLine = 64,
+
+    kDefaultWindow = 1024
+};
+
+
+//---------------------------------------------------------------------------------------
+// The characters of a string (terminator included)
+//---------------------------------------------------------------------------------------
+struct StringExtent
+{
+    uintptr_t   address;
+    size_t      cb;
+};
+
+StringExtent GetExtent(const wchar_t* psz)
+{
+    return StringExtent{ reinterpret_cast<uintptr_t>(psz), (wcslen(psz) + 1) * sizeof(wchar_t) };
+}
+
+
+//---------------------------------------------------------------------------------------
+// Where the characters of a contender's strings are, in their current order
+//---------------------------------------------------------------------------------------
+template <typename Strings>
+vector<StringExtent> GetExtents(const Strings& strings)
+{
+    vector<StringExtent> extents;
+    extents.reserve(strings.size());
+    for (size_t i = 0; i < strings.size(); ++i)
+    {
+        extents.push_back(GetExtent(strings.GetString(i)));
+    }
+    return extents;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Access orders: permutations of the creation order, the same for all the contenders
+//---------------------------------------------------------------------------------------
+struct AccessOrder
+{
+    const char*     name;
+    vector<size_t>  indexes;
+};
+
+vector<AccessOrder> BuildAccessOrders(const vector<const wchar_t*>& source, const wchar_t* selected)
+{
+    vector<size_t> creation(source.size());
+    std::iota(creation.begin(), creation.end(), size_t{ 0 });
+
+    vector<AccessOrder> orders;
+    if (selected == nullptr || wcscmp(selected, L"creation") == 0)
+    {
+        orders.push_back(AccessOrder{ "creation", creation });
+    }
+    if (selected == nullptr || wcscmp(selected, L"shuffled") == 0)
+    {
+        vector<size_t> shuffled = creation;
+        std::mt19937 prng(2023);
+        std::shuffle(shuffled.begin(), shuffled.end(), prng);
+        orders.push_back(AccessOrder{ "shuffled", std::move(shuffled) });
+    }
+    if (selected == nullptr || wcscmp(selected, L"sorted") == 0)
+    {
+        vector<size_t> sorted = creation;
+        std::sort(sorted.begin(), sorted.end(),
+            [&source](size_t i1, size_t i2) { return wcscmp(source[i1], source[i2]) < 0; });
+        orders.push_back(AccessOrder{ "sorted", std::move(sorted) });
+    }
+    return orders;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Count the distinct blocks (pages or cache lines) of cbBlock bytes touched by the
+// strings at indexes [first, last) of the order
+//---------------------------------------------------------------------------------------
+size_t CountDistinctBlocks(const vector<StringExtent>& extents, const vector<size_t>& indexes,
+                           size_t first, size_t last, size_t cbBlock, vector<uintptr_t>& blocks)
+{
+    blocks.clear();
+    for (size_t k = first; k < last; ++k)
+    {
+        const StringExtent& extent = extents[indexes[k]];
+        for (uintptr_t block = extent.address / cbBlock; block <= (extent.address + extent.cb - 1) / cbBlock; ++block)
+        {
+            blocks.push_back(block);
+        }
+    }
+
+    std::sort(blocks.begin(), blocks.end());
+    return static_cast<size_t>(std::unique(blocks.begin(), blocks.end()) - blocks.begin());
+}
+
+
+//---------------------------------------------------------------------------------------
+// Print the locality score of a contender's strings visited in an order
+//---------------------------------------------------------------------------------------
+void PrintLocality(const char* name, const vector<StringExtent>& extents, const AccessOrder& order,
+                   size_t window)
+{
+    const vector<size_t>& indexes = order.indexes;
+    vector<uintptr_t> blocks;
+
+    const size_t pageCount = CountDistinctBlocks(extents, indexes, 0, indexes.size(), kcbPage, blocks);
+    const size_t lineCount = CountDistinctBlocks(extents, indexes, 0, indexes.size(), kcbCacheLine, blocks);
+
+    // Working set of each full window (a shorter last window would skew the average)
+    const size_t windowCount = (std::max)(size_t{ 1 }, indexes.size() / window);
+    double windowPages = 0;
+    double windowLines = 0;
+    for (size_t w = 0; w < windowCount; ++w)
+    {
+        const size_t first = w * window;
+        const size_t last = (std::min)(first + window, indexes.size());
+        windowPages += CountDistinctBlocks(extents, indexes, first, last, kcbPage, blocks);
+        windowLines += CountDistinctBlocks(extents, indexes, first, last, kcbCacheLine, blocks);
+    }
+
+    double totalStride = 0;
+    for (size_t k = 1; k < indexes.size(); ++k)
+    {
+        const uintptr_t previous = extents[indexes[k - 1]].address;
+        const uintptr_t current = extents[indexes[k]].address;
+        totalStride += static_cast<double>(current > previous ? current - previous : previous - current);
+    }
+
+    cout << order.name << ' ' << name << ": " << pageCount << " pages, " << lineCount << " lines; per window "
+         << windowPages / windowCount << " pages, " << windowLines / windowCount << " lines; average stride "
+         << (indexes.size() > 1 ? totalStride / (indexes.size() - 1) : 0.0) << " bytes\n";
+}
+
+
+//---------------------------------------------------------------------------------------
+// Create a contender's strings and print their locality in each order
+//---------------------------------------------------------------------------------------
+template <typename Strings>
+void AnalyzeLocality(const char* name, const vector<const wchar_t*>& source,
+                     const vector<AccessOrder>& orders, size_t window)
+{
+    Strings strings;
+    strings.Create(source);
+    const vector<StringExtent> extents = GetExtents(strings);
+
+    for (const auto& order : orders)
+    {
+        PrintLocality(name, extents, order, window);
+    }
+}
+
+} // namespace
+
+
+int RunLocalityBenchmark(const CCommandLine& cmdLine)
+{
+    const wchar_t* const orderName = cmdLine.Find(L"/order");
+    const unsigned long long window = cmdLine.GetNumber(L"/window", kDefaultWindow);
+
+    if (orderName != nullptr && wcscmp(orderName, L"creation") != 0 && wcscmp(orderName, L"shuffled") != 0
+        && wcscmp(orderName, L"sorted") != 0)
+    {
+        cout << "/order must be creation, shuffled or sorted.\n";
+        return 1;
+    }
+    if (window == 0)
+    {
+        cout << "/window must be at least 1.\n";
+        return 1;
+    }
+
+    const auto shuffled = BuildShuffledStrings();
+    const auto shuffled_ptrs = BuildStringPointers(shuffled);
+    const vector<AccessOrder> orders = BuildAccessOrders(shuffled_ptrs, orderName);
+
+    cout << "=== Locality (" << shuffled_ptrs.size() << " strings, " << kcbPage << "-byte pages, "
+         << kcbCacheLine << "-byte lines, windows of " << window << " strings) === \n";
+
+    AnalyzeLocality<AtlStrings>("ATL", shuffled_ptrs, orders, static_cast<size_t>(window));
+    AnalyzeLocality<StlStrings>("STL", shuffled_ptrs, orders, static_cast<size_t>(window));
+    AnalyzeLocality<PooledStrings>("POL", shuffled_ptrs, orders, static_cast<size_t>(window));
+
+    return 0;
+}
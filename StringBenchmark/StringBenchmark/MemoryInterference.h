@@ -0,0 +1,178 @@
+#pragma once
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Memory Interference: background "noisy neighbour" threads generating memory bandwidth
+// or cache pressure
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::min
+#include <atomic>       // std::atomic
+#include <memory>       // std::unique_ptr
+#include <stdexcept>    // std::logic_error
+#include <thread>       // std::thread
+#include <vector>       // std::vector
+
+#include <string.h>     // memcpy, memset
+
+#include <Windows.h>    // Windows Platform SDK
+
+
+//---------------------------------------------------------------------------------------
+// Memory Interference
+//
+// Each thread works on a private buffer, until stopped:
+//  - Bandwidth: copies the first half of the buffer over the second half, streaming
+//    through memory (size the buffer well above the last-level cache)
+//  - Cache: read-modify-writes random cache lines of the buffer, evicting the lines of
+//    the other threads from the shared last-level cache (size the buffer about as the
+//    last-level cache)
+//---------------------------------------------------------------------------------------
+class CMemoryInterference
+{
+public:
+    enum class Pressure
+    {
+        Bandwidth,
+        Cache
+    };
+
+    // Allocate (and touch) the buffers; the threads don't run until Start()
+    CMemoryInterference(unsigned threadCount, Pressure pressure, SIZE_T cbBuffer);
+
+    // Stop the threads, if running
+    ~CMemoryInterference() noexcept;
+
+    // Start and stop the threads
+    void Start();
+    void Stop() noexcept;
+
+    // Bytes read or written by the threads since Start(): a copy counts once, a cache line
+    // touch counts as a cache line
+    ULONGLONG GetBytesMoved() const noexcept;
+
+
+    //
+    // Ban Copy
+    //
+private:
+    CMemoryInterference(const CMemoryInterference&) = delete;
+    CMemoryInterference& operator=(const CMemoryInterference&) = delete;
+
+
+    //
+    // IMPLEMENTATION
+    //
+private:
+    enum
+    {
+        kcbCacheLine = 64,
+
+        // Work done between checks for Stop(), and updates of the byte count
+        kcbCopyStep = 1024 * 1024,
+        kTouchStep  = 16 * 1024
+    };
+
+    Pressure                            m_pressure;
+    SIZE_T                              m_cbBuffer;
+    std::vector<std::unique_ptr<BYTE[]>> m_buffers;     // One per thread
+    std::vector<std::thread>            m_threads;
+    std::atomic<bool>                   m_bRunning;
+    std::atomic<ULONGLONG>              m_cbMoved;
+
+    void ThreadMain(BYTE* pbBuffer) noexcept;
+};
+
+
+//=======================================================================================
+//                          Inline Method Implementations
+//=======================================================================================
+
+inline CMemoryInterference::CMemoryInterference(unsigned threadCount, Pressure pressure, SIZE_T cbBuffer)
+    : m_pressure(pressure)
+    , m_cbBuffer(cbBuffer)
+    , m_bRunning(false)
+    , m_cbMoved(0)
+{
+    if (m_cbBuffer < 2 * kcbCacheLine)
+    {
+        throw std::logic_error("Interference buffers must be at least two cache lines.");
+    }
+
+    for (unsigned i = 0; i < threadCount; ++i)
+    {
+        m_buffers.emplace_back(new BYTE[m_cbBuffer]);
+        memset(m_buffers.back().get(), static_cast<int>(i), m_cbBuffer);
+    }
+}
+
+
+inline CMemoryInterference::~CMemoryInterference() noexcept
+{
+    Stop();
+}
+
+
+inline void CMemoryInterference::Start()
+{
+    if (!m_threads.empty())
+    {
+        throw std::logic_error("Interference threads already running.");
+    }
+
+    m_cbMoved.store(0);
+    m_bRunning.store(true);
+    for (auto& buffer : m_buffers)
+    {
+        m_threads.emplace_back(&CMemoryInterference::ThreadMain, this, buffer.get());
+    }
+}
+
+
+inline void CMemoryInterference::Stop() noexcept
+{
+    m_bRunning.store(false);
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+    m_threads.clear();
+}
+
+
+inline ULONGLONG CMemoryInterference::GetBytesMoved() const noexcept
+{
+    return m_cbMoved.load(std::memory_order_relaxed);
+}
+
+
+inline void CMemoryInterference::ThreadMain(BYTE* pbBuffer) noexcept
+{
+    const SIZE_T cbHalf = m_cbBuffer / 2;
+    const SIZE_T lineCount = m_cbBuffer / kcbCacheLine;
+    SIZE_T offset = 0;
+    unsigned rng = static_cast<unsigned>(reinterpret_cast<ULONG_PTR>(pbBuffer)) | 1;
+
+    while (m_bRunning.load(std::memory_order_relaxed))
+    {
+        if (m_pressure == Pressure::Bandwidth)
+        {
+            const SIZE_T cb = (std::min)(static_cast<SIZE_T>(kcbCopyStep), cbHalf - offset);
+            memcpy(pbBuffer + cbHalf + offset, pbBuffer + offset, cb);
+            offset = (offset + cb < cbHalf) ? offset + cb : 0;
+            m_cbMoved.fetch_add(cb, std::memory_order_relaxed);
+        }
+        else
+        {
+            for (unsigned i = 0; i < kTouchStep; ++i)
+            {
+                // xorshift32
+                rng ^= rng << 13;
+                rng ^= rng >> 17;
+                rng ^= rng << 5;
+                ++pbBuffer[(rng % lineCount) * kcbCacheLine];
+            }
+            m_cbMoved.fetch_add(static_cast<ULONGLONG>(kTouchStep) * kcbCacheLine, std::memory_order_relaxed);
+        }
+    }
+}
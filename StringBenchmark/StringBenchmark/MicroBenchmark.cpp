@@ -0,0 +1,238 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Microbenchmarks
+//
+// Small, isolated measurements run through CMicroBenchmarkRegistry (see
+// MicroBenchmarkRegistry.h), reported per item:
+//
+//  - string/...: the building blocks of string creation, wcslen and wmemcpy
+//  - pool/...:   AllocString's bump-pointer fast path (on a chunk already committed and
+//                touched), with and without the copy and the length computation, and
+//                its slow path allocating a new chunk for every string
+//  - create/..., sort/...: the classic benchmark phases, per contender
+//
+// A contender is added with one RegisterContender call.
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::max
+#include <iostream>     // std::cout
+#include <memory>       // std::shared_ptr, std::unique_ptr
+#include <string>       // std::string, std::wstring
+#include <vector>       // std::vector
+
+#include <wchar.h>      // wcslen, wmemcpy
+
+#include <windows.h>    // Windows SDK API
+
+#include "StringPool.h"             // Custom string pool allocator
+#include "Contenders.h"             // ATL, STL and POL contenders
+#include "MicroBenchmarkRegistry.h" // Microbenchmark registry
+#include "BenchmarkCommon.h"        // Common benchmark helpers
+#include "Benchmarks.h"             // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+using std::wstring;
+
+
+namespace
+{
+
+#ifdef _DEBUG
+constexpr size_t kMaxItemCount      = 1000;
+constexpr size_t kSlowPathItemCount = 16;
+#else
+constexpr size_t kMaxItemCount      = 256 * 1024;   // 256K
+constexpr size_t kSlowPathItemCount = 1024;
+#endif // _DEBUG
+
+// Strings this long fill more than half of a 64KB chunk, so every allocation takes the
+// slow path
+constexpr size_t kcchSlowPathString = 16 * 1024;
+
+
+// Source strings of the microbenchmarks, with their lengths
+struct SourceStrings
+{
+    vector<wstring>         strings;
+    vector<const wchar_t*>  pointers;
+    vector<const wchar_t*>  ends;
+    size_t                  cchTotal;   // Including the terminators
+};
+
+
+//---------------------------------------------------------------------------------------
+// Register the creation and sort microbenchmarks of a contender
+//---------------------------------------------------------------------------------------
+template <typename Strings>
+void RegisterContender(CMicroBenchmarkRegistry& registry, const std::string& name,
+                       const SourceStrings& source)
+{
+    const auto state = std::make_shared<Strings>();
+    const size_t count = source.pointers.size();
+
+    registry.Register("create/" + name,
+        nullptr,
+        [state, &source] { state->Create(source.pointers); },
+        [state] { state->Clear(); },
+        count);
+
+    registry.Register("sort/" + name,
+        [state, &source] { state->Create(source.pointers); },
+        [state] { state->Sort(); },
+        [state] { state->Clear(); },
+        count);
+}
+
+
+//---------------------------------------------------------------------------------------
+// Register the string and pool microbenchmarks
+//---------------------------------------------------------------------------------------
+void RegisterBuildingBlocks(CMicroBenchmarkRegistry& registry, const SourceStrings& source)
+{
+    const size_t count = source.pointers.size();
+
+    registry.Register("string/wcslen", [&source]
+    {
+        for (const wchar_t* psz : source.pointers)
+        {
+            DoNotOptimize(wcslen(psz));
+        }
+    }, count);
+
+    // Copy into a buffer allocated and touched in advance, as the pool fast path does
+    const auto buffer = std::make_shared<vector<wchar_t>>(source.cchTotal);
+    registry.Register("string/wmemcpy", [&source, buffer]
+    {
+        wchar_t* pch = buffer->data();
+        for (size_t i = 0; i < source.pointers.size(); ++i)
+        {
+            const size_t cch = source.ends[i] - source.pointers[i];
+            wmemcpy(pch, source.pointers[i], cch);
+            pch += cch + 1;
+        }
+        ClobberMemory();
+    }, count);
+
+    // A pool whose only chunk holds all the strings, committed and touched once: Reset
+    // keeps it, so the timed allocations never leave the fast path
+    const auto pool = std::make_shared<std::unique_ptr<CStringPoolAllocator>>();
+    const SIZE_T cbChunk = (std::max)(source.cchTotal * sizeof(wchar_t) + 4096, static_cast<size_t>(32000));
+    const auto setUpWarmPool = [&source, pool, cbChunk]
+    {
+        if (!*pool)
+        {
+            pool->reset(new CStringPoolAllocator(cbChunk));
+            for (const wchar_t* psz : source.pointers)
+            {
+                (*pool)->AllocString(psz);
+            }
+        }
+        (*pool)->Reset();
+    };
+
+    registry.Register("pool/fast path: bump only (empty strings)", setUpWarmPool, [&source, pool]
+    {
+        CStringPoolAllocator& stringPool = **pool;
+        const wchar_t* const pchEmpty = L"";
+        for (size_t i = 0; i < source.pointers.size(); ++i)
+        {
+            DoNotOptimize(stringPool.AllocString(pchEmpty, pchEmpty));
+        }
+    }, nullptr, count);
+
+    registry.Register("pool/fast path: bump + wmemcpy", setUpWarmPool, [&source, pool]
+    {
+        CStringPoolAllocator& stringPool = **pool;
+        for (size_t i = 0; i < source.pointers.size(); ++i)
+        {
+            DoNotOptimize(stringPool.AllocString(source.pointers[i], source.ends[i]));
+        }
+    }, nullptr, count);
+
+    registry.Register("pool/fast path: wcslen + bump + wmemcpy", setUpWarmPool, [&source, pool]
+    {
+        CStringPoolAllocator& stringPool = **pool;
+        for (const wchar_t* psz : source.pointers)
+        {
+            DoNotOptimize(stringPool.AllocString(psz));
+        }
+    }, nullptr, count);
+
+    // Slow path: a new 64KB chunk (VirtualAlloc and first-touch page faults) per string.
+    // The copy of the string is included: compare with string/wmemcpy (16K chars).
+    const auto longString = std::make_shared<wstring>(kcchSlowPathString, L'x');
+    const auto slowPool = std::make_shared<std::unique_ptr<CStringPoolAllocator>>();
+    registry.Register("pool/slow path: new chunk + wmemcpy (16K chars)",
+        [slowPool] { slowPool->reset(new CStringPoolAllocator(32000)); },
+        [slowPool, longString]
+        {
+            CStringPoolAllocator& stringPool = **slowPool;
+            const wchar_t* const pchBegin = longString->data();
+            for (size_t i = 0; i < kSlowPathItemCount; ++i)
+            {
+                DoNotOptimize(stringPool.AllocString(pchBegin, pchBegin + longString->size()));
+            }
+        },
+        [slowPool] { slowPool->reset(); },
+        kSlowPathItemCount);
+
+    const auto longBuffer = std::make_shared<vector<wchar_t>>(kcchSlowPathString + 1);
+    registry.Register("string/wmemcpy (16K chars)", [longString, longBuffer]
+    {
+        for (size_t i = 0; i < kSlowPathItemCount; ++i)
+        {
+            wmemcpy(longBuffer->data(), longString->data(), longString->size());
+            ClobberMemory();
+        }
+    }, kSlowPathItemCount);
+}
+
+} // namespace
+
+
+int RunMicroBenchmarks(const CCommandLine& cmdLine)
+{
+    const unsigned repetitionCount = static_cast<unsigned>(cmdLine.GetNumber(L"/repetitions", 7));
+    if (repetitionCount == 0)
+    {
+        cout << "/repetitions must be at least 1.\n";
+        return 1;
+    }
+
+    const wchar_t* const filter = cmdLine.Find(L"/filter");
+
+    SourceStrings source;
+    source.strings = BuildShuffledStrings();
+    if (source.strings.size() > kMaxItemCount)
+    {
+        source.strings.resize(kMaxItemCount);
+    }
+    source.pointers = BuildStringPointers(source.strings);
+    source.cchTotal = 0;
+    for (const auto& s : source.strings)
+    {
+        source.ends.push_back(s.c_str() + s.size());
+        source.cchTotal += s.size() + 1;
+    }
+
+    CMicroBenchmarkRegistry registry;
+    RegisterBuildingBlocks(registry, source);
+    RegisterContender<AtlStrings>(registry, "ATL", source);
+    RegisterContender<StlStrings>(registry, "STL", source);
+    RegisterContender<PooledStrings>(registry, "POL", source);
+
+    cout << "=== Microbenchmarks (" << source.strings.size() << " strings, median of "
+         << repetitionCount << " repetitions) === \n";
+
+    if (registry.Run(cout, filter != nullptr ? NarrowAscii(filter) : std::string(), repetitionCount) == 0)
+    {
+        cout << "No microbenchmark matches /filter.\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Microbenchmark Registry: named microbenchmarks (setup, timed body, teardown, items
+// processed), run and reported uniformly
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::sort
+#include <functional>   // std::function
+#include <iostream>     // std::ostream
+#include <string>       // std::string
+#include <utility>      // std::move
+#include <vector>       // std::vector
+
+#include <intrin.h>     // _ReadWriteBarrier
+
+#include "BenchmarkCommon.h"    // PerfCounter, PerfFrequency
+
+
+//---------------------------------------------------------------------------------------
+// Optimization Barriers
+//
+// DoNotOptimize(value): the compiler must assume that value is read, so the computation
+// producing it can't be dropped as dead code.
+// ClobberMemory(): the compiler must assume that all memory is read and written, so
+// stores before it can't be dropped or moved past it.
+//---------------------------------------------------------------------------------------
+
+namespace MicroBenchmarkDetail
+{
+
+// The address of each value passed to DoNotOptimize escapes here
+inline const volatile void* volatile& EscapeSink() noexcept
+{
+    static const volatile void* volatile s_pv = nullptr;
+    return s_pv;
+}
+
+} // namespace MicroBenchmarkDetail
+
+template <typename T>
+inline void DoNotOptimize(const T& value) noexcept
+{
+    MicroBenchmarkDetail::EscapeSink() = &value;
+    _ReadWriteBarrier();
+}
+
+inline void ClobberMemory() noexcept
+{
+    _ReadWriteBarrier();
+}
+
+
+//---------------------------------------------------------------------------------------
+// Microbenchmark Registry
+//
+// Each repetition of a microbenchmark runs setup(), then body() (timed), then teardown().
+// The body processes itemCount items (e.g. allocates itemCount strings): the results are
+// reported per item. State shared by the three functions is captured by their lambdas.
+//---------------------------------------------------------------------------------------
+class CMicroBenchmarkRegistry
+{
+public:
+    using Function = std::function<void()>;
+
+    CMicroBenchmarkRegistry() noexcept = default;
+
+    // Register a microbenchmark; setup and teardown may be empty
+    void Register(std::string name, Function setup, Function body, Function teardown, size_t itemCount);
+
+    // Register a microbenchmark with no setup and teardown
+    void Register(std::string name, Function body, size_t itemCount);
+
+    // Run the microbenchmarks whose names contain filter (all of them, if empty),
+    // repetitionCount times each, and print their median and best time per item.
+    // Return the number of microbenchmarks run.
+    size_t Run(std::ostream& os, const std::string& filter, unsigned repetitionCount) const;
+
+
+    //
+    // Ban Copy
+    //
+private:
+    CMicroBenchmarkRegistry(const CMicroBenchmarkRegistry&) = delete;
+    CMicroBenchmarkRegistry& operator=(const CMicroBenchmarkRegistry&) = delete;
+
+
+    //
+    // IMPLEMENTATION
+    //
+private:
+    struct Entry
+    {
+        std::string name;
+        Function    setup;
+        Function    body;
+        Function    teardown;
+        size_t      itemCount;
+    };
+
+    std::vector<Entry>  m_entries;
+};
+
+
+//=======================================================================================
+//                          Inline Method Implementations
+//=======================================================================================
+
+inline void CMicroBenchmarkRegistry::Register(std::string name, Function setup, Function body,
+                                              Function teardown, size_t itemCount)
+{
+    m_entries.push_back(Entry{ std::move(name), std::move(setup), std::move(body), std::move(teardown), itemCount });
+}
+
+
+inline void CMicroBenchmarkRegistry::Register(std::string name, Function body, size_t itemCount)
+{
+    Register(std::move(name), Function(), std::move(body), Function(), itemCount);
+}
+
+
+inline size_t CMicroBenchmarkRegistry::Run(std::ostream& os, const std::string& filter,
+                                           unsigned repetitionCount) const
+{
+    size_t runCount = 0;
+    for (const Entry& entry : m_entries)
+    {
+        if (!filter.empty() && entry.name.find(filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        std::vector<double> nsPerItem;
+        for (unsigned repetition = 0; repetition < repetitionCount; ++repetition)
+        {
+            if (entry.setup)
+            {
+                entry.setup();
+            }
+
+            ClobberMemory();
+            const long long start = PerfCounter();
+            entry.body();
+            ClobberMemory();
+            const long long finish = PerfCounter();
+
+            if (entry.teardown)
+            {
+                entry.teardown();
+            }
+
+            nsPerItem.push_back((finish - start) * 1e9 / PerfFrequency() / entry.itemCount);
+        }
+
+        std::sort(nsPerItem.begin(), nsPerItem.end());
+        const double median = nsPerItem[nsPerItem.size() / 2];
+        os << entry.name << ": " << median << " ns/item (best " << nsPerItem.front() << "), "
+           << 1e3 / median << " M items/s\n";
+        ++runCount;
+    }
+    return runCount;
+}
@@ -0,0 +1,185 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Noisy Neighbour Benchmark
+//
+// Runs the creation, sort and lookup phases of ATL, STL and POL quietly, then again while
+// background threads generate memory pressure (see MemoryInterference.h), and prints how
+// much each phase of each contender slows down:
+//
+//  - /pressure:bandwidth (default): the neighbours stream through big buffers, competing
+//    for memory bandwidth
+//  - /pressure:cache: the neighbours touch random lines of last-level-cache-sized buffers,
+//    evicting the benchmark's data from the shared cache
+//
+// Lookup is a binary search of every source string in the sorted strings.
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::max
+#include <iostream>     // std::cout
+#include <string>       // std::wstring
+#include <vector>       // std::vector
+
+#include <wchar.h>      // wcscmp
+
+#include <windows.h>    // Windows SDK API
+
+#include "Contenders.h"             // ATL, STL and POL contenders
+#include "CacheEviction.h"          // GetLastLevelCacheSize
+#include "MemoryInterference.h"     // Noisy neighbour threads
+#include "BenchmarkCommon.h"        // Common benchmark helpers
+#include "Benchmarks.h"             // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+using std::wstring;
+
+
+namespace
+{
+
+// Median times of the phases of a contender, in ms
+struct PhaseTimes
+{
+    double  creation;
+    double  sort;
+    double  lookup;
+};
+
+
+//---------------------------------------------------------------------------------------
+// Run the phases of a contender /runs times; return the median times, and check that
+// all the source strings are found
+//---------------------------------------------------------------------------------------
+template <typename Strings>
+PhaseTimes MeasurePhases(unsigned runCount, const vector<const wchar_t*>& source, bool& bAllFound)
+{
+    vector<long long> creation;
+    vector<long long> sort;
+    vector<long long> lookup;
+
+    for (unsigned run = 0; run < runCount; ++run)
+    {
+        Strings strings;
+
+        const long long start = PerfCounter();
+        strings.Create(source);
+        const long long created = PerfCounter();
+        strings.Sort();
+        const long long sorted = PerfCounter();
+
+        size_t foundCount = 0;
+        for (const wchar_t* psz : source)
+        {
+            foundCount += strings.Lookup(psz) ? 1 : 0;
+        }
+        const long long finish = PerfCounter();
+
+        creation.push_back(created - start);
+        sort.push_back(sorted - created);
+        lookup.push_back(finish - sorted);
+        bAllFound = bAllFound && (foundCount == source.size());
+    }
+
+    return PhaseTimes{ MedianMs(creation), MedianMs(sort), MedianMs(lookup) };
+}
+
+void PrintSlowdown(const char* phase, double quietMs, double noisyMs)
+{
+    cout << phase << ' ' << quietMs << " -> " << noisyMs << " ms ("
+         << (noisyMs >= quietMs ? "+" : "") << 100.0 * (noisyMs - quietMs) / quietMs << "%)";
+}
+
+} // namespace
+
+
+int RunNoisyNeighbourBenchmark(const CCommandLine& cmdLine)
+{
+    const unsigned neighbourCount = static_cast<unsigned>(cmdLine.GetNumber(L"/neighbours", 2));
+    const unsigned runCount = static_cast<unsigned>(cmdLine.GetNumber(L"/runs", 3));
+
+    CMemoryInterference::Pressure pressure = CMemoryInterference::Pressure::Bandwidth;
+    const wchar_t* const pressureName = cmdLine.Find(L"/pressure");
+    if (pressureName != nullptr && wcscmp(pressureName, L"cache") == 0)
+    {
+        pressure = CMemoryInterference::Pressure::Cache;
+    }
+    else if (pressureName != nullptr && wcscmp(pressureName, L"bandwidth") != 0)
+    {
+        cout << "/pressure must be bandwidth or cache.\n";
+        return 1;
+    }
+
+    if (neighbourCount == 0 || runCount == 0)
+    {
+        cout << "/neighbours and /runs must be at least 1.\n";
+        return 1;
+    }
+
+    // Default buffers: well above the last-level cache for bandwidth pressure, as big as
+    // the last-level cache for cache pressure
+    SIZE_T cbBuffer = static_cast<SIZE_T>(cmdLine.GetNumber(L"/mb", 0)) * 1024 * 1024;
+    if (cbBuffer == 0)
+    {
+        const SIZE_T cbLastLevel = GetLastLevelCacheSize();
+        if (pressure == CMemoryInterference::Pressure::Bandwidth)
+        {
+            cbBuffer = (std::max)(8 * cbLastLevel, static_cast<SIZE_T>(64 * 1024 * 1024));
+        }
+        else
+        {
+            cbBuffer = (cbLastLevel != 0) ? cbLastLevel : 8 * 1024 * 1024;
+        }
+    }
+
+    CMemoryInterference interference(neighbourCount, pressure, cbBuffer);
+
+    cout << "=== Noisy Neighbours (" << neighbourCount << " threads, "
+         << (pressure == CMemoryInterference::Pressure::Bandwidth ? "bandwidth" : "cache")
+         << " pressure, " << cbBuffer / kMB << " MB buffers; median of " << runCount << " runs) === \n";
+
+    const auto shuffled = BuildShuffledStrings();
+    const auto shuffled_ptrs = BuildStringPointers(shuffled);
+
+    bool bAllFound = true;
+
+    const PhaseTimes atlQuiet = MeasurePhases<AtlStrings>(runCount, shuffled_ptrs, bAllFound);
+    const PhaseTimes stlQuiet = MeasurePhases<StlStrings>(runCount, shuffled_ptrs, bAllFound);
+    const PhaseTimes poolQuiet = MeasurePhases<PooledStrings>(runCount, shuffled_ptrs, bAllFound);
+
+    const long long start = PerfCounter();
+    interference.Start();
+    const PhaseTimes atlNoisy = MeasurePhases<AtlStrings>(runCount, shuffled_ptrs, bAllFound);
+    const PhaseTimes stlNoisy = MeasurePhases<StlStrings>(runCount, shuffled_ptrs, bAllFound);
+    const PhaseTimes poolNoisy = MeasurePhases<PooledStrings>(runCount, shuffled_ptrs, bAllFound);
+    const ULONGLONG cbMoved = interference.GetBytesMoved();
+    interference.Stop();
+    const long long finish = PerfCounter();
+
+    cout << "Neighbours: " << cbMoved / kMB / ((finish - start) / static_cast<double>(PerfFrequency()))
+         << " MB/s while the noisy runs ran\n";
+
+    const char* const names[] = { "ATL", "STL", "POL" };
+    const PhaseTimes* const quiet[] = { &atlQuiet, &stlQuiet, &poolQuiet };
+    const PhaseTimes* const noisy[] = { &atlNoisy, &stlNoisy, &poolNoisy };
+    for (int i = 0; i < 3; ++i)
+    {
+        cout << names[i] << ": ";
+        PrintSlowdown("creation", quiet[i]->creation, noisy[i]->creation);
+        cout << ", ";
+        PrintSlowdown("sort", quiet[i]->sort, noisy[i]->sort);
+        cout << ", ";
+        PrintSlowdown("lookup", quiet[i]->lookup, noisy[i]->lookup);
+        cout << '\n';
+    }
+
+    if (!bAllFound)
+    {
+        cout << "Lookup mismatch!\n";
+        return 1;
+    }
+
+    return 0;
+}
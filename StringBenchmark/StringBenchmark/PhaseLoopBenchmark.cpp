@@ -0,0 +1,191 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Phase Loop Benchmark
+//
+// Runs one phase (creation, sort or scan) of one contender (ATL, STL or POL) over and
+// over for a fixed time, to collect enough samples with a sampling profiler, e.g.:
+//
+//  StringBenchmark /bench:phase-loop /contender:POL /phase:sort /seconds:20 ^
+//      /profile-control:\\.\pipe\phase-ctl /profile-ack:\\.\pipe\phase-ack
+//
+// where a script driving the profiler (e.g. resuming and pausing its collection) has
+// created the two named pipes: it reads the "enable" and "disable" commands from
+// phase-ctl, and answers each one with "ack" on phase-ack once the profiler has
+// switched.
+//
+// The profiler is enabled just before each run of the phase and disabled right after it
+// (see ProfilerControl.h), so the corpus generation and the setup of each run (e.g. the
+// creation of the strings to sort) stay out of the profile. /profile-markers:file logs
+// the enable/disable times instead, or as well.
+//
+// /seconds:0 runs the phase once.
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::nth_element
+#include <iostream>     // std::cout
+#include <string>       // std::string, std::wstring
+#include <vector>       // std::vector
+
+#include <wchar.h>      // wcscmp
+
+#include <windows.h>    // Windows SDK API
+
+#include "Contenders.h"         // ATL, STL and POL contenders
+#include "ProfilerControl.h"    // Profiler enable/disable around phases
+#include "BenchmarkCommon.h"    // Common benchmark helpers
+#include "Benchmarks.h"         // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+using std::wstring;
+
+
+namespace
+{
+
+#ifdef _DEBUG
+constexpr unsigned long long kDefaultSeconds = 1;
+#else
+constexpr unsigned long long kDefaultSeconds = 10;
+#endif // _DEBUG
+
+
+enum class Phase
+{
+    Creation,
+    Sort,
+    Scan
+};
+
+
+//---------------------------------------------------------------------------------------
+// Run the phase until seconds of it have run (at least once), with the profiler enabled
+// around each run only; print the run count and the median time of a run
+//---------------------------------------------------------------------------------------
+template <typename Strings>
+void LoopPhase(Phase phase, const std::string& name, const vector<const wchar_t*>& source,
+               unsigned long long seconds, CProfilerControl& profiler)
+{
+    const long long budgetTicks = static_cast<long long>(seconds) * PerfFrequency();
+    long long totalTicks = 0;
+    vector<long long> runTicks;
+    unsigned long long checksum = 0;
+
+    do
+    {
+        Strings strings;
+
+        // Setup, not profiled
+        if (phase != Phase::Creation)
+        {
+            strings.Create(source);
+        }
+        if (phase == Phase::Scan)
+        {
+            strings.Sort();
+        }
+
+        profiler.Enable(name.c_str());
+        const long long start = PerfCounter();
+        switch (phase)
+        {
+        case Phase::Creation:
+            strings.Create(source);
+            break;
+
+        case Phase::Sort:
+            strings.Sort();
+            break;
+
+        case Phase::Scan:
+            checksum += strings.Scan();
+            break;
+        }
+        const long long finish = PerfCounter();
+        profiler.Disable(name.c_str());
+
+        GetTimelineTracer().RecordComplete(name.c_str(), start, finish);
+        runTicks.push_back(finish - start);
+        totalTicks += finish - start;
+    } while (totalTicks < budgetTicks);
+
+    std::nth_element(runTicks.begin(), runTicks.begin() + runTicks.size() / 2, runTicks.end());
+    cout << name << ": " << runTicks.size() << " runs, "
+         << totalTicks / static_cast<double>(PerfFrequency()) << " s in the phase, median "
+         << runTicks[runTicks.size() / 2] * 1000.0 / PerfFrequency() << " ms per run";
+    if (phase == Phase::Scan)
+    {
+        cout << " (checksum " << checksum / runTicks.size() << ')';
+    }
+    cout << '\n';
+}
+
+} // namespace
+
+
+int RunPhaseLoopBenchmark(const CCommandLine& cmdLine)
+{
+    const wchar_t* const contender = cmdLine.Find(L"/contender");
+    const wchar_t* const phaseName = cmdLine.Find(L"/phase");
+    const unsigned long long seconds = cmdLine.GetNumber(L"/seconds", kDefaultSeconds);
+
+    if (contender == nullptr || (wcscmp(contender, L"ATL") != 0 && wcscmp(contender, L"STL") != 0
+                                 && wcscmp(contender, L"POL") != 0))
+    {
+        cout << "/contender must be ATL, STL or POL.\n";
+        return 1;
+    }
+
+    Phase phase = Phase::Creation;
+    if (phaseName != nullptr && wcscmp(phaseName, L"sort") == 0)
+    {
+        phase = Phase::Sort;
+    }
+    else if (phaseName != nullptr && wcscmp(phaseName, L"scan") == 0)
+    {
+        phase = Phase::Scan;
+    }
+    else if (phaseName == nullptr || wcscmp(phaseName, L"creation") != 0)
+    {
+        cout << "/phase must be creation, sort or scan.\n";
+        return 1;
+    }
+
+    const wchar_t* const controlPath = cmdLine.Find(L"/profile-control");
+    const wchar_t* const ackPath = cmdLine.Find(L"/profile-ack");
+    const wchar_t* const markerPath = cmdLine.Find(L"/profile-markers");
+    if (ackPath != nullptr && controlPath == nullptr)
+    {
+        cout << "/profile-ack needs /profile-control.\n";
+        return 1;
+    }
+
+    const auto shuffled = BuildShuffledStrings();
+    const auto shuffled_ptrs = BuildStringPointers(shuffled);
+
+    const std::string name = NarrowAscii(contender) + ' ' + NarrowAscii(phaseName);
+    cout << "=== Phase Loop (" << name << ", " << shuffled_ptrs.size() << " strings, "
+         << seconds << " s) === \n";
+
+    // Open the profiler FIFOs only now, after generating the strings
+    CProfilerControl profiler;
+    profiler.Open(controlPath, ackPath, markerPath);
+
+    if (wcscmp(contender, L"ATL") == 0)
+    {
+        LoopPhase<AtlStrings>(phase, name, shuffled_ptrs, seconds, profiler);
+    }
+    else if (wcscmp(contender, L"STL") == 0)
+    {
+        LoopPhase<StlStrings>(phase, name, shuffled_ptrs, seconds, profiler);
+    }
+    else
+    {
+        LoopPhase<PooledStrings>(phase, name, shuffled_ptrs, seconds, profiler);
+    }
+
+    return 0;
+}
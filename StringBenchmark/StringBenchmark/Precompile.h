@@ -4,6 +4,7 @@
 #include <crtdbg.h>     // _ASSERTE
 #include <wchar.h>      // wcslen, wmemcpy, wcscmp
 #include <new>          // std::bad_alloc
+#include <stdexcept>    // std::logic_error, std::runtime_error
 
 #include <algorithm>    // std::shuffle, std::sort
 #include <iostream>     // std::cout
@@ -15,3 +16,4 @@
 #include <atlstr.h>     // CString
 
 #include <windows.h>    // Windows Platform SDK
+#include <psapi.h>      // GetProcessMemoryInfo
@@ -0,0 +1,189 @@
+#pragma once
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Profiler Control: enable and disable an external sampling profiler around selected
+// phases, and log phase markers to correlate its samples with
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <stdexcept>    // std::runtime_error
+#include <string>       // std::string
+
+#include <stdio.h>      // snprintf
+#include <string.h>     // memcmp
+#include <wchar.h>      // _wcsnicmp
+
+#include <atlbase.h>    // CHandle
+
+#include <Windows.h>    // Windows Platform SDK
+
+
+//---------------------------------------------------------------------------------------
+// Profiler Control
+//
+// Speaks the protocol of perf's control FIFOs ("perf record --control fifo:ctl,ack
+// --delay=-1" starts disabled): "enable" and "disable" commands are written to the
+// control file, and, when an acknowledgement file is given, each command waits for the
+// profiler's "ack" before returning, so the profiled region starts exactly after it.
+// The control and acknowledgement files are opened with CreateFile: on Windows, they are
+// named pipes (\\.\pipe\...) served by the profiler or by a script driving it. The
+// server should create the pipes before the benchmark starts; Open waits up to
+// kOpenTimeoutMs for pipes that don't exist yet or whose instances are all busy.
+//
+// The marker file (optional) gets a line per command, "<seconds> enable|disable <phase>",
+// with the performance counter time, to select samples by time when the profiler can't
+// be controlled.
+//
+// Commands are no-ops until Open is called, or when neither file is given.
+//---------------------------------------------------------------------------------------
+class CProfilerControl
+{
+public:
+    enum
+    {
+        // How long Open waits for the named pipes to be served, in milliseconds
+        kOpenTimeoutMs = 30 * 1000
+    };
+
+    CProfilerControl() noexcept = default;
+
+    // Open the files; any of them may be nullptr (ackPath only makes sense with
+    // controlPath). Throw std::runtime_error on failure, or if a named pipe isn't
+    // served within kOpenTimeoutMs.
+    void Open(const wchar_t* controlPath, const wchar_t* ackPath, const wchar_t* markerPath);
+
+    // Enable or disable the profiler, before and after the given phase.
+    // Throw std::runtime_error if the profiler can't be reached.
+    void Enable(const char* phase);
+    void Disable(const char* phase);
+
+
+    //
+    // Ban Copy
+    //
+private:
+    CProfilerControl(const CProfilerControl&) = delete;
+    CProfilerControl& operator=(const CProfilerControl&) = delete;
+
+
+    //
+    // IMPLEMENTATION
+    //
+private:
+    ATL::CHandle    m_control;
+    ATL::CHandle    m_ack;
+    ATL::CHandle    m_markers;
+
+    void SendCommand(const char* command, const char* phase);
+
+    static HANDLE OpenFile(const wchar_t* path, DWORD access, DWORD creation);
+    static void WriteString(HANDLE file, const std::string& s);
+};
+
+
+//=======================================================================================
+//                          Inline Method Implementations
+//=======================================================================================
+
+inline void CProfilerControl::Open(const wchar_t* controlPath, const wchar_t* ackPath,
+                                   const wchar_t* markerPath)
+{
+    if (controlPath != nullptr)
+    {
+        m_control.Attach(OpenFile(controlPath, GENERIC_WRITE, OPEN_EXISTING));
+    }
+    if (ackPath != nullptr)
+    {
+        m_ack.Attach(OpenFile(ackPath, GENERIC_READ, OPEN_EXISTING));
+    }
+    if (markerPath != nullptr)
+    {
+        m_markers.Attach(OpenFile(markerPath, GENERIC_WRITE, CREATE_ALWAYS));
+    }
+}
+
+
+inline void CProfilerControl::Enable(const char* phase)
+{
+    SendCommand("enable", phase);
+}
+
+
+inline void CProfilerControl::Disable(const char* phase)
+{
+    SendCommand("disable", phase);
+}
+
+
+inline void CProfilerControl::SendCommand(const char* command, const char* phase)
+{
+    if (m_markers.m_h != nullptr)
+    {
+        LARGE_INTEGER counter;
+        LARGE_INTEGER frequency;
+        QueryPerformanceCounter(&counter);
+        QueryPerformanceFrequency(&frequency);
+
+        char seconds[32];
+        snprintf(seconds, sizeof(seconds), "%.6f ", static_cast<double>(counter.QuadPart) / frequency.QuadPart);
+        WriteString(m_markers, seconds + std::string(command) + ' ' + phase + '\n');
+    }
+
+    if (m_control.m_h != nullptr)
+    {
+        WriteString(m_control, std::string(command) + '\n');
+    }
+
+    if (m_ack.m_h != nullptr)
+    {
+        // perf answers each command with "ack\n" (and a NUL)
+        char reply[8] = {};
+        DWORD cbRead = 0;
+        if (!ReadFile(m_ack, reply, sizeof(reply) - 1, &cbRead, nullptr) || cbRead < 3
+            || memcmp(reply, "ack", 3) != 0)
+        {
+            throw std::runtime_error("The profiler didn't acknowledge the control command.");
+        }
+    }
+}
+
+
+inline HANDLE CProfilerControl::OpenFile(const wchar_t* path, DWORD access, DWORD creation)
+{
+    // Opening a named pipe fails right away, instead of blocking, when its server hasn't
+    // created it yet (ERROR_FILE_NOT_FOUND) or all its instances are connected
+    // (ERROR_PIPE_BUSY): retry until the timeout
+    const bool bPipe = _wcsnicmp(path, L"\\\\.\\pipe\\", 9) == 0;
+    const ULONGLONG deadline = GetTickCount64() + kOpenTimeoutMs;
+    for (;;)
+    {
+        const HANDLE file = CreateFileW(path, access, FILE_SHARE_READ, nullptr, creation, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file != INVALID_HANDLE_VALUE)
+        {
+            return file;
+        }
+
+        const DWORD error = GetLastError();
+        const ULONGLONG now = GetTickCount64();
+        if (!bPipe || (error != ERROR_FILE_NOT_FOUND && error != ERROR_PIPE_BUSY) || now >= deadline)
+        {
+            throw std::runtime_error("Can't open a profiler control or marker file.");
+        }
+
+        // WaitNamedPipe fails at once for a pipe that doesn't exist: poll for it
+        if (error == ERROR_FILE_NOT_FOUND || !WaitNamedPipeW(path, static_cast<DWORD>(deadline - now)))
+        {
+            Sleep(100);
+        }
+    }
+}
+
+
+inline void CProfilerControl::WriteString(HANDLE file, const std::string& s)
+{
+    DWORD cbWritten = 0;
+    if (!WriteFile(file, s.data(), static_cast<DWORD>(s.size()), &cbWritten, nullptr) || cbWritten != s.size())
+    {
+        throw std::runtime_error("Can't write to a profiler control or marker file.");
+    }
+}
@@ -0,0 +1,189 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Memory Bandwidth Roofline Benchmark
+//
+// Calibrates the memcpy and memset bandwidth of the machine at a few working-set sizes
+// (L2-sized, LLC-sized, and as big as the string data), then runs the creation phases of the
+// classic benchmark and reports each one as bytes of characters copied per second, and as
+// a percentage of the memcpy bandwidth at the size of the string data: the roofline.
+//
+// Creation can't copy the characters faster than memcpy copies one contiguous block of
+// the same size: a contender close to the roofline is bound by the copy itself, and
+// further allocator work won't make it faster.
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::max, std::min
+#include <iostream>     // std::cout
+#include <vector>       // std::vector
+
+#include <string.h>     // memcpy, memset
+#include <wchar.h>      // wcslen
+
+#include <windows.h>    // Windows SDK API
+
+#include "Contenders.h"         // ATL, STL and POL contenders
+#include "CacheEviction.h"      // GetLastLevelCacheSize
+#include "BenchmarkCommon.h"    // Common benchmark helpers
+#include "Benchmarks.h"         // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+
+
+namespace
+{
+
+#ifdef _DEBUG
+constexpr size_t kcbCalibrationTraffic = 64 * 1024 * 1024;      // 64MB
+#else
+constexpr size_t kcbCalibrationTraffic = 1024 * 1024 * 1024;    // 1GB
+#endif // _DEBUG
+
+constexpr double kGB = 1024.0 * 1024.0 * 1024.0;
+
+
+// Written after the calibration loops, so the compiler can't drop the copies
+volatile unsigned g_sink;
+
+
+struct Bandwidth
+{
+    double  memcpyBytesPerSecond;   // Bytes copied (not read + written) per second
+    double  memsetBytesPerSecond;
+};
+
+//---------------------------------------------------------------------------------------
+// Peak (best of a few trials) memcpy and memset bandwidth over buffers of cb bytes,
+// touched in advance: each trial moves about kcbCalibrationTraffic bytes
+//---------------------------------------------------------------------------------------
+Bandwidth CalibrateBandwidth(size_t cb)
+{
+    vector<BYTE> source(cb, 0x5A);
+    vector<BYTE> dest(cb, 0);
+    const size_t repeatCount = (std::max)(kcbCalibrationTraffic / cb, static_cast<size_t>(1));
+
+    Bandwidth bandwidth = {};
+    unsigned sink = 0;
+    for (int trial = 0; trial < 3; ++trial)
+    {
+        long long start = PerfCounter();
+        for (size_t i = 0; i < repeatCount; ++i)
+        {
+            memcpy(dest.data(), source.data(), cb);
+            sink += dest[i % cb];
+        }
+        long long finish = PerfCounter();
+        bandwidth.memcpyBytesPerSecond = (std::max)(bandwidth.memcpyBytesPerSecond,
+            static_cast<double>(cb) * repeatCount * PerfFrequency() / (finish - start));
+
+        start = PerfCounter();
+        for (size_t i = 0; i < repeatCount; ++i)
+        {
+            memset(dest.data(), static_cast<int>(i & 0xFF), cb);
+            sink += dest[i % cb];
+        }
+        finish = PerfCounter();
+        bandwidth.memsetBytesPerSecond = (std::max)(bandwidth.memsetBytesPerSecond,
+            static_cast<double>(cb) * repeatCount * PerfFrequency() / (finish - start));
+    }
+
+    // Keep the copies observable
+    g_sink = sink;
+
+    return bandwidth;
+}
+
+void PrintSize(size_t cb)
+{
+    if (cb >= 1024 * 1024)
+    {
+        cout << cb / kMB << " MB";
+    }
+    else
+    {
+        cout << cb / 1024.0 << " KB";
+    }
+}
+
+
+//---------------------------------------------------------------------------------------
+// Run the creation phase of a contender /runs times (the teardown is not timed), and
+// print its best run against the roofline
+//---------------------------------------------------------------------------------------
+template <typename Contender>
+void MeasureCreation(const char* name, const vector<const wchar_t*>& source, unsigned runCount,
+                     size_t cbCopied, double rooflineBytesPerSecond)
+{
+    long long bestTicks = 0;
+    for (unsigned run = 0; run < runCount; ++run)
+    {
+        Contender contender;
+        const long long start = PerfCounter();
+        contender.Create(source);
+        const long long ticks = PerfCounter() - start;
+        if (run == 0 || ticks < bestTicks)
+        {
+            bestTicks = ticks;
+        }
+    }
+
+    const double bytesPerSecond = static_cast<double>(cbCopied) * PerfFrequency() / bestTicks;
+    cout << name << ": " << bestTicks * 1000.0 / PerfFrequency() << " ms, "
+         << bytesPerSecond / kGB << " GB/s copied, "
+         << 100.0 * bytesPerSecond / rooflineBytesPerSecond << "% of the memcpy roofline\n";
+}
+
+} // namespace
+
+
+int RunRooflineBenchmark(const CCommandLine& cmdLine)
+{
+    const unsigned runCount = static_cast<unsigned>(cmdLine.GetNumber(L"/runs", 3));
+    if (runCount == 0)
+    {
+        cout << "/runs must be at least 1.\n";
+        return 1;
+    }
+
+    const auto shuffled = BuildShuffledStrings();
+    const auto shuffled_ptrs = BuildStringPointers(shuffled);
+
+    // Bytes copied by each creation phase: the characters, with their terminators
+    size_t cbCopied = 0;
+    for (const wchar_t* psz : shuffled_ptrs)
+    {
+        cbCopied += (wcslen(psz) + 1) * sizeof(wchar_t);
+    }
+
+    cout << "=== Memory Bandwidth Roofline (" << shuffled.size() << " strings, "
+         << cbCopied / kMB << " MB of characters) === \n";
+
+    // Cache-resident sizes for reference, then the size of the string data. The copies read
+    // a source and write a destination buffer of the given size: 256KB fits both in the L2
+    // of recent cores, and a quarter of the detected last-level cache (1MB if unknown) in
+    // the LLC.
+    const SIZE_T cbLastLevel = GetLastLevelCacheSize();
+    const size_t cbLastLevelResident = (cbLastLevel != 0) ? cbLastLevel / 4 : 1024 * 1024;
+    const size_t sizes[] = { 256 * 1024, cbLastLevelResident, cbCopied };
+    Bandwidth roofline = {};
+    cout << "--- Calibration (peak bandwidth) ---\n";
+    for (size_t cb : sizes)
+    {
+        const Bandwidth bandwidth = CalibrateBandwidth(cb);
+        PrintSize(cb);
+        cout << ": memcpy " << bandwidth.memcpyBytesPerSecond / kGB << " GB/s, "
+             << "memset " << bandwidth.memsetBytesPerSecond / kGB << " GB/s\n";
+        roofline = bandwidth;
+    }
+
+    cout << "--- Creation (best of " << runCount << " runs) ---\n";
+
+    MeasureCreation<AtlStrings>("ATL", shuffled_ptrs, runCount, cbCopied, roofline.memcpyBytesPerSecond);
+    MeasureCreation<StlStrings>("STL", shuffled_ptrs, runCount, cbCopied, roofline.memcpyBytesPerSecond);
+    MeasureCreation<PooledStrings>("POL", shuffled_ptrs, runCount, cbCopied, roofline.memcpyBytesPerSecond);
+
+    return 0;
+}
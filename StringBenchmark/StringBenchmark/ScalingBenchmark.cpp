@@ -0,0 +1,198 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// String-Count Scaling Benchmark
+//
+// Sweeps the number of strings from /min to /max (1K to 100M by default, in 1-2-5 steps,
+// as far as the available memory allows), and at each size measures the creation, sort,
+// scan (reading every character, in sorted order) and teardown phases of ATL, STL and POL.
+//
+// Prints ns per string for each phase as CSV rows, to plot the transitions from L1 to
+// L2, to the last-level cache, to DRAM. Small sizes are repeated, so that each row
+// measures a few million strings in total. The other lines of the output (the title and
+// the notes, and the program's banner and environment report) start with '#', so the
+// output loads as is in most CSV readers.
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::shuffle, std::min, std::max
+#include <iostream>     // std::cout
+#include <random>       // std::mt19937
+#include <string>       // std::wstring
+#include <vector>       // std::vector
+
+#include <windows.h>    // Windows SDK API
+
+#include "Contenders.h"         // ATL, STL and POL contenders
+#include "BenchmarkCommon.h"    // Common benchmark helpers
+#include "Benchmarks.h"         // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+using std::wstring;
+
+
+namespace
+{
+
+#ifdef _DEBUG
+constexpr unsigned long long kDefaultMaxCount = 100 * 1000;             // 100K
+constexpr unsigned long long kStringsPerRow   = 100 * 1000;             // 100K
+#else
+constexpr unsigned long long kDefaultMaxCount = 100 * 1000 * 1000;      // 100M
+constexpr unsigned long long kStringsPerRow   = 4 * 1000 * 1000;        // 4M
+#endif // _DEBUG
+
+// Cap on the repetitions of the smallest sizes
+constexpr unsigned long long kMaxRepetitions = 1000;
+
+
+//---------------------------------------------------------------------------------------
+// Source strings: the same strings as BuildShuffledStrings, in any number, stored back
+// to back in one buffer (to keep the memory overhead of 100M strings low), shuffled
+//---------------------------------------------------------------------------------------
+struct SourceStrings
+{
+    vector<wchar_t>         text;
+    vector<const wchar_t*>  pointers;
+};
+
+SourceStrings BuildSourceStrings(size_t count)
+{
+    SourceStrings source;
+    vector<size_t> offsets;
+    offsets.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const wstring s = BuildSourceString(i);
+        offsets.push_back(source.text.size());
+        source.text.insert(source.text.end(), s.c_str(), s.c_str() + s.size() + 1);
+    }
+
+    source.pointers.reserve(count);
+    for (size_t offset : offsets)
+    {
+        source.pointers.push_back(source.text.data() + offset);
+    }
+
+    std::mt19937 prng(1987);
+    std::shuffle(source.pointers.begin(), source.pointers.end(), prng);
+    return source;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Run the phases of a contender repetitionCount times over the source strings, and print
+// a CSV row of ns per string; return the checksum of the scans
+//---------------------------------------------------------------------------------------
+template <typename Strings>
+unsigned long long MeasureScaling(const char* name, const vector<const wchar_t*>& source,
+                                  unsigned long long repetitionCount)
+{
+    long long creationTicks = 0;
+    long long sortTicks = 0;
+    long long scanTicks = 0;
+    long long teardownTicks = 0;
+    unsigned long long checksum = 0;
+
+    for (unsigned long long repetition = 0; repetition < repetitionCount; ++repetition)
+    {
+        Strings strings;
+
+        const long long start = PerfCounter();
+        strings.Create(source);
+        const long long created = PerfCounter();
+        strings.Sort();
+        const long long sorted = PerfCounter();
+        checksum += strings.Scan();
+        const long long scanned = PerfCounter();
+        strings.Clear();
+        const long long finish = PerfCounter();
+
+        creationTicks += created - start;
+        sortTicks += sorted - created;
+        scanTicks += scanned - sorted;
+        teardownTicks += finish - scanned;
+    }
+
+    const double nsPerTick = 1e9 / PerfFrequency() / (static_cast<double>(source.size()) * repetitionCount);
+    cout << name << ',' << source.size() << ',' << repetitionCount << ','
+         << creationTicks * nsPerTick << ',' << sortTicks * nsPerTick << ','
+         << scanTicks * nsPerTick << ',' << teardownTicks * nsPerTick << '\n';
+    return checksum;
+}
+
+} // namespace
+
+
+int RunScalingBenchmark(const CCommandLine& cmdLine)
+{
+    const unsigned long long minCount = cmdLine.GetNumber(L"/min", 1000);
+    const unsigned long long maxCount = cmdLine.GetNumber(L"/max", kDefaultMaxCount);
+    if (minCount == 0 || maxCount < minCount)
+    {
+        cout << "# /min must be at least 1, and /max at least /min.\n";
+        return 1;
+    }
+
+    // Memory needed per string, estimated generously: the source string and its pointer,
+    // plus a contender's copy, with heap overhead and the contender's vector
+    const size_t cchAverage = BuildSourceStrings(64).text.size() / 64;
+    const ULONGLONG cbPerString = 3 * cchAverage * sizeof(wchar_t) + 96;
+
+    MEMORYSTATUSEX memoryStatus = {};
+    memoryStatus.dwLength = sizeof(memoryStatus);
+    GlobalMemoryStatusEx(&memoryStatus);
+    const ULONGLONG cbAvailable = (std::min)(memoryStatus.ullAvailPhys, memoryStatus.ullAvailVirtual) / 4 * 3;
+
+    cout << "# === String-Count Scaling (" << minCount << " to " << maxCount << " strings, "
+         << "ns per string) === \n";
+    cout << "contender,strings,repetitions,creation_ns,sort_ns,scan_ns,teardown_ns\n";
+
+    // 1-2-5 steps: 1K, 2K, 5K, 10K, ...
+    const unsigned long long steps[] = { 1, 2, 5 };
+    unsigned long long decade = 1;
+    while (decade * 10 <= minCount)
+    {
+        decade *= 10;
+    }
+
+    for (int step = 0; ; step = (step + 1) % 3)
+    {
+        const unsigned long long count = decade * steps[step];
+        if (step == 2)
+        {
+            decade *= 10;
+        }
+        if (count < minCount)
+        {
+            continue;
+        }
+        if (count > maxCount)
+        {
+            break;
+        }
+        if (count * cbPerString > cbAvailable)
+        {
+            cout << "# Stopping before " << count << " strings: not enough memory available.\n";
+            break;
+        }
+
+        const SourceStrings source = BuildSourceStrings(static_cast<size_t>(count));
+        const unsigned long long repetitionCount =
+            (std::max)(1ULL, (std::min)(kMaxRepetitions, kStringsPerRow / count));
+
+        const unsigned long long atlChecksum = MeasureScaling<AtlStrings>("ATL", source.pointers, repetitionCount);
+        const unsigned long long stlChecksum = MeasureScaling<StlStrings>("STL", source.pointers, repetitionCount);
+        const unsigned long long poolChecksum = MeasureScaling<PooledStrings>("POL", source.pointers, repetitionCount);
+
+        if (atlChecksum != stlChecksum || stlChecksum != poolChecksum)
+        {
+            cout << "# Checksum mismatch!\n";
+            return 1;
+        }
+    }
+
+    return 0;
+}
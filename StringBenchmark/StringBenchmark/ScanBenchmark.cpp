@@ -0,0 +1,196 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Scan Benchmark
+//
+// Reads all the strings after creating them, touching every character, in three orders:
+//
+//  - allocation: the order the strings were created in (sequential in the pool chunks)
+//  - shuffled:   a random permutation of the allocation order
+//  - sorted:     lexicographic order, as after the sort phase of the classic benchmark
+//
+// The same index orders are used for ATL, STL and POL, so the differences come from where
+// the characters live: the pool packs them in creation order, while CString and
+// std::wstring scatter them around the heap. Together with the creation time, this
+// separates the pool's locality benefit from its allocation speed.
+//
+// For each contender and order, prints ns and cycles per string, and hardware counter
+// events per string (e.g. LLC misses) with /pmc:index, see ThreadCounters.h.
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::sort, std::shuffle, std::nth_element
+#include <iostream>     // std::cout
+#include <random>       // std::mt19937
+#include <vector>       // std::vector
+
+#include <wchar.h>      // wcscmp
+
+#include <windows.h>    // Windows SDK API
+
+#include "Contenders.h"         // ATL, STL and POL contenders
+#include "ThreadCounters.h"     // Cycles and hardware counters
+#include "BenchmarkCommon.h"    // Common benchmark helpers
+#include "Benchmarks.h"         // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+
+
+namespace
+{
+
+//---------------------------------------------------------------------------------------
+// Read every character of the strings, in the given order; return a checksum (the same
+// as the contender's Scan(), which reads them in allocation order)
+//---------------------------------------------------------------------------------------
+template <typename Contender>
+unsigned long long ScanStrings(const Contender& contender, const vector<UINT32>& order) noexcept
+{
+    unsigned long long checksum = 0;
+    for (UINT32 index : order)
+    {
+        for (const wchar_t* pch = contender.GetString(index); *pch != L'\0'; ++pch)
+        {
+            checksum += *pch;
+        }
+    }
+    return checksum;
+}
+
+
+struct ScanOrder
+{
+    const char*     name;
+    vector<UINT32>  indexes;
+};
+
+struct ScanResult
+{
+    double              nsPerString;
+    double              cyclesPerString;
+    double              eventsPerString;
+    unsigned long long  checksum;
+};
+
+
+//---------------------------------------------------------------------------------------
+// Scan the strings in the given order /passes times, and return the median pass
+//---------------------------------------------------------------------------------------
+template <typename Contender>
+ScanResult MeasureScan(const Contender& contender, const vector<UINT32>& order,
+                       unsigned passes, const CThreadCounters& counters)
+{
+    vector<ScanResult> results;
+    for (unsigned pass = 0; pass < passes; ++pass)
+    {
+        const CThreadCounters::Sample before = counters.Read();
+        const long long start = PerfCounter();
+        const unsigned long long checksum = ScanStrings(contender, order);
+        const long long finish = PerfCounter();
+        const CThreadCounters::Sample after = counters.Read();
+
+        const double count = static_cast<double>(order.size());
+        results.push_back(ScanResult{
+            (finish - start) * 1e9 / PerfFrequency() / count,
+            (after.cycles - before.cycles) / count,
+            (after.hardwareCount - before.hardwareCount) / count,
+            checksum });
+    }
+
+    std::nth_element(results.begin(), results.begin() + results.size() / 2, results.end(),
+        [](const ScanResult& r1, const ScanResult& r2) { return r1.nsPerString < r2.nsPerString; });
+    return results[results.size() / 2];
+}
+
+
+//---------------------------------------------------------------------------------------
+// Create the strings of a contender from the source strings (timed), then scan them in
+// each order; return the checksums of the scans, in the order of the orders
+//---------------------------------------------------------------------------------------
+template <typename Contender>
+vector<unsigned long long> RunScans(const char* name, const vector<const wchar_t*>& source,
+                                    const vector<ScanOrder>& orders, unsigned passes,
+                                    const CThreadCounters& counters)
+{
+    Contender contender;
+    const long long start = PerfCounter();
+    contender.Create(source);
+    const long long finish = PerfCounter();
+
+    cout << name << ": creation " << (finish - start) * 1e9 / PerfFrequency() / contender.size() << " ns/string\n";
+
+    vector<unsigned long long> checksums;
+    for (const ScanOrder& order : orders)
+    {
+        const ScanResult result = MeasureScan(contender, order.indexes, passes, counters);
+        cout << "  " << order.name << " order: " << result.nsPerString << " ns/string, "
+             << result.cyclesPerString << " cycles/string";
+        if (counters.HasHardwareCounter())
+        {
+            cout << ", " << result.eventsPerString << " counter events/string";
+        }
+        cout << '\n';
+        checksums.push_back(result.checksum);
+    }
+    return checksums;
+}
+
+} // namespace
+
+
+int RunScanBenchmark(const CCommandLine& cmdLine)
+{
+    const unsigned passes = static_cast<unsigned>(cmdLine.GetNumber(L"/passes", 5));
+    if (passes == 0)
+    {
+        cout << "/passes must be at least 1.\n";
+        return 1;
+    }
+
+    // The counters are read on this thread, which runs all the scans
+    const int hardwareCounter = cmdLine.Has(L"/pmc") ? static_cast<int>(cmdLine.GetNumber(L"/pmc", 0)) : -1;
+    const CThreadCounters counters(hardwareCounter);
+    if (hardwareCounter >= 0 && !counters.HasHardwareCounter())
+    {
+        cout << "Hardware counter #" << hardwareCounter << " is not available: reporting cycles only.\n";
+    }
+
+    const auto shuffled = BuildShuffledStrings();
+    const auto shuffled_ptrs = BuildStringPointers(shuffled);
+
+    cout << "=== Scan (" << shuffled.size() << " strings, median of " << passes << " passes) === \n";
+
+    // The strings are created in the order of the source strings: index i is the i-th
+    // string allocated
+    vector<ScanOrder> orders(3);
+    orders[0].name = "allocation";
+    orders[0].indexes.resize(shuffled.size());
+    for (UINT32 i = 0; i < orders[0].indexes.size(); ++i)
+    {
+        orders[0].indexes[i] = i;
+    }
+
+    orders[1].name = "shuffled";
+    orders[1].indexes = orders[0].indexes;
+    std::mt19937 prng(2011);
+    std::shuffle(orders[1].indexes.begin(), orders[1].indexes.end(), prng);
+
+    orders[2].name = "sorted";
+    orders[2].indexes = orders[0].indexes;
+    std::sort(orders[2].indexes.begin(), orders[2].indexes.end(),
+        [&](UINT32 i1, UINT32 i2) { return wcscmp(shuffled_ptrs[i1], shuffled_ptrs[i2]) < 0; });
+
+    const auto atlChecksums  = RunScans<AtlStrings>("ATL", shuffled_ptrs, orders, passes, counters);
+    const auto stlChecksums  = RunScans<StlStrings>("STL", shuffled_ptrs, orders, passes, counters);
+    const auto poolChecksums = RunScans<PooledStrings>("POL", shuffled_ptrs, orders, passes, counters);
+
+    if (atlChecksums != stlChecksums || stlChecksums != poolChecksums)
+    {
+        cout << "Checksum mismatch!\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,345 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Request-Scoped Server Simulation Benchmark
+//
+// Worker threads process synthetic requests: each request "parses" a few dozen header
+// strings, builds a response from them, and discards everything. The request-scoped
+// strings live in:
+//
+//  - STL:   a std::vector<std::wstring>, destroyed at the end of the request
+//  - POL:   a CStringPoolAllocator created and destroyed for each request
+//  - Reuse: one CStringPoolAllocator per worker thread, Reset() after each request
+//
+// Reports requests/s, and the percentiles of the request latency across all the workers.
+//
+// /record-trace:path then runs the request-scoped pools once more (up to
+// kMaxRecordedRequests requests), through CRecordingStringPool, saves the allocation
+// trace (see AllocationTrace.h), and reloads and replays it as /bench:trace does.
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::nth_element, std::max_element, std::min
+#include <iostream>     // std::cout
+#include <memory>       // std::unique_ptr
+#include <string>       // std::wstring
+#include <thread>       // std::thread
+#include <vector>       // std::vector
+
+#include <string.h>     // memcmp
+#include <wchar.h>      // wcslen, wcscmp
+
+#include <windows.h>    // Windows SDK API
+
+#include "StringPool.h"         // Custom string pool allocator
+#include "AllocationTrace.h"    // Allocation trace recording
+#include "BenchmarkCommon.h"    // Common benchmark helpers
+#include "BenchmarkEnvironment.h"   // Thread pinning
+#include "Benchmarks.h"         // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+using std::wstring;
+
+
+namespace
+{
+
+#ifdef _DEBUG
+constexpr unsigned long long kDefaultRequestCount = 2000;
+#else
+constexpr unsigned long long kDefaultRequestCount = 2 * 1000 * 1000;  // 2M
+#endif // _DEBUG
+
+// Requests run by /record-trace (~32 records of 12 bytes each)
+constexpr unsigned long long kMaxRecordedRequests = 100 * 1000;     // 100K
+
+// Range of the number of strings built by each request
+constexpr size_t kMinStringsPerRequest = 16;
+constexpr size_t kMaxStringsPerRequest = 48;
+
+
+// The header strings of a synthetic request: a deterministic window of the corpus,
+// whose size depends on the request number
+class CRequestSource
+{
+public:
+    explicit CRequestSource(const vector<const wchar_t*>& corpus) noexcept
+        : m_corpus(corpus)
+    {
+    }
+
+    size_t GetStringCount(unsigned long long request) const noexcept
+    {
+        return kMinStringsPerRequest
+            + static_cast<size_t>(Mix(request) % (kMaxStringsPerRequest - kMinStringsPerRequest + 1));
+    }
+
+    const wchar_t* GetString(unsigned long long request, size_t i) const noexcept
+    {
+        return m_corpus[static_cast<size_t>((Mix(request) >> 8) + i) % m_corpus.size()];
+    }
+
+private:
+    static unsigned long long Mix(unsigned long long x) noexcept
+    {
+        x *= 0x9E3779B97F4A7C15ULL;
+        return x ^ (x >> 29);
+    }
+
+    const vector<const wchar_t*>& m_corpus;
+};
+
+
+// "Respond" to a request: look for a header, and sum the string lengths
+template <typename GetString>
+unsigned long long BuildResponse(size_t count, const GetString& getString)
+{
+    unsigned long long checksum = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const wchar_t* const psz = getString(i);
+        checksum += wcslen(psz);
+        if (wcscmp(psz, getString(0)) == 0)
+        {
+            ++checksum;
+        }
+    }
+    return checksum;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Request handlers: process one request and return its response checksum
+//---------------------------------------------------------------------------------------
+
+unsigned long long HandleStlRequest(const CRequestSource& source, unsigned long long request)
+{
+    const size_t count = source.GetStringCount(request);
+
+    vector<wstring> headers;
+    headers.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        headers.emplace_back(source.GetString(request, i));
+    }
+
+    return BuildResponse(count, [&](size_t i) { return headers[i].c_str(); });
+}
+
+// Request-scoped pool (a CStringPoolAllocator, or a CRecordingStringPool), destroyed by
+// the caller right after the request
+template <typename StringPool>
+unsigned long long HandlePooledRequest(const CRequestSource& source, unsigned long long request,
+                                       StringPool&& stringPool, vector<const wchar_t*>& headers)
+{
+    const size_t count = source.GetStringCount(request);
+
+    headers.clear();
+    for (size_t i = 0; i < count; ++i)
+    {
+        headers.push_back(stringPool.AllocString(source.GetString(request, i)));
+    }
+
+    return BuildResponse(count, [&](size_t i) { return headers[i]; });
+}
+
+// Per-thread pool, reset at the end of each request
+unsigned long long HandleReusedPoolRequest(const CRequestSource& source, unsigned long long request,
+                                           CStringPoolAllocator& stringPool, vector<const wchar_t*>& headers)
+{
+    const size_t count = source.GetStringCount(request);
+
+    headers.clear();
+    for (size_t i = 0; i < count; ++i)
+    {
+        headers.push_back(stringPool.AllocString(source.GetString(request, i)));
+    }
+
+    const unsigned long long checksum = BuildResponse(count, [&](size_t i) { return headers[i]; });
+    stringPool.Reset();
+    return checksum;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Run the requests on the worker threads, and print the throughput and the latencies.
+// makeHandler() is called on each worker thread, and returns the function handling
+// a request there, so that it can own per-thread state.
+//---------------------------------------------------------------------------------------
+
+struct WorkerStats
+{
+    vector<long long>   latencies;  // Performance counter ticks, one per request
+    unsigned long long  checksum;
+};
+
+double TicksToMicroseconds(long long ticks)
+{
+    return ticks * 1000000.0 / PerfFrequency();
+}
+
+template <typename MakeHandler>
+unsigned long long RunServer(const char* name, unsigned threadCount, unsigned long long requestCount,
+                             const MakeHandler& makeHandler)
+{
+    vector<WorkerStats> stats(threadCount);
+    vector<std::thread> workers;
+
+    const long long start = PerfCounter();
+
+    for (unsigned t = 0; t < threadCount; ++t)
+    {
+        workers.emplace_back([&, t]
+        {
+            // The main thread just waits for the workers
+            PinBenchmarkThread(t);
+
+            // Requests are interleaved among the workers
+            WorkerStats& workerStats = stats[t];
+            workerStats.latencies.reserve(static_cast<size_t>(requestCount / threadCount + 1));
+            workerStats.checksum = 0;
+
+            auto handle = makeHandler();
+            for (unsigned long long request = t; request < requestCount; request += threadCount)
+            {
+                const long long requestStart = PerfCounter();
+                workerStats.checksum += handle(request);
+                workerStats.latencies.push_back(PerfCounter() - requestStart);
+            }
+        });
+    }
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    const long long finish = PerfCounter();
+
+    // Merge the latencies of all the workers
+    vector<long long> latencies;
+    latencies.reserve(static_cast<size_t>(requestCount));
+    unsigned long long checksum = 0;
+    for (const auto& workerStats : stats)
+    {
+        latencies.insert(latencies.end(), workerStats.latencies.begin(), workerStats.latencies.end());
+        checksum += workerStats.checksum;
+    }
+
+    auto percentile = [&](double p)
+    {
+        const size_t k = static_cast<size_t>(p / 100.0 * (latencies.size() - 1));
+        std::nth_element(latencies.begin(), latencies.begin() + k, latencies.end());
+        return TicksToMicroseconds(latencies[k]);
+    };
+
+    const double seconds = static_cast<double>(finish - start) / PerfFrequency();
+    cout << name << ": " << requestCount / seconds << " requests/s; latency us: "
+         << "p50 " << percentile(50.0)
+         << ", p90 " << percentile(90.0)
+         << ", p99 " << percentile(99.0)
+         << ", p99.9 " << percentile(99.9)
+         << ", max " << TicksToMicroseconds(*std::max_element(latencies.begin(), latencies.end()))
+         << '\n';
+
+    return checksum;
+}
+
+} // namespace
+
+
+int RunServerBenchmark(const CCommandLine& cmdLine)
+{
+    unsigned threadCount = static_cast<unsigned>(cmdLine.GetNumber(L"/threads", 0));
+    if (threadCount == 0)
+    {
+        threadCount = GetDefaultThreadCount();
+    }
+    const unsigned long long requestCount = cmdLine.GetNumber(L"/requests", kDefaultRequestCount);
+    const SIZE_T cbChunkSize = static_cast<SIZE_T>(cmdLine.GetNumber(L"/chunk", 32000));
+    if (requestCount == 0 || cbChunkSize < 32000)
+    {
+        cout << "/requests must be at least 1, and /chunk at least 32000 bytes.\n";
+        return 1;
+    }
+    const wchar_t* const recordPath = cmdLine.Find(L"/record-trace");
+    if (recordPath != nullptr && *recordPath == L'\0')
+    {
+        cout << "/record-trace needs a path.\n";
+        return 1;
+    }
+
+    cout << "=== Request-Scoped Server Simulation (" << threadCount << " threads, "
+         << requestCount << " requests, " << kMinStringsPerRequest << "-" << kMaxStringsPerRequest
+         << " strings each) === \n";
+
+    const auto shuffled = BuildShuffledStrings();
+    const auto shuffled_ptrs = BuildStringPointers(shuffled);
+    const CRequestSource source(shuffled_ptrs);
+
+    const unsigned long long stlChecksum = RunServer("STL", threadCount, requestCount, [&]
+    {
+        return [&](unsigned long long request) { return HandleStlRequest(source, request); };
+    });
+
+    const unsigned long long poolChecksum = RunServer("POL (pool per request)", threadCount, requestCount, [&]
+    {
+        return [&source, cbChunkSize, headers = vector<const wchar_t*>()](unsigned long long request) mutable
+        {
+            return HandlePooledRequest(source, request, CStringPoolAllocator(cbChunkSize), headers);
+        };
+    });
+
+    const unsigned long long reuseChecksum = RunServer("POL (reset and reuse)", threadCount, requestCount, [&]
+    {
+        // The handler is moved around before running, so the pool sits behind a pointer
+        return [&source,
+                stringPool = std::unique_ptr<CStringPoolAllocator>(new CStringPoolAllocator(cbChunkSize)),
+                headers = vector<const wchar_t*>()](unsigned long long request) mutable
+        {
+            return HandleReusedPoolRequest(source, request, *stringPool, headers);
+        };
+    });
+
+    if (stlChecksum != poolChecksum || stlChecksum != reuseChecksum)
+    {
+        cout << "Response checksum mismatch!\n";
+        return 1;
+    }
+
+    if (recordPath == nullptr)
+    {
+        return 0;
+    }
+
+    //
+    // Record the trace of the request-scoped pools in a run of its own, so that the
+    // recorder's lock doesn't weigh on the measured runs; then check that the saved
+    // trace reloads as recorded, and replay it
+    //
+    const unsigned long long recordedRequestCount = (std::min)(requestCount, kMaxRecordedRequests);
+    CAllocationTraceRecorder recorder;
+    RunServer("POL (pool per request, recording)", threadCount, recordedRequestCount, [&]
+    {
+        return [&source, &recorder, cbChunkSize, headers = vector<const wchar_t*>()](unsigned long long request) mutable
+        {
+            return HandlePooledRequest(source, request, CRecordingStringPool(recorder, cbChunkSize), headers);
+        };
+    });
+
+    recorder.Save(recordPath);
+    const vector<TraceRecord> recorded = recorder.GetRecords();
+    const vector<TraceRecord> reloaded = LoadAllocationTrace(recordPath);
+    if (reloaded.size() != recorded.size()
+        || memcmp(reloaded.data(), recorded.data(), recorded.size() * sizeof(TraceRecord)) != 0)
+    {
+        cout << "Recorded trace mismatch!\n";
+        return 1;
+    }
+
+    cout << "\nTrace of " << recordedRequestCount << " requests (" << reloaded.size() << " records) written to "
+         << NarrowAscii(recordPath) << "; replaying it:\n";
+    return ReplayAllocationTrace(reloaded, cbChunkSize);
+}
@@ -0,0 +1,394 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Shared Pool Benchmark
+//
+// A dictionary is built once in a string pool, then frozen and consulted by N worker
+// processes. We compare the memory used by the workers when:
+//
+//  - private: each worker copies the dictionary into its own private string pool
+//  - shared:  each worker maps the frozen pool's chunks (pagefile-backed sections),
+//             so all the workers share the very same physical pages
+//
+// Windows has no fork(), so the workers are child processes of this executable,
+// launched with "/worker:shared-pool". They inherit the section handles, and map the
+// chunks at the same addresses as in the parent, so the pooled string pointers
+// stay valid as they are.
+//
+// The private bytes of the workers are summed. Their working sets are averaged instead:
+// the shared chunk pages are in the working set of every worker mapping them, so a sum
+// would count them once per worker.
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::sort, std::binary_search
+#include <iostream>     // std::cout
+#include <string>       // std::wstring, std::to_wstring
+#include <vector>       // std::vector
+
+#include <atlbase.h>    // CHandle
+
+#include <windows.h>    // Windows SDK API
+
+#include "StringPool.h"         // Custom string pool allocator
+#include "BenchmarkCommon.h"    // Common benchmark helpers
+#include "Benchmarks.h"         // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+using std::wstring;
+
+
+namespace
+{
+
+//---------------------------------------------------------------------------------------
+// Manifest shared by the parent with its workers
+//---------------------------------------------------------------------------------------
+//
+// The manifest lives in an inheritable pagefile-backed section, laid out as:
+//
+//      +------------------------------+
+//      |  ManifestHeader              |
+//      +------------------------------+
+//      |  ChunkDesc[chunkCount]       |   <--- Chunks of the frozen pool
+//      +------------------------------+
+//      |  ULONGLONG[stringCount]      |   <--- Sorted pooled string pointers
+//      +------------------------------+
+//      |  WorkerResult[workerCount]   |   <--- Written by each worker
+//      +------------------------------+
+//
+
+struct ManifestHeader
+{
+    ULONGLONG chunkCount;
+    ULONGLONG stringCount;
+    ULONGLONG workerCount;
+};
+
+struct ChunkDesc
+{
+    ULONGLONG hSection;     // Inherited section handle value
+    ULONGLONG pvBase;       // Address of the chunk in the parent process
+    ULONGLONG cbSize;       // Size of the chunk, in bytes
+};
+
+// Status of a worker
+enum : LONG
+{
+    kWorkerSucceeded = 0,
+    kWorkerNotRun = -1,         // Didn't get to write its result
+    kWorkerMapFailed = -2       // Couldn't map a chunk at the parent's address
+};
+
+struct WorkerResult
+{
+    ULONGLONG   cbWorkingSet;   // Working set after the lookups
+    ULONGLONG   cbPrivate;      // Private committed bytes after the lookups
+    ULONGLONG   foundCount;     // Number of successful lookups
+    double      lookupMs;       // Time spent in lookups
+    LONG        status;         // kWorkerXxx
+    DWORD       error;          // GetLastError value of a failure
+};
+
+struct Manifest
+{
+    ManifestHeader* pHeader;
+    ChunkDesc*      pChunks;
+    ULONGLONG*      pStrings;
+    WorkerResult*   pResults;
+};
+
+SIZE_T ManifestSize(ULONGLONG chunkCount, ULONGLONG stringCount, ULONGLONG workerCount) noexcept
+{
+    return static_cast<SIZE_T>(sizeof(ManifestHeader)
+                               + chunkCount  * sizeof(ChunkDesc)
+                               + stringCount * sizeof(ULONGLONG)
+                               + workerCount * sizeof(WorkerResult));
+}
+
+Manifest LayoutManifest(void* pv) noexcept
+{
+    Manifest m;
+    m.pHeader  = static_cast<ManifestHeader*>(pv);
+    m.pChunks  = reinterpret_cast<ChunkDesc*>(m.pHeader + 1);
+    m.pStrings = reinterpret_cast<ULONGLONG*>(m.pChunks + m.pHeader->chunkCount);
+    m.pResults = reinterpret_cast<WorkerResult*>(m.pStrings + m.pHeader->stringCount);
+    return m;
+}
+
+bool CompareString(const wchar_t* psz1, const wchar_t* psz2)
+{
+    return wcscmp(psz1, psz2) < 0;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Consult the dictionary: look up each of its strings, touching all its pages
+//---------------------------------------------------------------------------------------
+void RunLookups(const vector<const wchar_t*>& sortedStrings, WorkerResult& result)
+{
+    const long long start = PerfCounter();
+
+    ULONGLONG found = 0;
+    for (const wchar_t* psz : sortedStrings)
+    {
+        if (std::binary_search(sortedStrings.begin(), sortedStrings.end(), psz, CompareString))
+        {
+            ++found;
+        }
+    }
+
+    const long long finish = PerfCounter();
+
+    result.foundCount = found;
+    result.lookupMs   = (finish - start) * 1000.0 / PerfFrequency();
+
+    const ProcessMemory memory = GetProcessMemory();
+    result.cbWorkingSet = memory.cbWorkingSet;
+    result.cbPrivate    = memory.cbPrivate;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Launch the workers in the given mode, wait for them, and print their memory usage
+//---------------------------------------------------------------------------------------
+bool RunWorkers(const wchar_t* mode, HANDLE hManifest, const Manifest& manifest)
+{
+    const wstring exePath = CCommandLine::GetExecutablePath();
+    const ULONGLONG workerCount = manifest.pHeader->workerCount;
+
+    vector<CHandle> processes;
+    for (ULONGLONG slot = 0; slot < workerCount; ++slot)
+    {
+        manifest.pResults[slot] = WorkerResult{};
+        manifest.pResults[slot].status = kWorkerNotRun;
+
+        wstring commandLine = L"\"" + exePath + L"\" /worker:shared-pool"
+            + L" /mode:" + mode
+            + L" /manifest:" + std::to_wstring(reinterpret_cast<ULONG_PTR>(hManifest))
+            + L" /slot:" + std::to_wstring(slot);
+
+        STARTUPINFOW si = {};
+        si.cb = sizeof(si);
+        PROCESS_INFORMATION pi = {};
+
+        // bInheritHandles = TRUE: the workers inherit the manifest and chunk sections
+        if (!CreateProcessW(exePath.c_str(), &commandLine[0], nullptr, nullptr, TRUE,
+                            0, nullptr, nullptr, &si, &pi))
+        {
+            cout << "CreateProcess failed (error " << GetLastError() << ").\n";
+            return false;
+        }
+
+        CloseHandle(pi.hThread);
+        processes.emplace_back(pi.hProcess);
+    }
+
+    for (auto& hProcess : processes)
+    {
+        WaitForSingleObject(hProcess, INFINITE);
+    }
+
+    ULONGLONG cbTotalWorkingSet = 0;
+    ULONGLONG cbTotalPrivate = 0;
+    double totalLookupMs = 0.0;
+    for (ULONGLONG slot = 0; slot < workerCount; ++slot)
+    {
+        const WorkerResult& result = manifest.pResults[slot];
+        if (result.status == kWorkerMapFailed)
+        {
+            cout << "Worker #" << slot << " can't map the pool chunks at the parent's addresses (error "
+                 << result.error << "): that address range is taken in the worker, e.g. because of ASLR.\n";
+            return false;
+        }
+        if (result.status != kWorkerSucceeded || result.foundCount != manifest.pHeader->stringCount)
+        {
+            cout << "Worker #" << slot << " failed (status " << result.status << ").\n";
+            return false;
+        }
+
+        cbTotalWorkingSet += result.cbWorkingSet;
+        cbTotalPrivate    += result.cbPrivate;
+        totalLookupMs     += result.lookupMs;
+    }
+
+    cout << NarrowAscii(mode) << ": "
+         << "total private bytes " << cbTotalPrivate / kMB << " MB, "
+         << "working set per worker " << cbTotalWorkingSet / workerCount / kMB << " MB, "
+         << "average lookup time " << totalLookupMs / workerCount << " ms\n";
+
+    return true;
+}
+
+} // namespace
+
+
+//---------------------------------------------------------------------------------------
+// Parent Process
+//---------------------------------------------------------------------------------------
+int RunSharedPoolBenchmark(const CCommandLine& cmdLine)
+{
+    const ULONGLONG workerCount = cmdLine.GetNumber(L"/workers", 4);
+    if (workerCount == 0)
+    {
+        cout << "At least one worker is required.\n";
+        return 1;
+    }
+
+    cout << "=== Shared Pool (" << workerCount << " worker processes) === \n";
+
+    //
+    // Build the dictionary in a pool backed by shareable sections, then freeze it
+    //
+    CStringPoolAllocator stringPool(512 * 1024, CStringPoolAllocator::ChunkBacking::SharedSection);
+    vector<const wchar_t*> dictionary;
+    {
+        const auto shuffled = BuildShuffledStrings();
+        dictionary.reserve(shuffled.size());
+        for (const auto& s : shuffled)
+        {
+            dictionary.push_back(stringPool.AllocString(s.c_str()));
+        }
+    }
+    std::sort(dictionary.begin(), dictionary.end(), CompareString);
+    stringPool.Freeze();
+
+    const auto chunks = stringPool.GetChunks();
+    ULONGLONG cbChunks = 0;
+    for (const auto& chunk : chunks)
+    {
+        cbChunks += chunk.cbSize;
+    }
+    cout << "Dictionary: " << dictionary.size() << " strings in " << chunks.size() << " chunks ("
+         << cbChunks / (1024.0 * 1024.0) << " MB)\n";
+
+    //
+    // Publish the chunks and the sorted string pointers in the manifest
+    //
+    SECURITY_ATTRIBUTES sa = {};
+    sa.nLength        = sizeof(sa);
+    sa.bInheritHandle = TRUE;
+
+    const ULONGLONG cbManifest = ManifestSize(chunks.size(), dictionary.size(), workerCount);
+    CHandle hManifest(CreateFileMappingW(INVALID_HANDLE_VALUE, &sa, PAGE_READWRITE,
+                                         static_cast<DWORD>(cbManifest >> 32),
+                                         static_cast<DWORD>(cbManifest & 0xFFFFFFFF),
+                                         nullptr));
+    if (hManifest == nullptr)
+    {
+        cout << "CreateFileMapping failed (error " << GetLastError() << ").\n";
+        return 1;
+    }
+
+    void* const pvManifest = MapViewOfFile(hManifest, FILE_MAP_WRITE, 0, 0, 0);
+    if (pvManifest == nullptr)
+    {
+        cout << "MapViewOfFile failed (error " << GetLastError() << ").\n";
+        return 1;
+    }
+
+    static_cast<ManifestHeader*>(pvManifest)->chunkCount  = chunks.size();
+    static_cast<ManifestHeader*>(pvManifest)->stringCount = dictionary.size();
+    static_cast<ManifestHeader*>(pvManifest)->workerCount = workerCount;
+    const Manifest manifest = LayoutManifest(pvManifest);
+
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        manifest.pChunks[i].hSection = reinterpret_cast<ULONG_PTR>(chunks[i].hSection);
+        manifest.pChunks[i].pvBase   = reinterpret_cast<ULONG_PTR>(chunks[i].pvBase);
+        manifest.pChunks[i].cbSize   = chunks[i].cbSize;
+    }
+    for (size_t i = 0; i < dictionary.size(); ++i)
+    {
+        manifest.pStrings[i] = reinterpret_cast<ULONG_PTR>(dictionary[i]);
+    }
+
+    const bool succeeded = RunWorkers(L"private", hManifest, manifest)
+                        && RunWorkers(L"shared", hManifest, manifest);
+
+    UnmapViewOfFile(pvManifest);
+    return succeeded ? 0 : 1;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Worker Process
+//---------------------------------------------------------------------------------------
+int RunSharedPoolWorker(const CCommandLine& cmdLine)
+{
+    const HANDLE hManifest = reinterpret_cast<HANDLE>(
+        static_cast<ULONG_PTR>(cmdLine.GetNumber(L"/manifest", 0)));
+    const ULONGLONG slot = cmdLine.GetNumber(L"/slot", 0);
+    const wchar_t* const mode = cmdLine.Find(L"/mode");
+    if (hManifest == nullptr || mode == nullptr)
+    {
+        return 1;
+    }
+
+    void* const pvManifest = MapViewOfFile(hManifest, FILE_MAP_WRITE, 0, 0, 0);
+    if (pvManifest == nullptr)
+    {
+        return 1;
+    }
+    const Manifest manifest = LayoutManifest(pvManifest);
+    if (slot >= manifest.pHeader->workerCount)
+    {
+        return 1;
+    }
+    WorkerResult& result = manifest.pResults[slot];
+
+    //
+    // Map the frozen chunks read-only, at the same addresses they have in the parent
+    //
+    vector<void*> views;
+    for (ULONGLONG i = 0; i < manifest.pHeader->chunkCount; ++i)
+    {
+        const ChunkDesc& chunk = manifest.pChunks[i];
+        void* const pv = MapViewOfFileEx(reinterpret_cast<HANDLE>(static_cast<ULONG_PTR>(chunk.hSection)),
+                                         FILE_MAP_READ, 0, 0,
+                                         static_cast<SIZE_T>(chunk.cbSize),
+                                         reinterpret_cast<void*>(static_cast<ULONG_PTR>(chunk.pvBase)));
+        if (pv == nullptr)
+        {
+            // The address range is already in use in this process
+            result.error = GetLastError();
+            result.status = kWorkerMapFailed;
+            return 1;
+        }
+        views.push_back(pv);
+    }
+
+    vector<const wchar_t*> dictionary;
+    dictionary.reserve(static_cast<size_t>(manifest.pHeader->stringCount));
+    for (ULONGLONG i = 0; i < manifest.pHeader->stringCount; ++i)
+    {
+        dictionary.push_back(reinterpret_cast<const wchar_t*>(static_cast<ULONG_PTR>(manifest.pStrings[i])));
+    }
+
+    if (wcscmp(mode, L"shared") == 0)
+    {
+        RunLookups(dictionary, result);
+    }
+    else
+    {
+        // Load a private copy of the dictionary, then drop the shared views
+        CStringPoolAllocator privatePool;
+        for (auto& psz : dictionary)
+        {
+            psz = privatePool.AllocString(psz);
+        }
+
+        for (void* pv : views)
+        {
+            UnmapViewOfFile(pv);
+        }
+        views.clear();
+
+        RunLookups(dictionary, result);
+    }
+
+    result.status = kWorkerSucceeded;
+    return 0;
+}
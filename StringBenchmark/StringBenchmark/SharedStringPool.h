@@ -0,0 +1,428 @@
+#pragma once
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Shared String Pool -- Cross-process string pool in a named shared-memory section
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <crtdbg.h>     // _ASSERTE
+#include <wchar.h>      // wcslen, wmemcpy, wcscmp
+#include <new>          // std::bad_alloc
+#include <stdexcept>    // std::logic_error, std::runtime_error
+
+#include <Windows.h>    // Windows Platform SDK
+
+
+//---------------------------------------------------------------------------------------
+// Shared String Pool
+//
+// One process (the builder) creates a named pagefile-backed section and allocates
+// strings in it; other processes (the readers) attach to the section by name,
+// read-only, and use the strings in place, with zero copying.
+//
+// Since the section can be mapped at a different address in each process, strings are
+// identified by their *offset* from the beginning of the segment, instead of by pointer.
+//---------------------------------------------------------------------------------------
+class CSharedStringPool
+{
+public:
+    // Segment-relative offset of a string, valid in every process attached to the segment
+    typedef ULONGLONG Offset;
+
+    // Create an empty, detached pool
+    CSharedStringPool() noexcept = default;
+
+    // Unmap the segment and close the section handle
+    ~CSharedStringPool() noexcept;
+
+    // Builder: create the named segment, reserving cbCapacity bytes of address space
+    // (pages are committed on demand, as strings are allocated).
+    // Throw std::runtime_error on failure.
+    void Create(PCWSTR pszName, SIZE_T cbCapacity);
+
+    // Reader: attach read-only to a segment published by a builder.
+    // Throw std::runtime_error if the segment doesn't exist or hasn't been published yet.
+    void Attach(PCWSTR pszName);
+
+    // Builder: allocate a string deep-copying it from a [begin, end) character interval.
+    // Throw std::bad_alloc when the segment capacity is exhausted.
+    Offset AllocString(const WCHAR* pchBegin, const WCHAR* pchEnd);
+
+    // Builder: allocate a string deep-copying it from a source NUL-terminated string
+    Offset AllocString(PCWSTR pszSource);
+
+    // Builder: store the index (the string offsets, sorted by string) in the segment,
+    // and make the segment available to readers. No allocations are allowed afterwards.
+    void Publish(const Offset* pIndex, SIZE_T count);
+
+    // Convert an offset to a pointer valid in the current process
+    PCWSTR GetString(Offset offset) const noexcept;
+
+    // Number of strings in the published index
+    SIZE_T GetIndexSize() const noexcept;
+
+    // Offset of the i-th string in the published index
+    Offset GetIndexEntry(SIZE_T i) const noexcept;
+
+    // Binary search the published index for the given string
+    bool Contains(PCWSTR psz) const noexcept;
+
+
+    //
+    // Ban Copy
+    //
+private:
+    CSharedStringPool(const CSharedStringPool&) = delete;
+    CSharedStringPool& operator=(const CSharedStringPool&) = delete;
+
+
+    //
+    // IMPLEMENTATION
+    //
+private:
+
+    //
+    // Segment layout:
+    //
+    //      +--------------------+
+    //      |   SegmentHeader    |
+    //      +--------------------+
+    //      |                    |
+    //      |   Array of WCHARs  |   <--- Strings, bump-allocated like in CStringPoolAllocator
+    //      |        ...         |
+    //      +--------------------+
+    //      |   Offset[count]    |   <--- Sorted index, written by Publish
+    //      +--------------------+
+    //      |    (reserved)      |   <--- Not committed yet
+    //      +--------------------+
+    //
+
+    struct SegmentHeader
+    {
+        DWORD           dwMagic;        // kMagic
+        volatile LONG   lPublished;     // Set (with release semantics) by Publish
+        ULONGLONG       cbUsed;         // Bytes used, including this header
+        ULONGLONG       indexOffset;    // Offset of the index
+        ULONGLONG       indexCount;     // Number of entries in the index
+    };
+
+    enum : DWORD
+    {
+        kMagic = 0x4C505353,    // 'SSPL'
+    };
+
+    enum : SIZE_T
+    {
+        // Pages are committed in steps of this size
+        kcbCommitStep = 1024 * 1024,
+
+        // Same string length limit as CStringPoolAllocator
+        kchMaxCharAlloc = 1024 * 1024
+    };
+
+    HANDLE          m_hSection      = nullptr;  // Named section
+    BYTE*           m_pbBase        = nullptr;  // Base of the segment view in this process
+    SegmentHeader*  m_pHeader       = nullptr;  // Header at the beginning of the segment
+    SIZE_T          m_cbCapacity    = 0;        // Reserved size of the segment
+    SIZE_T          m_cbCommitted   = 0;        // Committed size of the segment (builder only)
+    bool            m_bReadOnly     = false;    // Attached as a reader?
+
+    //
+    // Helper Methods
+    //
+
+    void Destroy() noexcept;
+
+    // Builder: make sure [0, cbRequired) is committed; throw std::bad_alloc on failure
+    void EnsureCommitted(SIZE_T cbRequired);
+
+    const Offset* GetIndex() const noexcept;
+};
+
+
+//=======================================================================================
+//                          Inline Method Implementations
+//=======================================================================================
+
+inline CSharedStringPool::~CSharedStringPool() noexcept
+{
+    Destroy();
+}
+
+
+inline void CSharedStringPool::Destroy() noexcept
+{
+    if (m_pbBase != nullptr)
+    {
+        UnmapViewOfFile(m_pbBase);
+    }
+
+    if (m_hSection != nullptr)
+    {
+        CloseHandle(m_hSection);
+    }
+
+    m_hSection    = nullptr;
+    m_pbBase      = nullptr;
+    m_pHeader     = nullptr;
+    m_cbCapacity  = 0;
+    m_cbCommitted = 0;
+    m_bReadOnly   = false;
+}
+
+
+inline void CSharedStringPool::Create(PCWSTR pszName, SIZE_T cbCapacity)
+{
+    _ASSERTE(pszName != nullptr);
+    _ASSERTE(m_hSection == nullptr);
+    _ASSERTE(cbCapacity > sizeof(SegmentHeader));
+
+    //
+    // SEC_RESERVE: only reserve the address space of the section; pages are committed
+    // on demand with VirtualAlloc(MEM_COMMIT) on the view, as the pool grows
+    //
+    const ULONGLONG cbSection = cbCapacity;
+    m_hSection = CreateFileMappingW(INVALID_HANDLE_VALUE,
+                                    nullptr,
+                                    PAGE_READWRITE | SEC_RESERVE,
+                                    static_cast<DWORD>(cbSection >> 32),
+                                    static_cast<DWORD>(cbSection & 0xFFFFFFFF),
+                                    pszName);
+    if (m_hSection == nullptr)
+    {
+        throw std::runtime_error("CSharedStringPool::Create: CreateFileMapping failed.");
+    }
+
+    if (GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        Destroy();
+        throw std::runtime_error("CSharedStringPool::Create: the segment already exists.");
+    }
+
+    m_pbBase = static_cast<BYTE*>(MapViewOfFile(m_hSection, FILE_MAP_WRITE, 0, 0, cbCapacity));
+    if (m_pbBase == nullptr)
+    {
+        Destroy();
+        throw std::runtime_error("CSharedStringPool::Create: MapViewOfFile failed.");
+    }
+
+    m_cbCapacity = cbCapacity;
+    EnsureCommitted(sizeof(SegmentHeader));
+
+    // Committed pages are zero-initialized
+    m_pHeader = reinterpret_cast<SegmentHeader*>(m_pbBase);
+    m_pHeader->dwMagic = kMagic;
+    m_pHeader->cbUsed  = sizeof(SegmentHeader);
+}
+
+
+inline void CSharedStringPool::Attach(PCWSTR pszName)
+{
+    _ASSERTE(pszName != nullptr);
+    _ASSERTE(m_hSection == nullptr);
+
+    m_hSection = OpenFileMappingW(FILE_MAP_READ, FALSE, pszName);
+    if (m_hSection == nullptr)
+    {
+        throw std::runtime_error("CSharedStringPool::Attach: OpenFileMapping failed.");
+    }
+
+    m_pbBase = static_cast<BYTE*>(MapViewOfFile(m_hSection, FILE_MAP_READ, 0, 0, 0));
+    if (m_pbBase == nullptr)
+    {
+        Destroy();
+        throw std::runtime_error("CSharedStringPool::Attach: MapViewOfFile failed.");
+    }
+
+    m_pHeader   = reinterpret_cast<SegmentHeader*>(m_pbBase);
+    m_bReadOnly = true;
+
+    // The section is reserved and the builder commits it as it grows: until the
+    // header page is committed, reading the header would fault. The committed
+    // region at the base of the view bounds everything the header points to.
+    MEMORY_BASIC_INFORMATION mbi = {};
+    if (VirtualQuery(m_pbBase, &mbi, sizeof(mbi)) != sizeof(mbi)
+        || mbi.State != MEM_COMMIT
+        || mbi.RegionSize < sizeof(SegmentHeader))
+    {
+        Destroy();
+        throw std::runtime_error("CSharedStringPool::Attach: the segment is not published.");
+    }
+
+    // Pairs with the WriteRelease in Publish: the index and the strings are visible
+    // once the published flag is
+    if (ReadAcquire(&m_pHeader->lPublished) == 0 || m_pHeader->dwMagic != kMagic)
+    {
+        Destroy();
+        throw std::runtime_error("CSharedStringPool::Attach: the segment is not published.");
+    }
+
+    const ULONGLONG cbUsed = m_pHeader->cbUsed;
+    if (cbUsed < sizeof(SegmentHeader)
+        || cbUsed > mbi.RegionSize
+        || m_pHeader->indexOffset < sizeof(SegmentHeader)
+        || m_pHeader->indexOffset > cbUsed
+        || m_pHeader->indexCount > (cbUsed - m_pHeader->indexOffset) / sizeof(Offset))
+    {
+        Destroy();
+        throw std::runtime_error("CSharedStringPool::Attach: the segment header is corrupt.");
+    }
+
+    m_cbCapacity = static_cast<SIZE_T>(cbUsed);
+}
+
+
+inline void CSharedStringPool::EnsureCommitted(SIZE_T cbRequired)
+{
+    if (cbRequired <= m_cbCommitted)
+    {
+        return;
+    }
+
+    if (cbRequired > m_cbCapacity)
+    {
+        throw std::bad_alloc();
+    }
+
+    SIZE_T cbNewCommitted = ((cbRequired + kcbCommitStep - 1) / kcbCommitStep) * kcbCommitStep;
+    if (cbNewCommitted > m_cbCapacity)
+    {
+        cbNewCommitted = m_cbCapacity;
+    }
+
+    if (VirtualAlloc(m_pbBase + m_cbCommitted,
+                     cbNewCommitted - m_cbCommitted,
+                     MEM_COMMIT,
+                     PAGE_READWRITE) == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    m_cbCommitted = cbNewCommitted;
+}
+
+
+inline CSharedStringPool::Offset CSharedStringPool::AllocString(const WCHAR* pchBegin, const WCHAR* pchEnd)
+{
+    _ASSERTE(pchBegin != nullptr);
+    _ASSERTE(pchEnd   != nullptr);
+    _ASSERTE(pchBegin <= pchEnd);
+
+    if (m_bReadOnly || m_pHeader == nullptr || m_pHeader->lPublished != 0)
+    {
+        throw std::logic_error("CSharedStringPool::AllocString: the pool is not being built.");
+    }
+
+    // Consider +1 to include the terminating NUL in the string to be allocated
+    const SIZE_T cch = pchEnd - pchBegin + 1;
+    if (cch > kchMaxCharAlloc)
+    {
+        throw std::bad_alloc();
+    }
+
+    const SIZE_T offset = static_cast<SIZE_T>(m_pHeader->cbUsed);
+    EnsureCommitted(offset + cch * sizeof(WCHAR));
+
+    WCHAR* const psz = reinterpret_cast<WCHAR*>(m_pbBase + offset);
+    if (cch > 1)
+    {
+        wmemcpy(psz, pchBegin, cch - 1);
+    }
+
+    // Committed pages are zero-initialized, so there's no need to write the terminating NUL
+    _ASSERTE(psz[cch - 1] == L'\0');
+
+    m_pHeader->cbUsed = offset + cch * sizeof(WCHAR);
+    return offset;
+}
+
+
+inline CSharedStringPool::Offset CSharedStringPool::AllocString(PCWSTR pszSource)
+{
+    _ASSERTE(pszSource != nullptr);
+    return AllocString(pszSource, pszSource + wcslen(pszSource));
+}
+
+
+inline void CSharedStringPool::Publish(const Offset* pIndex, SIZE_T count)
+{
+    _ASSERTE(pIndex != nullptr || count == 0);
+
+    if (m_bReadOnly || m_pHeader == nullptr || m_pHeader->lPublished != 0)
+    {
+        throw std::logic_error("CSharedStringPool::Publish: the pool is not being built.");
+    }
+
+    // Align the index on an Offset boundary, right after the strings
+    const SIZE_T indexOffset = static_cast<SIZE_T>(
+        (m_pHeader->cbUsed + sizeof(Offset) - 1) / sizeof(Offset) * sizeof(Offset));
+    const SIZE_T cbUsed = indexOffset + count * sizeof(Offset);
+    EnsureCommitted(cbUsed);
+
+    if (count != 0)
+    {
+        memcpy(m_pbBase + indexOffset, pIndex, count * sizeof(Offset));
+    }
+
+    m_pHeader->indexOffset = indexOffset;
+    m_pHeader->indexCount  = count;
+    m_pHeader->cbUsed      = cbUsed;
+
+    WriteRelease(&m_pHeader->lPublished, 1);
+}
+
+
+inline PCWSTR CSharedStringPool::GetString(Offset offset) const noexcept
+{
+    _ASSERTE(m_pbBase != nullptr);
+    _ASSERTE(offset >= sizeof(SegmentHeader) && offset < m_pHeader->cbUsed);
+    return reinterpret_cast<PCWSTR>(m_pbBase + offset);
+}
+
+
+inline const CSharedStringPool::Offset* CSharedStringPool::GetIndex() const noexcept
+{
+    return reinterpret_cast<const Offset*>(m_pbBase + m_pHeader->indexOffset);
+}
+
+
+inline SIZE_T CSharedStringPool::GetIndexSize() const noexcept
+{
+    return (m_pHeader != nullptr) ? static_cast<SIZE_T>(m_pHeader->indexCount) : 0;
+}
+
+
+inline CSharedStringPool::Offset CSharedStringPool::GetIndexEntry(SIZE_T i) const noexcept
+{
+    _ASSERTE(i < GetIndexSize());
+    return GetIndex()[i];
+}
+
+
+inline bool CSharedStringPool::Contains(PCWSTR psz) const noexcept
+{
+    _ASSERTE(psz != nullptr);
+
+    const Offset* const pIndex = GetIndex();
+    SIZE_T first = 0;
+    SIZE_T last = GetIndexSize();
+    while (first < last)
+    {
+        const SIZE_T middle = first + (last - first) / 2;
+        const int cmp = wcscmp(GetString(pIndex[middle]), psz);
+        if (cmp == 0)
+        {
+            return true;
+        }
+
+        if (cmp < 0)
+        {
+            first = middle + 1;
+        }
+        else
+        {
+            last = middle;
+        }
+    }
+    return false;
+}
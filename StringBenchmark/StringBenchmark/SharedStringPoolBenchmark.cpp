@@ -0,0 +1,190 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Shared String Pool Benchmark
+//
+// The builder (this process) loads the strings into a named CSharedStringPool segment
+// and publishes a sorted index; a reader process attaches to the segment by name and
+// looks the strings up in place.
+//
+// Reports the build time, the reader's attach time, and lookup times in both processes;
+// as a reference, also the time the reader would need to copy the strings into a
+// private CStringPoolAllocator instead of using them in place.
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::sort
+#include <iostream>     // std::cout
+#include <string>       // std::wstring, std::to_wstring
+#include <vector>       // std::vector
+
+#include <windows.h>    // Windows SDK API
+
+#include "SharedStringPool.h"   // Cross-process string pool
+#include "StringPool.h"         // Custom string pool allocator
+#include "BenchmarkCommon.h"    // Common benchmark helpers
+#include "Benchmarks.h"         // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+using std::wstring;
+
+
+namespace
+{
+
+// Room for the segment header and the alignment of the index
+constexpr SIZE_T kcbSegmentSlack = 64 * 1024;
+
+// Capacity of a segment holding the given strings and their index: derived from the
+// strings rather than fixed, since the whole segment is mapped as one view, which must
+// fit in the address space of 32-bit processes too
+SIZE_T GetSegmentCapacity(const vector<wstring>& strings)
+{
+    SIZE_T cbCapacity = kcbSegmentSlack;
+    for (const auto& s : strings)
+    {
+        cbCapacity += (s.size() + 1) * sizeof(wchar_t) + sizeof(CSharedStringPool::Offset);
+    }
+    return cbCapacity;
+}
+
+// Look up all the indexed strings; return the number of strings found
+SIZE_T LookupAll(const CSharedStringPool& pool)
+{
+    SIZE_T found = 0;
+    for (SIZE_T i = 0; i < pool.GetIndexSize(); ++i)
+    {
+        if (pool.Contains(pool.GetString(pool.GetIndexEntry(i))))
+        {
+            ++found;
+        }
+    }
+    return found;
+}
+
+} // namespace
+
+
+//---------------------------------------------------------------------------------------
+// Builder Process
+//---------------------------------------------------------------------------------------
+int RunSharedStringPoolBenchmark(const CCommandLine& /* cmdLine */)
+{
+    cout << "=== Shared String Pool (builder/reader processes) === \n";
+
+    const auto shuffled = BuildShuffledStrings();
+
+    const wstring segmentName = L"Local\\StringBenchmark.SharedStringPool."
+                              + std::to_wstring(GetCurrentProcessId());
+
+    long long start = 0;
+    long long finish = 0;
+
+    //
+    // Build and publish the segment
+    //
+    CSharedStringPool pool;
+    pool.Create(segmentName.c_str(), GetSegmentCapacity(shuffled));
+
+    start = PerfCounter();
+    vector<CSharedStringPool::Offset> index;
+    index.reserve(shuffled.size());
+    for (const auto& s : shuffled)
+    {
+        index.push_back(pool.AllocString(s.c_str()));
+    }
+    finish = PerfCounter();
+    PrintTime(start, finish, "Builder: build");
+
+    start = PerfCounter();
+    std::sort(index.begin(), index.end(),
+        [&pool](CSharedStringPool::Offset a, CSharedStringPool::Offset b)
+        {
+            return wcscmp(pool.GetString(a), pool.GetString(b)) < 0;
+        });
+    pool.Publish(index.data(), index.size());
+    finish = PerfCounter();
+    PrintTime(start, finish, "Builder: sort and publish");
+
+    start = PerfCounter();
+    const SIZE_T found = LookupAll(pool);
+    finish = PerfCounter();
+    PrintTime(start, finish, "Builder: lookups");
+    if (found != shuffled.size())
+    {
+        cout << "Builder: lookups failed.\n";
+        return 1;
+    }
+
+    //
+    // Run the reader in a separate process; it prints its own timings
+    //
+    const wstring exePath = CCommandLine::GetExecutablePath();
+    wstring commandLine = L"\"" + exePath + L"\" /worker:shm-pool /segment:" + segmentName;
+
+    STARTUPINFOW si = {};
+    si.cb = sizeof(si);
+    PROCESS_INFORMATION pi = {};
+    if (!CreateProcessW(exePath.c_str(), &commandLine[0], nullptr, nullptr, FALSE,
+                        0, nullptr, nullptr, &si, &pi))
+    {
+        cout << "CreateProcess failed (error " << GetLastError() << ").\n";
+        return 1;
+    }
+
+    WaitForSingleObject(pi.hProcess, INFINITE);
+
+    DWORD exitCode = 1;
+    GetExitCodeProcess(pi.hProcess, &exitCode);
+    CloseHandle(pi.hThread);
+    CloseHandle(pi.hProcess);
+
+    return static_cast<int>(exitCode);
+}
+
+
+//---------------------------------------------------------------------------------------
+// Reader Process
+//---------------------------------------------------------------------------------------
+int RunSharedStringPoolWorker(const CCommandLine& cmdLine)
+{
+    const wchar_t* const segmentName = cmdLine.Find(L"/segment");
+    if (segmentName == nullptr)
+    {
+        return 1;
+    }
+
+    long long start = 0;
+    long long finish = 0;
+
+    CSharedStringPool pool;
+
+    start = PerfCounter();
+    pool.Attach(segmentName);
+    finish = PerfCounter();
+    PrintTime(start, finish, "Reader: attach");
+
+    start = PerfCounter();
+    const SIZE_T found = LookupAll(pool);
+    finish = PerfCounter();
+    PrintTime(start, finish, "Reader: lookups");
+    if (found != pool.GetIndexSize())
+    {
+        cout << "Reader: lookups failed.\n";
+        return 1;
+    }
+
+    // Reference: what attaching would cost if the reader had to copy the strings
+    CStringPoolAllocator privatePool;
+    start = PerfCounter();
+    for (SIZE_T i = 0; i < pool.GetIndexSize(); ++i)
+    {
+        privatePool.AllocString(pool.GetString(pool.GetIndexEntry(i)));
+    }
+    finish = PerfCounter();
+    PrintTime(start, finish, "Reader: copy into a private pool (reference)");
+
+    return 0;
+}
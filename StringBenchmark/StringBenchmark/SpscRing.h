@@ -0,0 +1,119 @@
+#pragma once
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Lock-Free Single-Producer Single-Consumer Ring
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <atomic>       // std::atomic
+#include <memory>       // std::unique_ptr
+
+
+//---------------------------------------------------------------------------------------
+// Bounded FIFO queue between exactly one producer thread and one consumer thread.
+//
+// Each side owns one index and only reads the other side's index when its cached copy
+// says the ring looks full (producer) or empty (consumer), so in the steady state the
+// two threads don't bounce each other's cache lines.
+//---------------------------------------------------------------------------------------
+template <typename T>
+class CSpscRing
+{
+public:
+    // Initialize an empty ring; capacity is rounded up to a power of two
+    explicit CSpscRing(size_t capacity);
+
+    // Producer thread only: append an item, or return false if the ring is full
+    bool TryPush(const T& item) noexcept;
+
+    // Consumer thread only: remove the oldest item, or return false if the ring is empty
+    bool TryPop(T& item) noexcept;
+
+
+    //
+    // Ban Copy
+    //
+private:
+    CSpscRing(const CSpscRing&) = delete;
+    CSpscRing& operator=(const CSpscRing&) = delete;
+
+
+    //
+    // IMPLEMENTATION
+    //
+private:
+    size_t                  m_mask;
+    std::unique_ptr<T[]>    m_slots;
+
+    // Consumer side: next slot to read, and the last tail seen
+    char                    m_padding1[64];
+    std::atomic<size_t>     m_head;
+    size_t                  m_cachedTail;
+
+    // Producer side: next slot to write, and the last head seen
+    char                    m_padding2[64 - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+    std::atomic<size_t>     m_tail;
+    size_t                  m_cachedHead;
+    char                    m_padding3[64 - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+};
+
+
+//=======================================================================================
+//                          Inline Method Implementations
+//=======================================================================================
+
+template <typename T>
+inline CSpscRing<T>::CSpscRing(size_t capacity)
+    : m_mask(0)
+    , m_head(0)
+    , m_cachedTail(0)
+    , m_tail(0)
+    , m_cachedHead(0)
+{
+    size_t roundedCapacity = 2;
+    while (roundedCapacity < capacity)
+    {
+        roundedCapacity *= 2;
+    }
+
+    m_mask = roundedCapacity - 1;
+    m_slots.reset(new T[roundedCapacity]);
+}
+
+template <typename T>
+inline bool CSpscRing<T>::TryPush(const T& item) noexcept
+{
+    const size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_cachedHead > m_mask)
+    {
+        // Looks full: refresh the consumer's position
+        m_cachedHead = m_head.load(std::memory_order_acquire);
+        if (tail - m_cachedHead > m_mask)
+        {
+            return false;
+        }
+    }
+
+    m_slots[tail & m_mask] = item;
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+inline bool CSpscRing<T>::TryPop(T& item) noexcept
+{
+    const size_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_cachedTail)
+    {
+        // Looks empty: refresh the producer's position
+        m_cachedTail = m_tail.load(std::memory_order_acquire);
+        if (head == m_cachedTail)
+        {
+            return false;
+        }
+    }
+
+    item = m_slots[head & m_mask];
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+}
@@ -8,11 +8,17 @@
 
 
 //
-// Define TEST_TINY_STRINGS to run the benchmark with tiny strings
-// (STL friendly thanks to SSO).
+// Run without arguments for the classic creation/sort benchmark.
+// Other benchmarks are selected with "/bench:<name>" (run with "/help" for the list).
 //
-// Uncomment the following line for testing with tiny strings:
-//#define TEST_TINY_STRINGS     1
+// TEST_TINY_STRINGS (tiny strings, STL friendly thanks to SSO) is defined
+// in BenchmarkCommon.h.
+//
+// STRING_POOL_LATENCY_HISTOGRAM (instrumented build: AllocString latency percentiles
+// of the POL creation phases) is defined in StringPool.h.
+//
+// STRING_POOL_TIMELINE (pool chunk events in the /timeline trace) and
+// STRING_POOL_REGISTRY (named pools) are defined in the project settings.
 //
 
 
@@ -21,146 +27,266 @@
 //---------------------------------------------------------------------------------------
 
 #include <crtdbg.h>     // _ASSERTE
-#include <algorithm>    // std::shuffle, std::sort
+#include <functional>   // std::function
 #include <iostream>     // std::cout
-#include <random>       // std::mt19937
-#include <string>       // std::wstring
+#include <memory>       // std::shared_ptr, std::unique_ptr
+#include <sstream>      // std::ostringstream, std::istringstream
+#include <string>       // std::string, std::to_string
+#include <utility>      // std::move
 #include <vector>       // std::vector
 
-#include <atlstr.h>     // CString
+#include <wchar.h>      // wcscmp
 
 #include <windows.h>    // Windows SDK API
 
-#include "StringPool.h" // Custom string pool allocator
+#include "StringPool.h"         // Custom string pool allocator
+#include "Contenders.h"         // ATL, STL and POL contenders
+#ifdef STRING_POOL_REGISTRY
+#include "StringPoolRegistry.h" // Named pools and their statistics
+#endif // STRING_POOL_REGISTRY
+#include "BenchmarkCommon.h"    // Common benchmark helpers
+#include "BenchmarkEnvironment.h"   // Thread pinning, environment report
+#include "Benchmarks.h"         // Additional benchmarks
 
 
 using std::cout;
 using std::vector;
-using std::wstring;
 
 
 
+namespace
+{
+
 //---------------------------------------------------------------------------------------
-// Performance Counter Helpers
+// Classic Benchmark: creation and sorting
+//
+// Each contender creates kClassicRoundCount vectors of the shuffled strings, one round
+// after the other, then sorts them. The rounds of all the contenders are interleaved
+// and printed as "ATL1", "STL1", "POL1", "ATL2"...
+// A contender is added with one RegisterContender call.
 //---------------------------------------------------------------------------------------
 
-inline long long PerfCounter() noexcept
-{
-    LARGE_INTEGER li;
-    QueryPerformanceCounter(&li);
-    return li.QuadPart;
-}
+constexpr unsigned kClassicRoundCount = 3;
 
-inline long long PerfFrequency() noexcept
-{
-    LARGE_INTEGER li;
-    QueryPerformanceFrequency(&li);
-    return li.QuadPart;
-}
 
-inline void PrintTime(const long long start, const long long finish, const char* const message)
+//---------------------------------------------------------------------------------------
+// Untimed set-up and report around the creation of a round: nothing by default.
+// The pooled strings fill a pool set up in advance, named for the registry dump and,
+// in the instrumented build, recording its AllocString latencies.
+//---------------------------------------------------------------------------------------
+template <typename Strings>
+struct ClassicCreationHooks
 {
-    cout << message << ": " << (finish - start) * 1000.0 / PerfFrequency() << " ms" << std::endl;
-}
+    void SetUp(const std::string& /* label */)
+    {
+    }
 
+    void Create(Strings& strings, const vector<const wchar_t*>& source)
+    {
+        strings.Create(source);
+    }
 
-//---------------------------------------------------------------------------------------
-//
-// Making Uniform String Comparisons
-// =================================
-//
-// Using "Step Into Specific", I found that in the VS 2019 implementation,
-// std::wstring uses wmemcmp for comparisons (file: <xstring>; line: 235).
-// On the other hand, ATL CString uses wcscmp (file: <cstringt.h>; line: 564).
-//
-// To make string comparisons uniform, I introduced the following helper functions
-// to always call wcscmp.
-//
-//---------------------------------------------------------------------------------------
+    void Report(Strings& /* strings */, const std::string& /* label */)
+    {
+    }
+};
 
-inline bool ComparePool(const wchar_t* psz1, const wchar_t* psz2)
+template <>
+struct ClassicCreationHooks<PooledStrings>
 {
-    return wcscmp(psz1, psz2) < 0;
-}
+    std::unique_ptr<CStringPoolAllocator>   pool;
+#ifdef STRING_POOL_LATENCY_HISTOGRAM
+    CLatencyHistogram                       allocLatency;
+#endif
 
-inline bool CompareStl(const std::wstring& s1, const std::wstring& s2)
-{
-    return wcscmp(s1.c_str(), s2.c_str()) < 0;
-}
+    void SetUp(const std::string& label)
+    {
+        pool.reset(new CStringPoolAllocator());
+#ifdef STRING_POOL_REGISTRY
+        pool->SetName(("classic " + label).c_str());
+#else
+        (void)label;
+#endif // STRING_POOL_REGISTRY
+#ifdef STRING_POOL_LATENCY_HISTOGRAM
+        allocLatency.Reset();
+        pool->SetLatencyHistogram(&allocLatency);
+#endif
+    }
 
-inline bool CompareAtl(const CString& s1, const CString& s2)
-{
-    // return wcscmp(s1, s2) < 0;
-    // ATL CString already uses wcscmp
-    return s1 < s2;
-}
+    void Create(PooledStrings& strings, const vector<const wchar_t*>& source)
+    {
+        strings.Create(source, std::move(pool));
+    }
 
+    void Report(PooledStrings& strings, const std::string& label)
+    {
+#ifdef STRING_POOL_LATENCY_HISTOGRAM
+        strings.pool->SetLatencyHistogram(nullptr);
+        allocLatency.Print(cout, (label + " AllocString latency").c_str());
+#else
+        (void)label;
+#endif
+#ifdef STRING_POOL_REGISTRY
+        strings.pool->PublishStats();
+#else
+        (void)strings;
+#endif // STRING_POOL_REGISTRY
+    }
+};
 
-//---------------------------------------------------------------------------------------
-// Benchmark
-//---------------------------------------------------------------------------------------
-int main()
+
+class CClassicBenchmark
 {
-    cout << " *** String Benchmark (2023) -- by Giovanni Dicanio *** \n\n";
+public:
+    // The source strings must outlive the benchmark
+    explicit CClassicBenchmark(const vector<const wchar_t*>& source)
+        : m_source(source)
+    {
+    }
 
-    // Build a vector of shuffled strings that will be used for the benchmark
-    const auto shuffled = []() -> vector<wstring>
+    // Register a contender of Contenders.h, printed as name followed by the round number
+    template <typename Strings>
+    void RegisterContender(const std::string& name);
+
+    // Run the creation rounds, then the sorting rounds, of all the contenders
+    void Run() const;
+
+
+    //
+    // Ban Copy
+    //
+private:
+    CClassicBenchmark(const CClassicBenchmark&) = delete;
+    CClassicBenchmark& operator=(const CClassicBenchmark&) = delete;
+
+
+    //
+    // IMPLEMENTATION
+    //
+private:
+    struct Contender
     {
-        const wstring lorem[] =
-        {
-            L"Lorem ipsum dolor sit amet, consectetuer adipiscing elit.",
-            L"Maecenas porttitor congue massa. Fusce posuere, magna sed",
-            L"pulvinar ultricies, purus lectus malesuada libero,",
-            L"sit amet commodo magna eros quis urna.",
-            L"Nunc viverra imperdiet enim. Fusce est. Vivamus a tellus.",
-            L"Pellentesque habitant morbi tristique senectus et netus et",
-            L"malesuada fames ac turpis egestas. Proin pharetra nonummy pede.",
-            L"Mauris et orci. [*** add more chars to prevent SSO ***]"
-        };
-
-        vector<wstring> v;
+        std::function<void(unsigned round)>     create;     // Timed and printed
+        std::function<void(unsigned round)>     sort;       // Timed and printed
+        std::function<void()>                   teardown;   // Untimed
+    };
+
+    const vector<const wchar_t*>&   m_source;
+    vector<Contender>               m_contenders;
+};
+
+
+template <typename Strings>
+void CClassicBenchmark::RegisterContender(const std::string& name)
+{
+    struct State
+    {
+        Strings                         rounds[kClassicRoundCount];
+        ClassicCreationHooks<Strings>   hooks;
+    };
+    const auto state = std::make_shared<State>();
+    const vector<const wchar_t*>& source = m_source;
+
+    Contender contender;
+    contender.create = [state, &source, name](unsigned round)
+    {
+        const std::string label = name + std::to_string(round + 1);
+        Strings& strings = state->rounds[round];
 
+        state->hooks.SetUp(label);
+        const long long start = PerfCounter();
+        state->hooks.Create(strings, source);
+        const long long finish = PerfCounter();
+        PrintTime(start, finish, label.c_str());
+        state->hooks.Report(strings, label);
+
+        // Sanity check in debug builds - the strings should be the source strings
 #ifdef _DEBUG
-        // Just a few strings in *slow running* debug builds
-        constexpr int kStringRepeatCount = 10;
-#else
-        // Lots of strings in release builds
-        constexpr int kStringRepeatCount = 400 * 1000; // 400K
+        for (size_t i = 0; i < source.size(); i++)
+        {
+            _ASSERTE(wcscmp(source[i], strings.GetString(i)) == 0);
+        }
 #endif // _DEBUG
+    };
+
+    contender.sort = [state, name](unsigned round)
+    {
+        const std::string label = name + std::to_string(round + 1);
 
-        for (int i = 0; i < kStringRepeatCount ; ++i)
+        const long long start = PerfCounter();
+        state->rounds[round].Sort();
+        const long long finish = PerfCounter();
+        PrintTime(start, finish, label.c_str());
+    };
+
+    contender.teardown = [state]
+    {
+        for (auto& strings : state->rounds)
         {
-            for (const auto & s : lorem)
-            {
-#ifdef TEST_TINY_STRINGS
-                // Tiny strings
-                UNREFERENCED_PARAMETER(s);
-                v.push_back(L"#" + std::to_wstring(i));
-#else
-                v.push_back(s + L" (#" + std::to_wstring(i) + L")");
-#endif
-            }
+            strings.Clear();
         }
+    };
 
-        std::mt19937 prng(1987);    // 1987 : Amiga 500! :)
+    m_contenders.push_back(std::move(contender));
+}
 
-        std::shuffle(v.begin(), v.end(), prng);
 
-        return v;
-    }();
+void CClassicBenchmark::Run() const
+{
+    //
+    // Measure creation times
+    // ----------------------
+    //
 
-    // shuffled_ptrs is a vector of raw *observing* pointers to the previous shuffled strings
-    const auto shuffled_ptrs = [&]() -> vector<const wchar_t*>
+    cout << "=== Creation === \n";
+
+    for (unsigned round = 0; round < kClassicRoundCount; ++round)
     {
-        vector<const wchar_t*> v;
+        for (const auto& contender : m_contenders)
+        {
+            contender.create(round);
+        }
+    }
+
+    cout << '\n';
+
+#ifdef STRING_POOL_REGISTRY
+    GetStringPoolRegistry().Dump(cout);
+    cout << '\n';
+#endif // STRING_POOL_REGISTRY
+
+
+    //
+    // Measure sorting times
+    // ---------------------
+    //
+
+    cout << "=== Sorting === \n";
 
-        for (const auto& s : shuffled)
+    for (unsigned round = 0; round < kClassicRoundCount; ++round)
+    {
+        for (const auto& contender : m_contenders)
         {
-            v.push_back(s.c_str());
+            contender.sort(round);
         }
+    }
+
+    for (const auto& contender : m_contenders)
+    {
+        contender.teardown();
+    }
+}
+
+} // namespace
 
-        return v;
-    }();
+
+static int RunCreationSortBenchmark()
+{
+    // Build a vector of shuffled strings that will be used for the benchmark
+    const auto shuffled = BuildShuffledStrings();
+
+    // shuffled_ptrs is a vector of raw *observing* pointers to the previous shuffled strings
+    const auto shuffled_ptrs = BuildStringPointers(shuffled);
 
 #ifdef TEST_TINY_STRINGS
     cout << "Testing tiny strings (STL friendly thanks to SSO).\n";
@@ -176,171 +302,272 @@ int main()
         cout << shuffled.size() << "\n\n";
     }
 
-    long long start = 0;
-    long long finish = 0;
-
-    CStringPoolAllocator stringPool;
+    CClassicBenchmark benchmark(shuffled_ptrs);
+    benchmark.RegisterContender<AtlStrings>("ATL");
+    benchmark.RegisterContender<StlStrings>("STL");
+    benchmark.RegisterContender<PooledStrings>("POL");
+    benchmark.Run();
 
+    return 0;
+}
 
-    //
-    // Measure creation times
-    // ----------------------
-    //
-
-    cout << "=== Creation === \n";
 
-    //
-    // Creation #1
-    //
+//---------------------------------------------------------------------------------------
+// Benchmark Table
+//---------------------------------------------------------------------------------------
 
-    start = PerfCounter();
-    vector<ATL::CStringW> atl1(shuffled_ptrs.begin(), shuffled_ptrs.end());
-    finish = PerfCounter();
-    PrintTime(start, finish, "ATL1");
-
-    start = PerfCounter();
-//  vector<wstring> stl1 = shuffled; // <-- this would be unfairly advantageous for vector<wstring>
-    vector<wstring> stl1(shuffled_ptrs.begin(), shuffled_ptrs.end());
-    finish = PerfCounter();
-    PrintTime(start, finish, "STL1");
-
-    start = PerfCounter();
-    vector<const wchar_t*> pool1;
-    pool1.reserve(shuffled_ptrs.size());
-    for (auto psz : shuffled_ptrs)
-    {
-        pool1.push_back(stringPool.AllocString(psz));
-    }
-    finish = PerfCounter();
-    PrintTime(start, finish, "POL1");
+struct BenchmarkEntry
+{
+    const wchar_t*  name;                           // Selected with "/bench:<name>"
+    int             (*run)(const CCommandLine&);    // Benchmark entry point
+    int             (*worker)(const CCommandLine&); // Child process entry point ("/worker:<name>"), if any
+    const char*     description;                    // Printed by "/help"
+};
 
-    //
-    // Sanity check in debug builds - the vectors should contain the same strings
-    //
-#ifdef _DEBUG
-    for (size_t i = 0; i < shuffled_ptrs.size(); i++)
+static const BenchmarkEntry g_benchmarks[] =
+{
+    { L"shared-pool", RunSharedPoolBenchmark, RunSharedPoolWorker,
+      "Frozen pool shared with worker processes vs. private per-worker copies "
+      "[/workers:N]" },
+    { L"shm-pool", RunSharedStringPoolBenchmark, RunSharedStringPoolWorker,
+      "Named shared-memory pool with offset-based strings: builder and reader processes" },
+    { L"thread-pool", RunThreadPoolBenchmark, nullptr,
+      "Work-stealing pool overhead vs. std::thread/std::async, and parallel creation, "
+      "sort and lookup [/threads:N]" },
+    { L"hash-build", RunHashBuildBenchmark, nullptr,
+      "Hash set over pooled keys: single-threaded vs. concurrent vs. radix-partitioned build "
+      "[/threads:N] [/partition-bits:B]" },
+    { L"hash-lookup", RunHashLookupBenchmark, nullptr,
+      "Hash set lookups one at a time vs. batched with group prefetching [/batch:N]" },
+    { L"handoff", RunHandoffBenchmark, nullptr,
+      "Strings created on a producer thread and released on a consumer thread, "
+      "STL vs. pools retired as a whole [/passes:N] [/interval:ms] [/retire:N] [/ring:N]" },
+    { L"server", RunServerBenchmark, nullptr,
+      "Request-scoped strings in a simulated server: STL vs. pool per request vs. "
+      "reset-and-reuse pool [/threads:N] [/requests:N] [/chunk:bytes] [/record-trace:path]" },
+    { L"churn", RunChurnBenchmark, nullptr,
+      "Long-running allocation churn with random lifetimes, STL vs. epoch-scoped pools; "
+      "CSV time series of memory and throughput "
+      "[/epochs:N] [/per-epoch:N] [/max-lifetime:E] [/sample:N] [/reuse]" },
+    { L"trace", RunTraceReplayBenchmark, nullptr,
+      "Replay an allocation trace (from a file, or synthetic) against ATL, STL and POL "
+      "[/trace:path] [/save-trace:path] [/trace-threads:N] [/lifetimes:N] [/seed:N] [/chunk:bytes]" },
+    { L"word-count", RunWordCountBenchmark, nullptr,
+      "Word-frequency application: tokenize, count and top-N, STL vs. zero-copy pooled tokens, "
+      "single- and multi-threaded [/mb:N] [/top:N] [/threads:N]" },
+    { L"hash-join", RunHashJoinBenchmark, nullptr,
+      "Join of two string-keyed relations: unordered_map vs. pooled-key flat table vs. sort-merge "
+      "[/build:N] [/probe:N] [/overlap:percent] [/skew:theta]" },
+    { L"cold-cache", RunColdCacheBenchmark, nullptr,
+      "Creation and sort phases with warm vs. cold caches (LLC sweep or clflush) "
+      "[/iterations:N] [/evict:sweep|flush] [/sweep-mb:N] [/drop-pages]" },
+    { L"scan", RunScanBenchmark, nullptr,
+      "Read all the strings in allocation, shuffled and sorted order: ns, cycles and "
+      "hardware counter events per string [/passes:N] [/pmc:index]" },
+    { L"roofline", RunRooflineBenchmark, nullptr,
+      "Creation phases as bytes copied per second and percent of the calibrated memcpy "
+      "bandwidth [/runs:N]" },
+    { L"noisy", RunNoisyNeighbourBenchmark, nullptr,
+      "Creation, sort and lookup slowdown under background memory bandwidth or cache pressure "
+      "[/neighbours:N] [/pressure:bandwidth|cache] [/mb:N] [/runs:N]" },
+    { L"micro", RunMicroBenchmarks, nullptr,
+      "Registered microbenchmarks: wcslen/wmemcpy, AllocString fast and slow paths, "
+      "per-contender creation and sort [/filter:text] [/repetitions:N]" },
+    { L"scaling", RunScalingBenchmark, nullptr,
+      "Creation, sort, scan and teardown ns/string from 1K to 100M strings, as CSV "
+      "[/min:N] [/max:N]" },
+    { L"phase-loop", RunPhaseLoopBenchmark, nullptr,
+      "Loop one phase of one contender for a fixed time, enabling a profiler (perf control "
+      "FIFO) around it /contender:ATL|STL|POL /phase:creation|sort|scan [/seconds:N] "
+      "[/profile-control:path] [/profile-ack:path] [/profile-markers:path]" },
+    { L"energy", RunEnergyBenchmark, nullptr,
+      "Energy (RAPL package and DRAM meters, when readable) of the creation, sort, scan and "
+      "teardown phases of ATL, STL and POL, in joules and nJ per string [/runs:N]" },
+    { L"locality", RunLocalityBenchmark, nullptr,
+      "Distinct pages and cache lines touched, and average stride, visiting the ATL, STL "
+      "and POL strings in creation, shuffled or sorted order [/order:name] [/window:N]" },
+    { L"budget", RunBudgetBenchmark, nullptr,
+      "Cost of the pool byte budget checks on the slow path, in ns per new chunk: no "
+      "budget, within budget, soft-limit callback, Reset from the callback, hard-limit refusal "
+      "[/chunks:N]" },
+};
+
+static void PrintUsage()
+{
+    cout << "Usage: StringBenchmark [/bench:<name>] [/env] [/pin[:cores|:list]] [/high-priority]\n"
+         << "                       [/timeline[:file.json]] [options]\n\n"
+         << "Without /bench, runs the classic creation/sort benchmark.\n"
+         << "/env prints the environment report (CPU topology and frequency, power, load,\n"
+         << "pinning) with warnings about noisy conditions; the /bench benchmarks always do.\n"
+         << "/pin pins the benchmark threads to one logical processor per core (cores), or to\n"
+         << "the given comma-separated logical processors; /high-priority raises the process\n"
+         << "priority class.\n"
+         << "/timeline records phases, pool chunk allocations and thread pool activity, and\n"
+         << "writes them as Chrome trace-event JSON at exit (default: timeline.json).\n\n"
+         << "Benchmarks:\n";
+    for (const auto& entry : g_benchmarks)
     {
-        ATLASSERT(wcscmp(shuffled_ptrs[i], atl1[i].GetString()) == 0);
-        ATLASSERT(wcscmp(shuffled_ptrs[i], stl1[i].c_str()    ) == 0);
-        ATLASSERT(wcscmp(shuffled_ptrs[i], pool1[i]           ) == 0);
+        cout << "  " << NarrowAscii(entry.name) << " -- " << entry.description << '\n';
     }
-#endif // _DEBUG
-
-    //
-    // Creation #2
-    //
+}
 
-    start = PerfCounter();
-    vector<ATL::CStringW> atl2(shuffled_ptrs.begin(), shuffled_ptrs.end());
-    finish = PerfCounter();
-    PrintTime(start, finish, "ATL2");
 
-    start = PerfCounter();
-    vector<wstring> stl2(shuffled_ptrs.begin(), shuffled_ptrs.end());
-    finish = PerfCounter();
-    PrintTime(start, finish, "STL2");
+//---------------------------------------------------------------------------------------
+// Benchmarks that print CSV get the banner, the environment report and the timeline notes
+// as '#' comment lines, so that their output loads as is in CSV readers
+//---------------------------------------------------------------------------------------
+static bool PrintsCsv(const CCommandLine& cmdLine)
+{
+    const wchar_t* const benchName = cmdLine.Find(L"/bench");
+    return benchName != nullptr && (wcscmp(benchName, L"scaling") == 0 || wcscmp(benchName, L"churn") == 0);
+}
 
-    start = PerfCounter();
-    vector<const wchar_t*> pool2;
-    pool2.reserve(shuffled_ptrs.size());
-    for (auto psz : shuffled_ptrs)
+static void PrintNotes(const std::string& text, bool bComment)
+{
+    if (!bComment)
     {
-        pool2.push_back(stringPool.AllocString(psz));
+        cout << text;
+        return;
     }
-    finish = PerfCounter();
-    PrintTime(start, finish, "POL2");
 
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line))
+    {
+        cout << (line.empty() ? "#" : "# " + line) << '\n';
+    }
+}
 
-    //
-    // Creation #3
-    //
 
-    start = PerfCounter();
-    vector<ATL::CStringW> atl3(shuffled_ptrs.begin(), shuffled_ptrs.end());
-    finish = PerfCounter();
-    PrintTime(start, finish, "ATL3");
+//---------------------------------------------------------------------------------------
+// Stabilize the environment as requested on the command line (thread pinning, priority),
+// enable the timeline tracer (/timeline), and record the conditions the benchmark runs
+// in, warning about the noisy ones. The report samples the system load for a while, so
+// the classic benchmark skips it unless /env asks for it, and keeps its original output
+//---------------------------------------------------------------------------------------
+static void SetUpEnvironment(const CCommandLine& cmdLine)
+{
+    const wchar_t* const pinList = cmdLine.Find(L"/pin");
+    if (pinList != nullptr)
+    {
+        const CpuTopology topology = GetCpuTopology();
+        GetThreadPinning().SetProcessors(
+            CThreadPinning::ParseProcessors(*pinList != L'\0' ? pinList : L"cores", topology));
 
-    start = PerfCounter();
-    vector<wstring> stl3(shuffled_ptrs.begin(), shuffled_ptrs.end());
-    finish = PerfCounter();
-    PrintTime(start, finish, "STL3");
+        // The main thread is benchmark thread #0
+        if (!PinBenchmarkThread(0))
+        {
+            throw std::runtime_error("Can't pin the main thread (SetThreadAffinityMask failed).");
+        }
+    }
 
-    start = PerfCounter();
-    vector<const wchar_t*> pool3;
-    pool3.reserve(shuffled_ptrs.size());
-    for (auto psz : shuffled_ptrs)
+    if (cmdLine.Has(L"/high-priority") && !SetPriorityClass(GetCurrentProcess(), HIGH_PRIORITY_CLASS))
     {
-        pool3.push_back(stringPool.AllocString(psz));
+        throw std::runtime_error("Can't raise the process priority (SetPriorityClass failed).");
     }
-    finish = PerfCounter();
-    PrintTime(start, finish, "POL3");
-
-    cout << '\n';
 
+#ifdef STRING_POOL_REGISTRY
+    // Ctrl+Break lists the named string pools; failing to install the handler (e.g. without
+    // a console) only loses that
+    CStringPoolRegistry::EnableDumpOnCtrlBreak();
+#endif // STRING_POOL_REGISTRY
 
-    //
-    // Measure sorting times
-    // ---------------------
-    //
-
-    cout << "=== Sorting === \n";
+    if (cmdLine.Has(L"/timeline"))
+    {
+        GetTimelineTracer().Enable();
+        GetTimelineTracer().SetThreadName("main");
+    }
 
-    //
-    // Sort #1
-    //
+    if (cmdLine.Has(L"/bench") || cmdLine.Has(L"/env"))
+    {
+        std::ostringstream report;
+        PrintBenchmarkEnvironment(report, QueryBenchmarkEnvironment(), GetThreadPinning());
+        report << '\n';
+        PrintNotes(report.str(), PrintsCsv(cmdLine));
+    }
+}
 
-    start = PerfCounter();
-    sort(atl1.begin(), atl1.end(), CompareAtl);
-    finish = PerfCounter();
-    PrintTime(start, finish, "ATL1");
 
-    start = PerfCounter();
-    sort(stl1.begin(), stl1.end(), CompareStl);
-    finish = PerfCounter();
-    PrintTime(start, finish, "STL1");
+//---------------------------------------------------------------------------------------
+// Run the benchmark selected by /bench (the classic one without /bench)
+//---------------------------------------------------------------------------------------
+static int RunSelectedBenchmark(const CCommandLine& cmdLine)
+{
+    const wchar_t* const benchName = cmdLine.Find(L"/bench");
+    if (benchName == nullptr)
+    {
+        return RunCreationSortBenchmark();
+    }
 
-    start = PerfCounter();
-    sort(pool1.begin(), pool1.end(), ComparePool);
-    finish = PerfCounter();
-    PrintTime(start, finish, "POL1");
+    for (const auto& entry : g_benchmarks)
+    {
+        if (wcscmp(entry.name, benchName) == 0)
+        {
+            return entry.run(cmdLine);
+        }
+    }
 
+    cout << "Unknown benchmark: " << NarrowAscii(benchName) << "\n\n";
+    PrintUsage();
+    return 1;
+}
 
-    //
-    // Sort #2
-    //
 
-    start = PerfCounter();
-    sort(atl2.begin(), atl2.end(), CompareAtl);
-    finish = PerfCounter();
-    PrintTime(start, finish, "ATL2");
+//---------------------------------------------------------------------------------------
+// Entry Point
+//---------------------------------------------------------------------------------------
+int wmain(int argc, wchar_t* argv[])
+{
+    const CCommandLine cmdLine(argc, argv);
 
-    start = PerfCounter();
-    sort(stl2.begin(), stl2.end(), CompareStl);
-    finish = PerfCounter();
-    PrintTime(start, finish, "STL2");
+    try
+    {
+        // Worker processes spawned by the multi-process benchmarks
+        const wchar_t* const workerName = cmdLine.Find(L"/worker");
+        if (workerName != nullptr)
+        {
+            for (const auto& entry : g_benchmarks)
+            {
+                if (entry.worker != nullptr && wcscmp(entry.name, workerName) == 0)
+                {
+                    return entry.worker(cmdLine);
+                }
+            }
+            return 1;
+        }
 
-    start = PerfCounter();
-    sort(pool2.begin(), pool2.end(), ComparePool);
-    finish = PerfCounter();
-    PrintTime(start, finish, "POL2");
+        PrintNotes(" *** String Benchmark (2023) -- by Giovanni Dicanio *** \n\n", PrintsCsv(cmdLine));
 
+        if (cmdLine.Has(L"/help") || cmdLine.Has(L"/?"))
+        {
+            PrintUsage();
+            return 0;
+        }
 
-    //
-    // Sort #3
-    //
+        SetUpEnvironment(cmdLine);
 
-    start = PerfCounter();
-    sort(atl3.begin(), atl3.end(), CompareAtl);
-    finish = PerfCounter();
-    PrintTime(start, finish, "ATL3");
+        const int result = RunSelectedBenchmark(cmdLine);
 
-    start = PerfCounter();
-    sort(stl3.begin(), stl3.end(), CompareStl);
-    finish = PerfCounter();
-    PrintTime(start, finish, "STL3");
+        const wchar_t* const timelinePath = cmdLine.Find(L"/timeline");
+        if (timelinePath != nullptr)
+        {
+            const wchar_t* const path = (*timelinePath != L'\0') ? timelinePath : L"timeline.json";
+            GetTimelineTracer().Write(path);
+            std::ostringstream notes;
+            notes << "\nTimeline trace written to " << NarrowAscii(path) << '\n';
+            if (GetTimelineTracer().GetDroppedCount() != 0)
+            {
+                notes << "WARNING: " << GetTimelineTracer().GetDroppedCount()
+                      << " timeline events dropped (thread buffers full).\n";
+            }
+            PrintNotes(notes.str(), PrintsCsv(cmdLine));
+        }
 
-    start = PerfCounter();
-    sort(pool3.begin(), pool3.end(), ComparePool);
-    finish = PerfCounter();
-    PrintTime(start, finish, "POL3");
+        return result;
+    }
+    catch (const std::exception& e)
+    {
+        cout << "\n*** ERROR: " << e.what() << '\n';
+        return 1;
+    }
 }
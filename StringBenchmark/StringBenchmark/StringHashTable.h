@@ -0,0 +1,557 @@
+#pragma once
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Hash Sets over Pooled Strings
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <crtdbg.h>     // _ASSERTE
+#include <wchar.h>      // wcscmp
+#include <algorithm>    // std::min
+#include <atomic>       // std::atomic
+#include <memory>       // std::unique_ptr
+#include <vector>       // std::vector
+
+#include <Windows.h>    // Windows Platform SDK, PreFetchCacheLine
+
+#include "ThreadPool.h" // CWorkStealingThreadPool
+
+
+//
+// The hash sets below don't own the strings: they store pointers to strings owned by
+// someone else (typically a CStringPoolAllocator), together with their hash values,
+// so that most mismatching probes are rejected without touching the string memory.
+//
+
+
+//---------------------------------------------------------------------------------------
+// Hash of a NUL-terminated string: 64-bit FNV-1a, followed by a final avalanche step
+// (from MurmurHash3's fmix64), so that both the low bits (used for bucket indexes) and
+// the high bits (used for partitioning) are well distributed.
+// Never returns 0, which the hash sets use to mark empty slots.
+//---------------------------------------------------------------------------------------
+
+// Final avalanche step, shared by the HashString overloads
+inline ULONGLONG FinalizeStringHash(ULONGLONG hash) noexcept
+{
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+
+    return (hash != 0) ? hash : 1;
+}
+
+inline ULONGLONG HashString(PCWSTR psz) noexcept
+{
+    _ASSERTE(psz != nullptr);
+
+    ULONGLONG hash = 14695981039346656037ULL;
+    for (; *psz != L'\0'; ++psz)
+    {
+        hash ^= static_cast<ULONGLONG>(*psz);
+        hash *= 1099511628211ULL;
+    }
+
+    return FinalizeStringHash(hash);
+}
+
+// Same hash for the [begin, end) character interval (e.g. a token in a bigger text,
+// not NUL-terminated): equal to HashString of a NUL-terminated copy of the characters
+inline ULONGLONG HashString(const WCHAR* pchBegin, const WCHAR* pchEnd) noexcept
+{
+    _ASSERTE(pchBegin != nullptr);
+    _ASSERTE(pchBegin <= pchEnd);
+
+    ULONGLONG hash = 14695981039346656037ULL;
+    for (; pchBegin != pchEnd; ++pchBegin)
+    {
+        hash ^= static_cast<ULONGLONG>(*pchBegin);
+        hash *= 1099511628211ULL;
+    }
+
+    return FinalizeStringHash(hash);
+}
+
+
+//---------------------------------------------------------------------------------------
+// Single-threaded hash set: open addressing with linear probing
+//---------------------------------------------------------------------------------------
+class CStringHashSet
+{
+public:
+    // Initialize the set, sized to hold expectedCount strings without growing
+    explicit CStringHashSet(size_t expectedCount = 0);
+
+    // Make room for expectedCount strings without growing
+    void Reserve(size_t expectedCount);
+
+    // Insert a string; return false if it was already present
+    bool Insert(PCWSTR psz);
+    bool Insert(PCWSTR psz, ULONGLONG hash);
+
+    // Is the string in the set?
+    bool Contains(PCWSTR psz) const noexcept;
+    bool Contains(PCWSTR psz, ULONGLONG hash) const noexcept;
+
+    // Look up count strings at once: results[i] tells whether queries[i] is in the set.
+    // The queries are processed in groups, interleaving their cache misses (group prefetching):
+    // hash all the queries of a group and prefetch their home slots, then prefetch the
+    // candidate strings those slots point to, and only then compare.
+    void ContainsBatch(const PCWSTR* queries, size_t count, bool* results) const noexcept;
+
+    // Number of strings in the set
+    size_t GetSize() const noexcept;
+
+private:
+    struct Slot
+    {
+        ULONGLONG   hash;   // 0 for empty slots
+        PCWSTR      psz;
+    };
+
+    enum
+    {
+        // Queries whose cache misses are overlapped by ContainsBatch: large enough to
+        // cover the memory latency, small enough for the group's slots to stay in L1
+        kPrefetchGroupSize = 16
+    };
+
+    std::vector<Slot>   m_slots;        // Power-of-two number of slots
+    size_t              m_count = 0;    // Number of strings in the set
+
+    // Rehash into a table of the given (power-of-two) number of slots
+    void Rehash(size_t slotCount);
+
+    // Number of slots to keep the load factor at most 1/2
+    static size_t SlotCountFor(size_t count) noexcept;
+};
+
+
+//---------------------------------------------------------------------------------------
+// Concurrent hash set: fixed capacity, lock-free insertion from any number of threads
+//---------------------------------------------------------------------------------------
+class CConcurrentStringHashSet
+{
+public:
+    // Initialize the set, sized to hold up to maxCount strings (it never grows)
+    explicit CConcurrentStringHashSet(size_t maxCount);
+
+    // Insert a string (thread-safe); return false if it was already present
+    bool Insert(PCWSTR psz, ULONGLONG hash) noexcept;
+
+    // Is the string in the set? (Not synchronized with concurrent insertions.)
+    bool Contains(PCWSTR psz, ULONGLONG hash) const noexcept;
+
+private:
+    //
+    // A slot is claimed by CAS-ing its hash from 0; the string pointer is stored right after,
+    // with release semantics. A thread finding a matching hash with a still null pointer
+    // waits for the pointer to be published.
+    //
+    std::unique_ptr<std::atomic<ULONGLONG>[]>   m_hashes;
+    std::unique_ptr<std::atomic<PCWSTR>[]>      m_strings;
+    size_t                                      m_mask;
+};
+
+
+//---------------------------------------------------------------------------------------
+// Radix-partitioned hash set, built in parallel without synchronization
+//
+// The top bits of the hash select one of 2^partitionBits independent CStringHashSets.
+// Build runs in two passes over the keys:
+//
+//  1. Each thread hashes a block of keys and counts them per partition
+//  2. Each thread scatters its (hash, key) pairs into a per-partition region of a
+//     shared buffer; the regions are computed from the counts, so no two threads
+//     ever write to the same place
+//
+// then each partition's set is built by a single thread from its region.
+//---------------------------------------------------------------------------------------
+class CPartitionedStringHashSet
+{
+public:
+    // Build the set from count (distinct or not) keys, with 2^partitionBits partitions
+    void Build(CWorkStealingThreadPool& threadPool, const PCWSTR* keys, size_t count,
+               unsigned partitionBits);
+
+    // Is the string in the set?
+    bool Contains(PCWSTR psz) const noexcept;
+    bool Contains(PCWSTR psz, ULONGLONG hash) const noexcept;
+
+    // Number of strings in the set
+    size_t GetSize() const noexcept;
+
+private:
+    std::vector<CStringHashSet> m_partitions;
+    unsigned                    m_partitionBits = 0;
+
+    size_t PartitionOf(ULONGLONG hash) const noexcept;
+};
+
+
+//=======================================================================================
+//                          Inline Method Implementations
+//=======================================================================================
+
+inline CStringHashSet::CStringHashSet(size_t expectedCount)
+{
+    Rehash(SlotCountFor(expectedCount));
+}
+
+
+inline size_t CStringHashSet::SlotCountFor(size_t count) noexcept
+{
+    size_t slotCount = 16;
+    while (slotCount < count * 2)
+    {
+        slotCount *= 2;
+    }
+    return slotCount;
+}
+
+
+inline void CStringHashSet::Reserve(size_t expectedCount)
+{
+    const size_t slotCount = SlotCountFor(expectedCount);
+    if (slotCount > m_slots.size())
+    {
+        Rehash(slotCount);
+    }
+}
+
+
+inline void CStringHashSet::Rehash(size_t slotCount)
+{
+    std::vector<Slot> oldSlots(slotCount, Slot{ 0, nullptr });
+    oldSlots.swap(m_slots);
+
+    const size_t mask = m_slots.size() - 1;
+    for (const Slot& slot : oldSlots)
+    {
+        if (slot.hash == 0)
+        {
+            continue;
+        }
+
+        size_t i = static_cast<size_t>(slot.hash) & mask;
+        while (m_slots[i].hash != 0)
+        {
+            i = (i + 1) & mask;
+        }
+        m_slots[i] = slot;
+    }
+}
+
+
+inline bool CStringHashSet::Insert(PCWSTR psz)
+{
+    return Insert(psz, HashString(psz));
+}
+
+
+inline bool CStringHashSet::Insert(PCWSTR psz, ULONGLONG hash)
+{
+    _ASSERTE(psz != nullptr);
+    _ASSERTE(hash != 0);
+
+    if ((m_count + 1) * 2 > m_slots.size())
+    {
+        Rehash(m_slots.size() * 2);
+    }
+
+    const size_t mask = m_slots.size() - 1;
+    for (size_t i = static_cast<size_t>(hash) & mask; ; i = (i + 1) & mask)
+    {
+        Slot& slot = m_slots[i];
+        if (slot.hash == 0)
+        {
+            slot.hash = hash;
+            slot.psz  = psz;
+            ++m_count;
+            return true;
+        }
+
+        if (slot.hash == hash && wcscmp(slot.psz, psz) == 0)
+        {
+            return false;
+        }
+    }
+}
+
+
+inline bool CStringHashSet::Contains(PCWSTR psz) const noexcept
+{
+    return Contains(psz, HashString(psz));
+}
+
+
+inline bool CStringHashSet::Contains(PCWSTR psz, ULONGLONG hash) const noexcept
+{
+    _ASSERTE(psz != nullptr);
+
+    const size_t mask = m_slots.size() - 1;
+    for (size_t i = static_cast<size_t>(hash) & mask; ; i = (i + 1) & mask)
+    {
+        const Slot& slot = m_slots[i];
+        if (slot.hash == 0)
+        {
+            return false;
+        }
+
+        if (slot.hash == hash && wcscmp(slot.psz, psz) == 0)
+        {
+            return true;
+        }
+    }
+}
+
+
+inline void CStringHashSet::ContainsBatch(const PCWSTR* queries, size_t count,
+                                          bool* results) const noexcept
+{
+    _ASSERTE(queries != nullptr || count == 0);
+    _ASSERTE(results != nullptr || count == 0);
+
+    const size_t mask = m_slots.size() - 1;
+    ULONGLONG hashes[kPrefetchGroupSize];
+
+    for (size_t groupBegin = 0; groupBegin < count; groupBegin += kPrefetchGroupSize)
+    {
+        const size_t groupSize = (std::min)(static_cast<size_t>(kPrefetchGroupSize),
+                                            count - groupBegin);
+        const PCWSTR* const groupQueries = queries + groupBegin;
+
+        // Stage 1: hash the queries, and prefetch their home slots
+        for (size_t i = 0; i < groupSize; ++i)
+        {
+            hashes[i] = HashString(groupQueries[i]);
+            PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, &m_slots[static_cast<size_t>(hashes[i]) & mask]);
+        }
+
+        // Stage 2: prefetch the candidate strings in the pool
+        for (size_t i = 0; i < groupSize; ++i)
+        {
+            const Slot& slot = m_slots[static_cast<size_t>(hashes[i]) & mask];
+            if (slot.hash == hashes[i])
+            {
+                PreFetchCacheLine(PF_TEMPORAL_LEVEL_1, slot.psz);
+            }
+        }
+
+        // Stage 3: compare (probing further only on collisions)
+        for (size_t i = 0; i < groupSize; ++i)
+        {
+            results[groupBegin + i] = Contains(groupQueries[i], hashes[i]);
+        }
+    }
+}
+
+
+inline size_t CStringHashSet::GetSize() const noexcept
+{
+    return m_count;
+}
+
+
+inline CConcurrentStringHashSet::CConcurrentStringHashSet(size_t maxCount)
+{
+    size_t slotCount = 16;
+    while (slotCount < maxCount * 2)
+    {
+        slotCount *= 2;
+    }
+
+    // Value-initialization zeroes the atomics
+    m_hashes.reset(new std::atomic<ULONGLONG>[slotCount]());
+    m_strings.reset(new std::atomic<PCWSTR>[slotCount]());
+    m_mask = slotCount - 1;
+}
+
+
+inline bool CConcurrentStringHashSet::Insert(PCWSTR psz, ULONGLONG hash) noexcept
+{
+    _ASSERTE(psz != nullptr);
+    _ASSERTE(hash != 0);
+
+    for (size_t i = static_cast<size_t>(hash) & m_mask; ; i = (i + 1) & m_mask)
+    {
+        ULONGLONG slotHash = m_hashes[i].load(std::memory_order_relaxed);
+        if (slotHash == 0)
+        {
+            if (m_hashes[i].compare_exchange_strong(slotHash, hash, std::memory_order_relaxed))
+            {
+                m_strings[i].store(psz, std::memory_order_release);
+                return true;
+            }
+            // Lost the race: slotHash now holds the winner's hash
+        }
+
+        if (slotHash == hash)
+        {
+            PCWSTR pszSlot;
+            while ((pszSlot = m_strings[i].load(std::memory_order_acquire)) == nullptr)
+            {
+                YieldProcessor();
+            }
+
+            if (wcscmp(pszSlot, psz) == 0)
+            {
+                return false;
+            }
+        }
+    }
+}
+
+
+inline bool CConcurrentStringHashSet::Contains(PCWSTR psz, ULONGLONG hash) const noexcept
+{
+    _ASSERTE(psz != nullptr);
+
+    for (size_t i = static_cast<size_t>(hash) & m_mask; ; i = (i + 1) & m_mask)
+    {
+        const ULONGLONG slotHash = m_hashes[i].load(std::memory_order_relaxed);
+        if (slotHash == 0)
+        {
+            return false;
+        }
+
+        if (slotHash == hash)
+        {
+            const PCWSTR pszSlot = m_strings[i].load(std::memory_order_acquire);
+            if (pszSlot != nullptr && wcscmp(pszSlot, psz) == 0)
+            {
+                return true;
+            }
+        }
+    }
+}
+
+
+inline size_t CPartitionedStringHashSet::PartitionOf(ULONGLONG hash) const noexcept
+{
+    return static_cast<size_t>(hash >> (64 - m_partitionBits));
+}
+
+
+inline void CPartitionedStringHashSet::Build(CWorkStealingThreadPool& threadPool,
+                                             const PCWSTR* keys, size_t count,
+                                             unsigned partitionBits)
+{
+    _ASSERTE(keys != nullptr || count == 0);
+    _ASSERTE(partitionBits >= 1 && partitionBits <= 16);
+
+    m_partitionBits = partitionBits;
+    const size_t partitionCount = size_t(1) << partitionBits;
+
+    // One block of keys per thread
+    const size_t blockCount = threadPool.GetThreadCount();
+    const size_t blockSize  = (count + blockCount - 1) / blockCount;
+
+    struct Entry
+    {
+        ULONGLONG   hash;
+        PCWSTR      psz;
+    };
+
+    std::vector<ULONGLONG> hashes(count);
+    std::vector<size_t> counts(blockCount * partitionCount, 0);
+
+    //
+    // Pass 1: hash the keys, and build a histogram of the partitions for each block
+    //
+    threadPool.ParallelFor(0, blockCount, 1, [&](size_t firstBlock, size_t lastBlock)
+    {
+        for (size_t block = firstBlock; block < lastBlock; ++block)
+        {
+            size_t* const blockCounts = &counts[block * partitionCount];
+            const size_t end = (std::min)(count, (block + 1) * blockSize);
+            for (size_t i = block * blockSize; i < end; ++i)
+            {
+                const ULONGLONG hash = HashString(keys[i]);
+                hashes[i] = hash;
+                ++blockCounts[PartitionOf(hash)];
+            }
+        }
+    });
+
+    //
+    // Exclusive prefix sums, partition-major: each partition gets a contiguous region,
+    // split into one sub-region per block
+    //
+    std::vector<size_t> partitionBegin(partitionCount + 1);
+    size_t offset = 0;
+    for (size_t partition = 0; partition < partitionCount; ++partition)
+    {
+        partitionBegin[partition] = offset;
+        for (size_t block = 0; block < blockCount; ++block)
+        {
+            const size_t blockPartitionCount = counts[block * partitionCount + partition];
+            counts[block * partitionCount + partition] = offset;    // Now a write cursor
+            offset += blockPartitionCount;
+        }
+    }
+    partitionBegin[partitionCount] = offset;
+
+    //
+    // Pass 2: scatter the entries in their partitions
+    //
+    std::vector<Entry> entries(count);
+    threadPool.ParallelFor(0, blockCount, 1, [&](size_t firstBlock, size_t lastBlock)
+    {
+        for (size_t block = firstBlock; block < lastBlock; ++block)
+        {
+            size_t* const cursors = &counts[block * partitionCount];
+            const size_t end = (std::min)(count, (block + 1) * blockSize);
+            for (size_t i = block * blockSize; i < end; ++i)
+            {
+                const ULONGLONG hash = hashes[i];
+                entries[cursors[PartitionOf(hash)]++] = Entry{ hash, keys[i] };
+            }
+        }
+    });
+
+    //
+    // Build each partition's set on a single thread
+    //
+    m_partitions.clear();
+    m_partitions.resize(partitionCount);
+    threadPool.ParallelFor(0, partitionCount, 1, [&](size_t firstPartition, size_t lastPartition)
+    {
+        for (size_t partition = firstPartition; partition < lastPartition; ++partition)
+        {
+            CStringHashSet& set = m_partitions[partition];
+            const size_t begin = partitionBegin[partition];
+            const size_t end   = partitionBegin[partition + 1];
+            set.Reserve(end - begin);
+            for (size_t i = begin; i < end; ++i)
+            {
+                set.Insert(entries[i].psz, entries[i].hash);
+            }
+        }
+    });
+}
+
+
+inline bool CPartitionedStringHashSet::Contains(PCWSTR psz) const noexcept
+{
+    return Contains(psz, HashString(psz));
+}
+
+
+inline bool CPartitionedStringHashSet::Contains(PCWSTR psz, ULONGLONG hash) const noexcept
+{
+    return m_partitions[PartitionOf(hash)].Contains(psz, hash);
+}
+
+
+inline size_t CPartitionedStringHashSet::GetSize() const noexcept
+{
+    size_t size = 0;
+    for (const auto& set : m_partitions)
+    {
+        size += set.GetSize();
+    }
+    return size;
+}
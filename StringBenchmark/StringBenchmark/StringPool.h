@@ -5,12 +5,50 @@
 /////////////////////////////////////////////////////////////////////////////////////////
 
 
+//
+// Define STRING_POOL_LATENCY_HISTOGRAM for an instrumented build: each AllocString call
+// on a pool with a latency histogram (see SetLatencyHistogram) is timed with __rdtsc
+// and counted in the histogram. Pools without a histogram only pay a null check.
+//
+// Uncomment the following line for the instrumented build:
+//#define STRING_POOL_LATENCY_HISTOGRAM     1
+//
+
+
+//
+// Define STRING_POOL_TIMELINE to record the slow-path events of the pools (new chunks,
+// soft-limit callbacks) with the timeline tracer of TimelineTrace.h. The benchmark
+// project defines it; without it, the pool doesn't depend on the tracer.
+//
+
+
+//
+// Define STRING_POOL_REGISTRY to let pools be named (see SetName) and listed, with their
+// statistics, in the string pool registry of StringPoolRegistry.h. The benchmark project
+// defines it; without it, the pool doesn't depend on the registry.
+//
+
+
 #include <crtdbg.h>     // _ASSERTE
-#include <wchar.h>      // wcslen, wmemcpy
+#include <wchar.h>      // wcslen, wmemcpy, wmemset
 #include <new>          // std::bad_alloc
+#include <stdexcept>    // std::logic_error, std::runtime_error
+#include <vector>       // std::vector
 
 #include <Windows.h>    // Windows Platform SDK
 
+#ifdef STRING_POOL_REGISTRY
+#include "StringPoolRegistry.h" // Named pools and their statistics
+#endif
+
+#ifdef STRING_POOL_TIMELINE
+#include "TimelineTrace.h"      // Timeline tracer
+#endif
+
+#ifdef STRING_POOL_LATENCY_HISTOGRAM
+#include "LatencyHistogram.h"   // CLatencyHistogram
+#endif
+
 
 //---------------------------------------------------------------------------------------
 // String Pool Allocator - Efficiently allocates strings from a custom memory pool
@@ -18,6 +56,38 @@
 class CStringPoolAllocator
 {
 public:
+    // Memory backing the pool chunks
+    enum class ChunkBacking
+    {
+        // Private memory allocated with VirtualAlloc (the default)
+        PrivateMemory,
+
+        // Pagefile-backed sections (CreateFileMapping), whose handles are inheritable.
+        // The chunk pages can be mapped by other processes (e.g. child worker processes),
+        // so a frozen pool can be shared instead of being copied.
+        SharedSection
+    };
+
+    // Memory statistics of the pool
+    struct Stats
+    {
+        SIZE_T  chunkCount;
+        SIZE_T  cbCommitted;    // Total size of the chunks
+        SIZE_T  cbUsed;         // Taken by strings (terminators included)
+    };
+
+    // Description of a chunk, e.g. to map it into another process
+    struct ChunkInfo
+    {
+        void*   pvBase;     // Base address of the chunk in this process
+        SIZE_T  cbSize;     // Total size, in bytes, of the chunk
+        SIZE_T  cbUsed;     // Bytes written from pvBase: the header and the strings
+        HANDLE  hSection;   // Section backing the chunk, or nullptr for private memory
+    };
+
+    // Called when a new chunk would take the pool past its soft limit; see SetBudget
+    typedef void (*SoftLimitCallback)(CStringPoolAllocator& pool, void* pContext);
+
     // Initialize the string pool allocator
     CStringPoolAllocator() noexcept;
 
@@ -26,6 +96,9 @@ public:
     // (The default value for this parameter is 512KB.)
     explicit CStringPoolAllocator(SIZE_T cbMinChunkSize) noexcept;
 
+    // Initialize the string pool allocator, specifying also the memory backing the chunks
+    CStringPoolAllocator(SIZE_T cbMinChunkSize, ChunkBacking backing) noexcept;
+
     // Release the string pool allocator's resources
     ~CStringPoolAllocator() noexcept;
 
@@ -38,6 +111,57 @@ public:
     // Throw std::bad_alloc on allocation failure.
     PWSTR AllocString(PCWSTR pszSource);
 
+    // Release all the strings at once, keeping the most recent chunk for reuse: the next
+    // allocations are served from it, without any system call, until it fills up again.
+    // The strings previously allocated from the pool become invalid.
+    // Throw std::logic_error if the pool is frozen.
+    void Reset();
+
+    // Seal the pool: the pages of all its chunks are made read-only, and any following
+    // AllocString call throws std::logic_error.
+    // The strings already allocated stay valid, and can be safely read from any thread
+    // (or from other processes, when the chunks are backed by shared sections).
+    // Throw std::runtime_error if the chunk pages can't be protected.
+    void Freeze();
+
+    // Has the pool been sealed by Freeze?
+    bool IsFrozen() const noexcept;
+
+    // Return the chunks currently owned by the pool, from the most recently allocated one
+    std::vector<ChunkInfo> GetChunks() const;
+
+    // Return the current statistics of the pool
+    Stats GetStats() const noexcept;
+
+#ifdef STRING_POOL_REGISTRY
+    // Name the pool, listing it (with its statistics) in the string pool registry; see
+    // StringPoolRegistry.h. The name is copied. Unnamed pools aren't listed.
+    void SetName(const char* name) noexcept;
+#endif
+
+    // Publish the current statistics to the registry, if named (the pool publishes them
+    // by itself on its slow path only, i.e. as of its last chunk allocation)
+    void PublishStats() noexcept;
+
+    // Give the pool a byte budget, counted in committed chunk bytes (0 for no limit).
+    // Before allocating a chunk that would take the pool past cbSoftLimit, AllocString
+    // calls pfnSoftLimit (if any), which may flush or compact the pool, e.g. with Reset;
+    // the allocation then proceeds. A chunk that would take the pool past cbHardLimit is
+    // not allocated: AllocString throws std::bad_alloc, without any system call.
+    // The first Reset after the soft limit has been reached (e.g. from the callback) gives
+    // the used pages of the chunk it keeps back to the system (decommitted) instead of
+    // clearing them; if they can't be committed again, the chunk kept shrinks to its
+    // first page.
+    // All the checks are on the slow path (new chunk): the fast path is untouched.
+    void SetBudget(SIZE_T cbSoftLimit, SIZE_T cbHardLimit,
+                   SoftLimitCallback pfnSoftLimit = nullptr, void* pContext = nullptr) noexcept;
+
+#ifdef STRING_POOL_LATENCY_HISTOGRAM
+    // Record the latency of the following AllocString calls into the given histogram
+    // (nullptr to stop recording). The histogram must outlive its use by the pool.
+    void SetLatencyHistogram(CLatencyHistogram* pHistogram) noexcept;
+#endif
+
 
     //
     // Ban Copy
@@ -71,6 +195,10 @@ private:
     //      +--------------+
     //      |    cbSize    |   <--- Total size, in bytes, of the current chunk
     //      +--------------+
+    //      |    cbUsed    |   <--- Bytes taken by the header and the strings (once retired)
+    //      +--------------+
+    //      |   hSection   |   <--- Section backing the chunk (nullptr for VirtualAlloc'd chunks)
+    //      +--------------+
     //      |              |
     //      |   Array of   |   <--- Array of WCHARs, used to serve string allocations
     //      |    WCHARs    |        (just increase a pointer in the current allocated block)
@@ -89,6 +217,13 @@ private:
 
             // Total size, in bytes, of the current chunk
             SIZE_T  cbSize;
+
+            // Bytes taken by the header and the strings, set when the chunk stops being
+            // the current one (the current chunk ends at m_pchNext)
+            SIZE_T  cbUsed;
+
+            // Section object backing the chunk; nullptr if the chunk was VirtualAlloc'd
+            HANDLE  hSection;
         };
 
         // This field is required for proper alignment for WCHARs that follow the previous
@@ -110,6 +245,23 @@ private:
     WCHAR*          m_pchLimit      = nullptr;  // One past last available byte in current chunk
     ChunkHeader*    m_phdrCurrent   = nullptr;  // Current chunk to serve memory allocations
     SIZE_T          m_cbGranularity = 0;        // Allocation granularity for our chunks
+    ChunkBacking    m_backing       = ChunkBacking::PrivateMemory;  // Memory backing the chunks
+    bool            m_bFrozen       = false;    // Sealed by Freeze?
+    SIZE_T          m_chunkCount    = 0;        // Chunks owned
+    SIZE_T          m_cbCommitted   = 0;        // Total size of the chunks owned
+    SIZE_T          m_cbWasted      = 0;        // Unused tails of the chunks before the current one
+#ifdef STRING_POOL_REGISTRY
+    CStringPoolRegistry::Entry* m_pRegistryEntry = nullptr;    // Registry entry, if named
+#endif
+    SIZE_T          m_cbSoftLimit   = 0;        // Budget (0 for no limit), see SetBudget
+    SIZE_T          m_cbHardLimit   = 0;
+    SoftLimitCallback m_pfnSoftLimit = nullptr; // Called past the soft limit, if any
+    void*           m_pvSoftLimitContext = nullptr;
+    bool            m_bInSoftLimitCallback = false; // Don't call it back recursively
+    bool            m_bSoftLimitReached = false;    // Since the last Reset, which then releases pages
+#ifdef STRING_POOL_LATENCY_HISTOGRAM
+    CLatencyHistogram* m_pLatencyHistogram = nullptr;   // AllocString latencies, if recorded
+#endif
 
     //
     // Helper Methods
@@ -117,6 +269,16 @@ private:
 
     void Destroy() noexcept;
 
+    // Call the soft-limit callback, unless it's already running
+    void NotifySoftLimit();
+
+    // AllocString, not timed
+    PWSTR AllocStringUntimed(const WCHAR* pchBegin, const WCHAR* pchEnd);
+
+    // Allocate a new chunk of the given size, according to the pool's chunk backing.
+    // Return nullptr on failure.
+    ChunkHeader* AllocChunk(SIZE_T cbAlloc) noexcept;
+
     static SIZE_T RoundUp(SIZE_T cb, SIZE_T units) noexcept;
     SIZE_T GetAllocationGranularity(SIZE_T cbMinChunkSize = kcbDefaultMinChunkSize) noexcept;
 };
@@ -138,9 +300,23 @@ inline CStringPoolAllocator::CStringPoolAllocator(SIZE_T cbMinChunkSize) noexcep
 }
 
 
+inline CStringPoolAllocator::CStringPoolAllocator(SIZE_T cbMinChunkSize, ChunkBacking backing) noexcept
+    : m_cbGranularity(GetAllocationGranularity(cbMinChunkSize))
+    , m_backing(backing)
+{
+}
+
+
 inline CStringPoolAllocator::~CStringPoolAllocator() noexcept
 {
     Destroy();
+
+#ifdef STRING_POOL_REGISTRY
+    if (m_pRegistryEntry != nullptr)
+    {
+        GetStringPoolRegistry().Unregister(m_pRegistryEntry);
+    }
+#endif
 }
 
 
@@ -189,7 +365,15 @@ inline void CStringPoolAllocator::Destroy() noexcept
         ChunkHeader* phdrPrev = hdr.phdrPrev;
 
         // Free the current chunk
-        VirtualFree(phdr, 0, MEM_RELEASE);
+        if (hdr.hSection != nullptr)
+        {
+            UnmapViewOfFile(phdr);
+            CloseHandle(hdr.hSection);
+        }
+        else
+        {
+            VirtualFree(phdr, 0, MEM_RELEASE);
+        }
 
         // Process the previous chunk
         phdr = phdrPrev;
@@ -199,10 +383,32 @@ inline void CStringPoolAllocator::Destroy() noexcept
     m_pchNext = nullptr;
     m_pchLimit = nullptr;
     m_phdrCurrent = nullptr;
+    m_bFrozen = false;
+
+    m_chunkCount = 0;
+    m_cbCommitted = 0;
+    m_cbWasted = 0;
+    PublishStats();
 }
 
 
 inline PWSTR CStringPoolAllocator::AllocString(const WCHAR* pchBegin, const WCHAR* pchEnd)
+{
+#ifdef STRING_POOL_LATENCY_HISTOGRAM
+    if (m_pLatencyHistogram != nullptr)
+    {
+        const unsigned long long start = ReadTsc();
+        PWSTR const psz = AllocStringUntimed(pchBegin, pchEnd);
+        m_pLatencyHistogram->Record(ReadTsc() - start);
+        return psz;
+    }
+#endif
+
+    return AllocStringUntimed(pchBegin, pchEnd);
+}
+
+
+inline PWSTR CStringPoolAllocator::AllocStringUntimed(const WCHAR* pchBegin, const WCHAR* pchEnd)
 {
     //
     // L"Hello world"
@@ -249,6 +455,13 @@ inline PWSTR CStringPoolAllocator::AllocString(const WCHAR* pchBegin, const WCHA
         return psz;
     }
 
+    // A frozen pool has no room left (Freeze sets m_pchLimit to m_pchNext),
+    // so we get here for every allocation attempted after freezing
+    if (m_bFrozen)
+    {
+        throw std::logic_error("CStringPoolAllocator::AllocString called on a frozen pool.");
+    }
+
     // Check that the requested string length doesn't exceed the max length limit
     if (cch > kchMaxCharAlloc)
     {
@@ -258,27 +471,63 @@ inline PWSTR CStringPoolAllocator::AllocString(const WCHAR* pchBegin, const WCHA
     // There is not enough room in the current chunk: allocate a new block
     const SIZE_T cbAlloc = RoundUp(cch * sizeof(WCHAR) + sizeof(ChunkHeader),
                                    m_cbGranularity);
-    BYTE* const pbNext = static_cast<BYTE*>(VirtualAlloc(nullptr,
-                                                         cbAlloc,
-                                                         MEM_COMMIT,
-                                                         PAGE_READWRITE));
-    if (pbNext == nullptr)
+
+    // Budget checks, before any system call
+    if (m_cbSoftLimit != 0 && m_cbCommitted + cbAlloc > m_cbSoftLimit)
+    {
+        m_bSoftLimitReached = true;
+
+        if (m_pfnSoftLimit != nullptr && !m_bInSoftLimitCallback)
+        {
+            NotifySoftLimit();
+
+            // The callback may have made room (e.g. with Reset), or frozen the pool
+            if (m_pchNext + cch <= m_pchLimit || m_bFrozen)
+            {
+                return AllocStringUntimed(pchBegin, pchEnd);
+            }
+        }
+    }
+    if (m_cbHardLimit != 0 && m_cbCommitted + cbAlloc > m_cbHardLimit)
+    {
+        static std::bad_alloc overBudget;
+        throw overBudget;
+    }
+
+#ifdef STRING_POOL_TIMELINE
+    CTimelineScope timelineScope("pool: new chunk", "bytes", cbAlloc);
+#endif
+    ChunkHeader* const phdrCurrent = AllocChunk(cbAlloc);
+    if (phdrCurrent == nullptr)
     {
         static std::bad_alloc outOfMemory;
         throw outOfMemory;
     }
+    BYTE* const pbNext = reinterpret_cast<BYTE*>(phdrCurrent);
+
+    // Retire the current chunk
+    if (m_phdrCurrent != nullptr)
+    {
+        m_phdrCurrent->cbUsed = reinterpret_cast<BYTE*>(m_pchNext) - reinterpret_cast<BYTE*>(m_phdrCurrent);
+    }
 
     // Hook the newly allocated chunk to the current linked list
-    ChunkHeader* phdrCurrent = reinterpret_cast<ChunkHeader*>(pbNext);
     phdrCurrent->phdrPrev = m_phdrCurrent;
     phdrCurrent->cbSize   = cbAlloc;
+    phdrCurrent->cbUsed   = 0;
+
+    // The rest of the current chunk is wasted
+    m_cbWasted    += (m_pchLimit - m_pchNext) * sizeof(WCHAR);
+    m_chunkCount  += 1;
+    m_cbCommitted += cbAlloc;
 
     m_phdrCurrent = phdrCurrent;
     m_pchNext     = reinterpret_cast<WCHAR*>(phdrCurrent + 1);
     m_pchLimit    = reinterpret_cast<WCHAR*>(pbNext + cbAlloc);
+    PublishStats();
 
     // Retry the string allocation using the newly allocated chunk
-    return AllocString(pchBegin, pchEnd);
+    return AllocStringUntimed(pchBegin, pchEnd);
 }
 
 
@@ -289,6 +538,254 @@ inline PWSTR CStringPoolAllocator::AllocString(PCWSTR pszSource)
 }
 
 
+inline void CStringPoolAllocator::Reset()
+{
+    if (m_bFrozen)
+    {
+        throw std::logic_error("CStringPoolAllocator::Reset called on a frozen pool.");
+    }
+
+    ChunkHeader* const phdrKeep = m_phdrCurrent;
+    if (phdrKeep == nullptr)
+    {
+        return;
+    }
+    WCHAR* const pchUsedEnd = m_pchNext;
+    const bool bRelease = m_bSoftLimitReached;
+    m_bSoftLimitReached = false;
+
+    // Free all the chunks before the current one
+    m_phdrCurrent = phdrKeep->phdrPrev;
+    Destroy();
+    phdrKeep->phdrPrev = nullptr;
+
+    // AllocString relies on zero-initialized chunk memory for the terminating NULs,
+    // so clear the part of the chunk that has been used
+    WCHAR* const pchFirst = reinterpret_cast<WCHAR*>(phdrKeep + 1);
+    WCHAR* pchClearEnd = pchUsedEnd;
+    SIZE_T cbStranded = 0;  // Committed, but out of the chunk (see below)
+
+    // Once the soft limit has been reached, rather give the used pages after the header's
+    // one back to the system, decommitting them: committed again right away, they are
+    // zero-filled on their next touch. (Pages of a section can't be decommitted: they are
+    // cleared.) If they can't be decommitted, they are cleared as usual.
+    if (bRelease && phdrKeep->hSection == nullptr)
+    {
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        const SIZE_T cbPage = si.dwPageSize;
+
+        BYTE* const pbReleaseFirst = reinterpret_cast<BYTE*>(RoundUp(reinterpret_cast<SIZE_T>(pchFirst), cbPage));
+        BYTE* const pbReleaseEnd = reinterpret_cast<BYTE*>(RoundUp(reinterpret_cast<SIZE_T>(pchUsedEnd), cbPage));
+        if (pbReleaseFirst < pbReleaseEnd
+            && VirtualFree(pbReleaseFirst, pbReleaseEnd - pbReleaseFirst, MEM_DECOMMIT))
+        {
+            pchClearEnd = reinterpret_cast<WCHAR*>(pbReleaseFirst);
+            if (VirtualAlloc(pbReleaseFirst, pbReleaseEnd - pbReleaseFirst, MEM_COMMIT, PAGE_READWRITE) == nullptr)
+            {
+                // Out of commit: the chunk shrinks to the pages before the hole, and the
+                // pages after it are decommitted too, so that the chunk size (used by
+                // Freeze, GetChunks and the statistics) only counts committed pages
+                BYTE* const pbChunkEnd = reinterpret_cast<BYTE*>(phdrKeep) + phdrKeep->cbSize;
+                if (pbReleaseEnd < pbChunkEnd
+                    && !VirtualFree(pbReleaseEnd, pbChunkEnd - pbReleaseEnd, MEM_DECOMMIT))
+                {
+                    cbStranded = pbChunkEnd - pbReleaseEnd;
+                }
+                phdrKeep->cbSize = pbReleaseFirst - reinterpret_cast<BYTE*>(phdrKeep);
+            }
+        }
+    }
+    wmemset(pchFirst, L'\0', pchClearEnd - pchFirst);
+
+    m_phdrCurrent = phdrKeep;
+    m_pchNext     = pchFirst;
+    m_pchLimit    = reinterpret_cast<WCHAR*>(reinterpret_cast<BYTE*>(phdrKeep) + phdrKeep->cbSize);
+
+    m_chunkCount  = 1;
+    m_cbCommitted = phdrKeep->cbSize + cbStranded;
+    m_cbWasted    = cbStranded;
+    PublishStats();
+}
+
+
+inline void CStringPoolAllocator::Freeze()
+{
+    if (m_bFrozen)
+    {
+        return;
+    }
+
+    for (ChunkHeader* phdr = m_phdrCurrent; phdr != nullptr; phdr = phdr->phdrPrev)
+    {
+        // Note that the chunk headers stay readable, so the list can still be walked
+        DWORD oldProtect = 0;
+        if (!VirtualProtect(phdr, phdr->cbSize, PAGE_READONLY, &oldProtect))
+        {
+            throw std::runtime_error("CStringPoolAllocator::Freeze: VirtualProtect failed.");
+        }
+    }
+
+    // Make the AllocString fast path always fail, so the frozen check lives
+    // on the slow path only
+    m_cbWasted += (m_pchLimit - m_pchNext) * sizeof(WCHAR);
+    m_pchLimit = m_pchNext;
+    m_bFrozen = true;
+    PublishStats();
+}
+
+
+inline bool CStringPoolAllocator::IsFrozen() const noexcept
+{
+    return m_bFrozen;
+}
+
+
+inline std::vector<CStringPoolAllocator::ChunkInfo> CStringPoolAllocator::GetChunks() const
+{
+    std::vector<ChunkInfo> chunks;
+    for (const ChunkHeader* phdr = m_phdrCurrent; phdr != nullptr; phdr = phdr->phdrPrev)
+    {
+        const SIZE_T cbUsed = (phdr == m_phdrCurrent)
+            ? reinterpret_cast<const BYTE*>(m_pchNext) - reinterpret_cast<const BYTE*>(phdr)
+            : phdr->cbUsed;
+        chunks.push_back(ChunkInfo{ const_cast<ChunkHeader*>(phdr), phdr->cbSize, cbUsed, phdr->hSection });
+    }
+    return chunks;
+}
+
+
+#ifdef STRING_POOL_REGISTRY
+inline void CStringPoolAllocator::SetName(const char* name) noexcept
+{
+    _ASSERTE(name != nullptr);
+
+    if (m_pRegistryEntry != nullptr)
+    {
+        GetStringPoolRegistry().Unregister(m_pRegistryEntry);
+    }
+    m_pRegistryEntry = GetStringPoolRegistry().Register(name);
+    PublishStats();
+}
+#endif
+
+
+inline CStringPoolAllocator::Stats CStringPoolAllocator::GetStats() const noexcept
+{
+    Stats stats;
+    stats.chunkCount  = m_chunkCount;
+    stats.cbCommitted = m_cbCommitted;
+    stats.cbUsed      = m_cbCommitted - m_cbWasted - m_chunkCount * sizeof(ChunkHeader)
+                        - (m_pchLimit - m_pchNext) * sizeof(WCHAR);
+    return stats;
+}
+
+
+inline void CStringPoolAllocator::PublishStats() noexcept
+{
+#ifdef STRING_POOL_REGISTRY
+    if (m_pRegistryEntry != nullptr)
+    {
+        const Stats stats = GetStats();
+        m_pRegistryEntry->chunkCount.store(stats.chunkCount, std::memory_order_relaxed);
+        m_pRegistryEntry->cbCommitted.store(stats.cbCommitted, std::memory_order_relaxed);
+        m_pRegistryEntry->cbUsed.store(stats.cbUsed, std::memory_order_relaxed);
+    }
+#endif
+}
+
+
+inline void CStringPoolAllocator::SetBudget(SIZE_T cbSoftLimit, SIZE_T cbHardLimit,
+                                            SoftLimitCallback pfnSoftLimit, void* pContext) noexcept
+{
+    _ASSERTE(cbHardLimit == 0 || cbSoftLimit <= cbHardLimit);
+
+    m_cbSoftLimit        = cbSoftLimit;
+    m_cbHardLimit        = cbHardLimit;
+    m_pfnSoftLimit       = pfnSoftLimit;
+    m_pvSoftLimitContext = pContext;
+}
+
+
+inline void CStringPoolAllocator::NotifySoftLimit()
+{
+#ifdef STRING_POOL_TIMELINE
+    CTimelineScope timelineScope("pool: soft limit", "bytes", m_cbCommitted);
+#endif
+
+    m_bInSoftLimitCallback = true;
+    try
+    {
+        m_pfnSoftLimit(*this, m_pvSoftLimitContext);
+    }
+    catch (...)
+    {
+        m_bInSoftLimitCallback = false;
+        throw;
+    }
+    m_bInSoftLimitCallback = false;
+}
+
+
+#ifdef STRING_POOL_LATENCY_HISTOGRAM
+inline void CStringPoolAllocator::SetLatencyHistogram(CLatencyHistogram* pHistogram) noexcept
+{
+    m_pLatencyHistogram = pHistogram;
+}
+#endif
+
+
+inline CStringPoolAllocator::ChunkHeader* CStringPoolAllocator::AllocChunk(SIZE_T cbAlloc) noexcept
+{
+    if (m_backing == ChunkBacking::PrivateMemory)
+    {
+        ChunkHeader* const phdr = static_cast<ChunkHeader*>(VirtualAlloc(nullptr,
+                                                                        cbAlloc,
+                                                                        MEM_COMMIT,
+                                                                        PAGE_READWRITE));
+        if (phdr != nullptr)
+        {
+            phdr->hSection = nullptr;
+        }
+        return phdr;
+    }
+
+    //
+    // Pagefile-backed section: like VirtualAlloc'd memory, its pages are zero-initialized.
+    // The section handle is inheritable, so child processes can map the very same pages.
+    //
+    SECURITY_ATTRIBUTES sa = {};
+    sa.nLength        = sizeof(sa);
+    sa.bInheritHandle = TRUE;
+
+    const ULONGLONG cbSection = cbAlloc;
+    const HANDLE hSection = CreateFileMappingW(INVALID_HANDLE_VALUE,
+                                               &sa,
+                                               PAGE_READWRITE,
+                                               static_cast<DWORD>(cbSection >> 32),
+                                               static_cast<DWORD>(cbSection & 0xFFFFFFFF),
+                                               nullptr);
+    if (hSection == nullptr)
+    {
+        return nullptr;
+    }
+
+    ChunkHeader* const phdr = static_cast<ChunkHeader*>(MapViewOfFile(hSection,
+                                                                    FILE_MAP_WRITE,
+                                                                    0,
+                                                                    0,
+                                                                    cbAlloc));
+    if (phdr == nullptr)
+    {
+        CloseHandle(hSection);
+        return nullptr;
+    }
+
+    phdr->hSection = hSection;
+    return phdr;
+}
+
+
 inline SIZE_T CStringPoolAllocator::RoundUp(SIZE_T cb, SIZE_T units) noexcept
 {
     return ((cb + units - 1) / units) * units;
@@ -0,0 +1,230 @@
+#pragma once
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// String Pool Registry: the named string pools of the process and their statistics,
+// dumped on demand or on Ctrl+Break
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <atomic>       // std::atomic
+#include <iostream>     // std::ostream, std::cout
+#include <new>          // std::nothrow
+
+#include <Windows.h>    // Windows Platform SDK
+
+
+//---------------------------------------------------------------------------------------
+// String Pool Registry
+//
+// A lock-free singly-linked list of entries, one per named pool (see
+// CStringPoolAllocator::SetName). Each pool publishes its statistics in its entry, with
+// relaxed atomic stores, when it allocates a chunk, on Reset, Freeze and PublishStats:
+// the fast path is untouched. So, a dump shows the bytes used as of the pool's last chunk
+// allocation (or PublishStats call), and can run on any thread, even while the pools are
+// being used or destroyed.
+//
+// An entry is claimed with bInUse, then named, then published by making its version
+// even; Unregister makes it odd again. Dump skips the entries whose version is odd, or
+// changes while it copies them, so it never prints a name being written.
+//
+// Entries are never freed: the entry of a destroyed pool is reused by the next pool
+// named. Their number is the highest number of named pools alive at the same time.
+//---------------------------------------------------------------------------------------
+class CStringPoolRegistry
+{
+public:
+    enum
+    {
+        kcchMaxName = 32
+    };
+
+    struct Entry
+    {
+        Entry*                  pNext;          // Set once, before the entry is linked
+        std::atomic<bool>       bInUse;         // Claimed by a pool
+        std::atomic<ULONG>      version;        // Even while named and published
+        char                    name[kcchMaxName];
+        std::atomic<ULONGLONG>  chunkCount;
+        std::atomic<ULONGLONG>  cbCommitted;    // Total size of the chunks
+        std::atomic<ULONGLONG>  cbUsed;         // Taken by strings (terminators included)
+    };
+
+    CStringPoolRegistry() noexcept;
+
+    // Acquire an entry for a pool with the given name (copied, and truncated to
+    // kcchMaxName - 1 chars); return nullptr if out of memory
+    Entry* Register(const char* name) noexcept;
+
+    // Release the entry of a destroyed pool
+    void Unregister(Entry* pEntry) noexcept;
+
+    // Print a line per named pool: chunk count, committed MB and utilization (used bytes
+    // over committed bytes)
+    void Dump(std::ostream& os) const;
+
+    // Dump the registry to std::cout on Ctrl+Break (the process keeps running).
+    // Return false if the console control handler can't be installed.
+    static bool EnableDumpOnCtrlBreak() noexcept;
+
+
+    //
+    // Ban Copy
+    //
+private:
+    CStringPoolRegistry(const CStringPoolRegistry&) = delete;
+    CStringPoolRegistry& operator=(const CStringPoolRegistry&) = delete;
+
+
+    //
+    // IMPLEMENTATION
+    //
+private:
+    std::atomic<Entry*> m_pFirst;
+
+    static BOOL WINAPI CtrlHandler(DWORD ctrlType) noexcept;
+};
+
+
+//---------------------------------------------------------------------------------------
+// The registry of the process
+//---------------------------------------------------------------------------------------
+inline CStringPoolRegistry& GetStringPoolRegistry() noexcept
+{
+    static CStringPoolRegistry s_registry;
+    return s_registry;
+}
+
+
+//=======================================================================================
+//                          Inline Method Implementations
+//=======================================================================================
+
+inline CStringPoolRegistry::CStringPoolRegistry() noexcept
+    : m_pFirst(nullptr)
+{
+}
+
+
+inline CStringPoolRegistry::Entry* CStringPoolRegistry::Register(const char* name) noexcept
+{
+    // Reuse a free entry, if any
+    Entry* pEntry = nullptr;
+    for (Entry* p = m_pFirst.load(); p != nullptr && pEntry == nullptr; p = p->pNext)
+    {
+        bool bInUse = false;
+        if (p->bInUse.compare_exchange_strong(bInUse, true))
+        {
+            pEntry = p;
+        }
+    }
+
+    // Or link a new one
+    if (pEntry == nullptr)
+    {
+        pEntry = new (std::nothrow) Entry;
+        if (pEntry == nullptr)
+        {
+            return nullptr;
+        }
+        pEntry->bInUse.store(true);
+        pEntry->version.store(1, std::memory_order_relaxed);
+
+        pEntry->pNext = m_pFirst.load();
+        while (!m_pFirst.compare_exchange_weak(pEntry->pNext, pEntry))
+        {
+        }
+    }
+
+    // The version is odd: keep the writes below after it, for Dump
+    std::atomic_thread_fence(std::memory_order_release);
+
+    size_t i = 0;
+    for (; i < kcchMaxName - 1 && name[i] != '\0'; ++i)
+    {
+        pEntry->name[i] = name[i];
+    }
+    pEntry->name[i] = '\0';
+
+    pEntry->chunkCount.store(0, std::memory_order_relaxed);
+    pEntry->cbCommitted.store(0, std::memory_order_relaxed);
+    pEntry->cbUsed.store(0, std::memory_order_relaxed);
+
+    // Publish the entry, now that it's named
+    pEntry->version.fetch_add(1, std::memory_order_release);
+    return pEntry;
+}
+
+
+inline void CStringPoolRegistry::Unregister(Entry* pEntry) noexcept
+{
+    pEntry->version.fetch_add(1, std::memory_order_relaxed);
+    pEntry->bInUse.store(false);
+}
+
+
+inline void CStringPoolRegistry::Dump(std::ostream& os) const
+{
+    os << "String pools (used bytes as of each pool's last chunk allocation, Reset or PublishStats):\n";
+    size_t poolCount = 0;
+    for (const Entry* p = m_pFirst.load(); p != nullptr; p = p->pNext)
+    {
+        const ULONG version = p->version.load(std::memory_order_acquire);
+        if (version % 2 != 0)
+        {
+            continue;
+        }
+
+        char name[kcchMaxName];
+        for (size_t i = 0; i < kcchMaxName; ++i)
+        {
+            name[i] = p->name[i];
+        }
+        name[kcchMaxName - 1] = '\0';
+        const ULONGLONG chunkCount = p->chunkCount.load(std::memory_order_relaxed);
+        const ULONGLONG cbCommitted = p->cbCommitted.load(std::memory_order_relaxed);
+        const ULONGLONG cbUsed = p->cbUsed.load(std::memory_order_relaxed);
+
+        // Unregistered (and maybe renamed) while being copied?
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (p->version.load(std::memory_order_relaxed) != version)
+        {
+            continue;
+        }
+
+        os << "  " << name << ": " << chunkCount << " chunks, "
+           << cbCommitted / (1024.0 * 1024.0) << " MB committed, "
+           << (cbCommitted != 0 ? 100.0 * cbUsed / cbCommitted : 0.0) << "% used\n";
+        ++poolCount;
+    }
+
+    if (poolCount == 0)
+    {
+        os << "  (no named pools)\n";
+    }
+}
+
+
+inline bool CStringPoolRegistry::EnableDumpOnCtrlBreak() noexcept
+{
+    return SetConsoleCtrlHandler(&CStringPoolRegistry::CtrlHandler, TRUE) != FALSE;
+}
+
+
+inline BOOL WINAPI CStringPoolRegistry::CtrlHandler(DWORD ctrlType) noexcept
+{
+    if (ctrlType != CTRL_BREAK_EVENT)
+    {
+        // Let the default handler terminate the process
+        return FALSE;
+    }
+
+    try
+    {
+        GetStringPoolRegistry().Dump(std::cout);
+        std::cout.flush();
+    }
+    catch (...)
+    {
+    }
+    return TRUE;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Per-thread CPU counters for measured regions: cycles, and optionally a hardware
+// performance counter (e.g. last-level cache misses)
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <Windows.h>    // Windows Platform SDK
+
+
+//---------------------------------------------------------------------------------------
+// Thread Counters
+//
+// Cycles are read with QueryThreadCycleTime. The hardware counter is read with the
+// thread profiling API (EnableThreadProfiling/ReadThreadProfilingData): the event it
+// counts is configured system-wide, by assigning a PMC source (e.g. LLCMisses, listed by
+// "wpr -pmcsources") to the counter, so it's only available on systems set up for it.
+//---------------------------------------------------------------------------------------
+class CThreadCounters
+{
+public:
+    struct Sample
+    {
+        ULONG64     cycles;
+        ULONG64     hardwareCount;  // 0 if the hardware counter is not available
+    };
+
+    // Profile the calling thread; pass the index of the hardware counter to read,
+    // or -1 for cycles only
+    explicit CThreadCounters(int hardwareCounter = -1) noexcept;
+
+    ~CThreadCounters() noexcept;
+
+    // Whether the hardware counter could be enabled
+    bool HasHardwareCounter() const noexcept;
+
+    // Read the counters of the calling thread (the one that created this object):
+    // take a sample before and after the measured region, and subtract
+    Sample Read() const noexcept;
+
+
+    //
+    // Ban Copy
+    //
+private:
+    CThreadCounters(const CThreadCounters&) = delete;
+    CThreadCounters& operator=(const CThreadCounters&) = delete;
+
+
+    //
+    // IMPLEMENTATION
+    //
+private:
+    HANDLE  m_hPerformanceData;     // Thread profiling handle, or nullptr
+    int     m_hardwareCounter;
+};
+
+
+//=======================================================================================
+//                          Inline Method Implementations
+//=======================================================================================
+
+inline CThreadCounters::CThreadCounters(int hardwareCounter) noexcept
+    : m_hPerformanceData(nullptr)
+    , m_hardwareCounter(hardwareCounter)
+{
+    if (m_hardwareCounter >= 0 && m_hardwareCounter < MAX_HW_COUNTERS)
+    {
+        if (EnableThreadProfiling(GetCurrentThread(), THREAD_PROFILING_FLAG_DISPATCH,
+                                  static_cast<DWORD64>(1) << m_hardwareCounter,
+                                  &m_hPerformanceData) != ERROR_SUCCESS)
+        {
+            m_hPerformanceData = nullptr;
+        }
+    }
+}
+
+
+inline CThreadCounters::~CThreadCounters() noexcept
+{
+    if (m_hPerformanceData != nullptr)
+    {
+        DisableThreadProfiling(m_hPerformanceData);
+    }
+}
+
+
+inline bool CThreadCounters::HasHardwareCounter() const noexcept
+{
+    return m_hPerformanceData != nullptr;
+}
+
+
+inline CThreadCounters::Sample CThreadCounters::Read() const noexcept
+{
+    Sample sample = {};
+    QueryThreadCycleTime(GetCurrentThread(), &sample.cycles);
+
+    if (m_hPerformanceData != nullptr)
+    {
+        PERFORMANCE_DATA data = {};
+        data.Size = sizeof(data);
+        data.Version = PERFORMANCE_DATA_VERSION;
+        if (ReadThreadProfilingData(m_hPerformanceData, READ_THREAD_PROFILING_FLAG_HARDWARE_COUNTERS,
+                                    &data) == ERROR_SUCCESS)
+        {
+            for (BYTE i = 0; i < data.HwCountersCount; ++i)
+            {
+                if (data.HwCounters[i].Type == PMCCounter)
+                {
+                    sample.hardwareCount = data.HwCounters[i].Value;
+                    break;
+                }
+            }
+        }
+    }
+
+    return sample;
+}
@@ -0,0 +1,664 @@
+#pragma once
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Work-Stealing Thread Pool
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <crtdbg.h>     // _ASSERTE
+#include <algorithm>    // std::sort, std::inplace_merge, std::max
+#include <atomic>       // std::atomic
+#include <condition_variable>   // std::condition_variable
+#include <functional>   // std::function
+#include <iterator>     // std::distance
+#include <memory>       // std::unique_ptr
+#include <mutex>        // std::mutex
+#include <thread>       // std::thread
+#include <utility>      // std::move
+#include <vector>       // std::vector
+
+#include <stdio.h>      // snprintf
+
+#include <Windows.h>    // YieldProcessor
+
+#include "TimelineTrace.h"  // Timeline tracer
+
+
+//---------------------------------------------------------------------------------------
+// Chase-Lev Work-Stealing Deque
+//
+// The owner thread pushes and pops items at the bottom (LIFO); other threads steal
+// items from the top (FIFO).
+//
+// Based on: N.M. Le, A. Pop, A. Cohen, F. Zappa Nardelli,
+// "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013)
+//---------------------------------------------------------------------------------------
+template <typename T>
+class CWorkStealingDeque
+{
+public:
+    // Initialize an empty deque; the capacity grows as needed
+    explicit CWorkStealingDeque(size_t initialCapacity = 256);
+
+    // Owner thread only: push an item at the bottom
+    void Push(T* pItem);
+
+    // Owner thread only: pop the most recently pushed item, or return nullptr if empty
+    T* Pop() noexcept;
+
+    // Any thread: steal the oldest item, or return nullptr if empty (or if another
+    // thread won the race for the same item)
+    T* Steal() noexcept;
+
+
+    //
+    // Ban Copy
+    //
+private:
+    CWorkStealingDeque(const CWorkStealingDeque&) = delete;
+    CWorkStealingDeque& operator=(const CWorkStealingDeque&) = delete;
+
+
+    //
+    // IMPLEMENTATION
+    //
+private:
+
+    // Circular array of items, with a power-of-two capacity
+    struct Ring
+    {
+        explicit Ring(size_t capacity)
+            : mask(capacity - 1)
+            , slots(new std::atomic<T*>[capacity])
+        {
+        }
+
+        T* Get(long long i) const noexcept
+        {
+            return slots[static_cast<size_t>(i) & mask].load(std::memory_order_relaxed);
+        }
+
+        void Put(long long i, T* pItem) noexcept
+        {
+            slots[static_cast<size_t>(i) & mask].store(pItem, std::memory_order_relaxed);
+        }
+
+        size_t                              mask;
+        std::unique_ptr<std::atomic<T*>[]>  slots;
+    };
+
+    // Keep the thieves' index (top) and the owner's index (bottom) on separate cache lines
+    std::atomic<long long>  m_top;
+    char                    m_padding1[64 - sizeof(std::atomic<long long>)];
+    std::atomic<long long>  m_bottom;
+    char                    m_padding2[64 - sizeof(std::atomic<long long>)];
+    std::atomic<Ring*>      m_pRing;
+
+    // All the rings ever allocated: thieves may still be reading a ring that has been
+    // replaced by a bigger one, so old rings are only freed with the deque
+    std::vector<std::unique_ptr<Ring>> m_rings;
+};
+
+
+//---------------------------------------------------------------------------------------
+// Work-Stealing Thread Pool
+//
+// Each thread has its own Chase-Lev deque. Fork-join tasks are pushed to the deque of the
+// thread that spawns them, and idle threads steal from the others; workers that find
+// nothing to do spin briefly, then park until new tasks are pushed.
+//
+// The pool is *driven* by one external thread at a time (e.g. the benchmark's main thread),
+// which takes part in the computation as thread #0. Tasks must not throw.
+//---------------------------------------------------------------------------------------
+class CWorkStealingThreadPool
+{
+public:
+    // Called by each worker thread, with its index (1..), before it runs any task:
+    // e.g. to set its affinity
+    using WorkerStartCallback = std::function<void(unsigned index)>;
+
+    // Start the pool; threadCount includes the driving thread.
+    // Pass 0 to use one thread per logical processor.
+    explicit CWorkStealingThreadPool(unsigned threadCount = 0,
+                                     WorkerStartCallback onWorkerStart = WorkerStartCallback());
+
+    // Stop and join the worker threads
+    ~CWorkStealingThreadPool() noexcept;
+
+    // Number of threads running the tasks, including the driving thread
+    unsigned GetThreadCount() const noexcept;
+
+    // Index of the current thread, in [0, GetThreadCount()), while running pool tasks:
+    // 0 for the driving thread, 1.. for the worker threads.
+    // Handy to select per-thread state (e.g. a string pool per thread).
+    static unsigned GetCurrentThreadIndex() noexcept;
+
+    // Run body(first, last) over sub-ranges of [begin, end) of at most grainSize items,
+    // in parallel, and return when all of them completed
+    template <typename Body>
+    void ParallelFor(size_t begin, size_t end, size_t grainSize, const Body& body);
+
+    // Fork-join: run f1() and f2(), possibly in parallel, and return when both completed
+    template <typename F1, typename F2>
+    void Invoke(const F1& f1, const F2& f2);
+
+
+    //
+    // Ban Copy
+    //
+private:
+    CWorkStealingThreadPool(const CWorkStealingThreadPool&) = delete;
+    CWorkStealingThreadPool& operator=(const CWorkStealingThreadPool&) = delete;
+
+
+    //
+    // IMPLEMENTATION
+    //
+private:
+
+    // A unit of work sitting in a deque; tasks live on the stack of the thread that spawns
+    // them, which doesn't return before they complete
+    struct Task
+    {
+        void              (*pfnRun)(Task*);
+        std::atomic<bool>   bDone;
+    };
+
+    template <typename F>
+    struct FunctionTask : Task
+    {
+        explicit FunctionTask(const F& f) noexcept
+            : func(f)
+        {
+            this->pfnRun = &FunctionTask::Run;
+            this->bDone.store(false, std::memory_order_relaxed);
+        }
+
+        static void Run(Task* pTask)
+        {
+            static_cast<FunctionTask*>(pTask)->func();
+        }
+
+        const F& func;
+    };
+
+    // Per-thread state: the pool the thread is running tasks for, and its index there
+    struct ThreadState
+    {
+        CWorkStealingThreadPool*    pPool;
+        unsigned                    index;
+        unsigned                    rngState;   // For picking victims to steal from
+    };
+
+    // Make the calling thread the driving thread #0 for the duration of a scope
+    class CDriverScope
+    {
+    public:
+        explicit CDriverScope(CWorkStealingThreadPool& pool) noexcept;
+        ~CDriverScope() noexcept;
+
+    private:
+        ThreadState m_saved;
+    };
+
+    enum
+    {
+        // Failed attempts to find work before an idle worker parks
+        kIdleSpinCount = 2000
+    };
+
+    std::vector<std::unique_ptr<CWorkStealingDeque<Task>>>  m_deques;   // One per thread
+    std::vector<std::thread>    m_workers;          // Threads #1..
+    WorkerStartCallback         m_onWorkerStart;    // May be empty
+
+    std::mutex                  m_parkMutex;        // Protects parking
+    std::condition_variable     m_parkCondition;    // Parked workers wait here
+    std::atomic<unsigned>       m_workEpoch;        // Bumped at every push
+    std::atomic<unsigned>       m_sleeperCount;     // Number of parked workers
+    std::atomic<bool>           m_bStop;            // Set by the destructor
+
+    //
+    // Helper Methods
+    //
+
+    static ThreadState& CurrentThreadState() noexcept;
+
+    template <typename Body>
+    void ParallelForImpl(size_t begin, size_t end, size_t grainSize, const Body& body);
+
+    template <typename F1, typename F2>
+    void InvokeImpl(const F1& f1, const F2& f2);
+
+    void WorkerMain(unsigned index) noexcept;
+
+    // Pop from the thread's own deque, or steal from the others
+    Task* FindWork(ThreadState& state) noexcept;
+
+    static void Execute(Task* pTask) noexcept;
+
+    // Run other tasks until the given one (stolen by another thread) completes
+    void WaitFor(const Task& task, ThreadState& state) noexcept;
+
+    // Wake a parked worker, if any, after a push
+    void NotifyWork() noexcept;
+};
+
+
+// Sort [first, last) on the pool: the two halves are sorted in parallel (recursively,
+// down to cutoff items, sorted by std::sort), then merged
+template <typename RandomIt, typename Compare>
+void ParallelSort(CWorkStealingThreadPool& pool, RandomIt first, RandomIt last, Compare comp,
+                  size_t cutoff = 16 * 1024)
+{
+    const size_t count = static_cast<size_t>(std::distance(first, last));
+    if (count <= cutoff || pool.GetThreadCount() == 1)
+    {
+        std::sort(first, last, comp);
+        return;
+    }
+
+    const RandomIt middle = first + count / 2;
+    pool.Invoke([&] { ParallelSort(pool, first, middle, comp, cutoff); },
+                [&] { ParallelSort(pool, middle, last, comp, cutoff); });
+    std::inplace_merge(first, middle, last, comp);
+}
+
+
+//=======================================================================================
+//                          Inline Method Implementations
+//=======================================================================================
+
+template <typename T>
+inline CWorkStealingDeque<T>::CWorkStealingDeque(size_t initialCapacity)
+    : m_top(0)
+    , m_bottom(0)
+    , m_pRing(nullptr)
+{
+    // The capacity must be a power of two
+    _ASSERTE(initialCapacity != 0 && (initialCapacity & (initialCapacity - 1)) == 0);
+
+    m_rings.emplace_back(new Ring(initialCapacity));
+    m_pRing.store(m_rings.back().get(), std::memory_order_relaxed);
+}
+
+
+template <typename T>
+inline void CWorkStealingDeque<T>::Push(T* pItem)
+{
+    const long long b = m_bottom.load(std::memory_order_relaxed);
+    const long long t = m_top.load(std::memory_order_acquire);
+    Ring* pRing = m_pRing.load(std::memory_order_relaxed);
+
+    if (b - t > static_cast<long long>(pRing->mask))
+    {
+        // Full: copy the live items into a ring twice as big
+        std::unique_ptr<Ring> pBigger(new Ring((pRing->mask + 1) * 2));
+        for (long long i = t; i < b; ++i)
+        {
+            pBigger->Put(i, pRing->Get(i));
+        }
+
+        pRing = pBigger.get();
+        m_rings.push_back(std::move(pBigger));
+        m_pRing.store(pRing, std::memory_order_release);
+    }
+
+    // Publish the item to the thieves (pairs with the acquire load in Steal)
+    pRing->Put(b, pItem);
+    m_bottom.store(b + 1, std::memory_order_release);
+}
+
+
+template <typename T>
+inline T* CWorkStealingDeque<T>::Pop() noexcept
+{
+    const long long b = m_bottom.load(std::memory_order_relaxed) - 1;
+    Ring* const pRing = m_pRing.load(std::memory_order_relaxed);
+    m_bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long t = m_top.load(std::memory_order_relaxed);
+
+    if (t > b)
+    {
+        // Empty
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    T* pItem = pRing->Get(b);
+    if (t == b)
+    {
+        // Last item: race against the thieves for it
+        if (!m_top.compare_exchange_strong(t, t + 1,
+                                           std::memory_order_seq_cst,
+                                           std::memory_order_relaxed))
+        {
+            pItem = nullptr;
+        }
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return pItem;
+}
+
+
+template <typename T>
+inline T* CWorkStealingDeque<T>::Steal() noexcept
+{
+    long long t = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const long long b = m_bottom.load(std::memory_order_acquire);
+
+    if (t >= b)
+    {
+        return nullptr;
+    }
+
+    Ring* const pRing = m_pRing.load(std::memory_order_acquire);
+    T* const pItem = pRing->Get(t);
+    if (!m_top.compare_exchange_strong(t, t + 1,
+                                       std::memory_order_seq_cst,
+                                       std::memory_order_relaxed))
+    {
+        return nullptr;
+    }
+    return pItem;
+}
+
+
+inline CWorkStealingThreadPool::CWorkStealingThreadPool(unsigned threadCount,
+                                                        WorkerStartCallback onWorkerStart)
+    : m_onWorkerStart(std::move(onWorkerStart))
+    , m_workEpoch(0)
+    , m_sleeperCount(0)
+    , m_bStop(false)
+{
+    if (threadCount == 0)
+    {
+        threadCount = (std::max)(std::thread::hardware_concurrency(), 1u);
+    }
+
+    for (unsigned i = 0; i < threadCount; ++i)
+    {
+        m_deques.emplace_back(new CWorkStealingDeque<Task>());
+    }
+
+    // Thread #0 is the driving thread
+    for (unsigned i = 1; i < threadCount; ++i)
+    {
+        m_workers.emplace_back(&CWorkStealingThreadPool::WorkerMain, this, i);
+    }
+}
+
+
+inline CWorkStealingThreadPool::~CWorkStealingThreadPool() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(m_parkMutex);
+        m_bStop.store(true);
+    }
+    m_parkCondition.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+
+inline unsigned CWorkStealingThreadPool::GetThreadCount() const noexcept
+{
+    return static_cast<unsigned>(m_deques.size());
+}
+
+
+inline CWorkStealingThreadPool::ThreadState& CWorkStealingThreadPool::CurrentThreadState() noexcept
+{
+    thread_local ThreadState state = { nullptr, 0, 0 };
+    return state;
+}
+
+
+inline unsigned CWorkStealingThreadPool::GetCurrentThreadIndex() noexcept
+{
+    return CurrentThreadState().index;
+}
+
+
+inline CWorkStealingThreadPool::CDriverScope::CDriverScope(CWorkStealingThreadPool& pool) noexcept
+    : m_saved(CurrentThreadState())
+{
+    ThreadState& state = CurrentThreadState();
+    state.pPool    = &pool;
+    state.index    = 0;
+    state.rngState = 0x9E3779B9;
+}
+
+
+inline CWorkStealingThreadPool::CDriverScope::~CDriverScope() noexcept
+{
+    CurrentThreadState() = m_saved;
+}
+
+
+template <typename Body>
+inline void CWorkStealingThreadPool::ParallelFor(size_t begin, size_t end, size_t grainSize,
+                                                 const Body& body)
+{
+    if (grainSize == 0)
+    {
+        grainSize = 1;
+    }
+
+    if (CurrentThreadState().pPool != this)
+    {
+        CDriverScope driver(*this);
+        ParallelForImpl(begin, end, grainSize, body);
+    }
+    else
+    {
+        ParallelForImpl(begin, end, grainSize, body);
+    }
+}
+
+
+template <typename Body>
+inline void CWorkStealingThreadPool::ParallelForImpl(size_t begin, size_t end, size_t grainSize,
+                                                     const Body& body)
+{
+    // Recursive binary splitting: idle threads steal the biggest pending halves
+    if (end - begin <= grainSize)
+    {
+        if (begin < end)
+        {
+            body(begin, end);
+        }
+        return;
+    }
+
+    const size_t middle = begin + (end - begin) / 2;
+    InvokeImpl([&] { ParallelForImpl(begin, middle, grainSize, body); },
+               [&] { ParallelForImpl(middle, end, grainSize, body); });
+}
+
+
+template <typename F1, typename F2>
+inline void CWorkStealingThreadPool::Invoke(const F1& f1, const F2& f2)
+{
+    if (CurrentThreadState().pPool != this)
+    {
+        CDriverScope driver(*this);
+        InvokeImpl(f1, f2);
+    }
+    else
+    {
+        InvokeImpl(f1, f2);
+    }
+}
+
+
+template <typename F1, typename F2>
+inline void CWorkStealingThreadPool::InvokeImpl(const F1& f1, const F2& f2)
+{
+    if (m_workers.empty())
+    {
+        f1();
+        f2();
+        return;
+    }
+
+    ThreadState& state = CurrentThreadState();
+    CWorkStealingDeque<Task>& deque = *m_deques[state.index];
+
+    // Offer f2 to the thieves, and run f1 ourselves
+    FunctionTask<F2> task(f2);
+    deque.Push(&task);
+    NotifyWork();
+
+    f1();
+
+    // If f2 has not been stolen, it's still at the bottom of our deque.
+    // Otherwise, since thieves steal from the top, every older item has been stolen as well,
+    // and the deque is empty.
+    Task* const pTask = deque.Pop();
+    if (pTask != nullptr)
+    {
+        _ASSERTE(pTask == &task);
+        f2();
+        return;
+    }
+
+    WaitFor(task, state);
+}
+
+
+inline void CWorkStealingThreadPool::Execute(Task* pTask) noexcept
+{
+    {
+        CTimelineScope timelineScope("task");
+        pTask->pfnRun(pTask);
+    }
+    pTask->bDone.store(true, std::memory_order_release);
+}
+
+
+inline CWorkStealingThreadPool::Task* CWorkStealingThreadPool::FindWork(ThreadState& state) noexcept
+{
+    Task* pTask = m_deques[state.index]->Pop();
+    if (pTask != nullptr)
+    {
+        return pTask;
+    }
+
+    // Xorshift, to start stealing from a random victim
+    state.rngState ^= state.rngState << 13;
+    state.rngState ^= state.rngState >> 17;
+    state.rngState ^= state.rngState << 5;
+
+    const unsigned threadCount = GetThreadCount();
+    const unsigned first = state.rngState % threadCount;
+    for (unsigned i = 0; i < threadCount; ++i)
+    {
+        const unsigned victim = (first + i) % threadCount;
+        if (victim == state.index)
+        {
+            continue;
+        }
+
+        pTask = m_deques[victim]->Steal();
+        if (pTask != nullptr)
+        {
+            return pTask;
+        }
+    }
+
+    return nullptr;
+}
+
+
+inline void CWorkStealingThreadPool::WaitFor(const Task& task, ThreadState& state) noexcept
+{
+    while (!task.bDone.load(std::memory_order_acquire))
+    {
+        Task* const pTask = FindWork(state);
+        if (pTask != nullptr)
+        {
+            Execute(pTask);
+        }
+        else
+        {
+            YieldProcessor();
+        }
+    }
+}
+
+
+inline void CWorkStealingThreadPool::NotifyWork() noexcept
+{
+    // Pairs with the sleeper registration in WorkerMain (see there)
+    m_workEpoch.fetch_add(1);
+    if (m_sleeperCount.load() != 0)
+    {
+        std::lock_guard<std::mutex> lock(m_parkMutex);
+        m_parkCondition.notify_one();
+    }
+}
+
+
+inline void CWorkStealingThreadPool::WorkerMain(unsigned index) noexcept
+{
+    if (m_onWorkerStart)
+    {
+        m_onWorkerStart(index);
+    }
+
+    if (GetTimelineTracer().IsEnabled())
+    {
+        char threadName[32];
+        snprintf(threadName, sizeof(threadName), "pool worker #%u", index);
+        GetTimelineTracer().SetThreadName(threadName);
+    }
+
+    ThreadState& state = CurrentThreadState();
+    state.pPool    = this;
+    state.index    = index;
+    state.rngState = 0x9E3779B9 + index * 0x85EBCA6B;
+
+    unsigned idleCount = 0;
+    unsigned epoch = m_workEpoch.load();
+    while (!m_bStop.load(std::memory_order_relaxed))
+    {
+        Task* const pTask = FindWork(state);
+        if (pTask != nullptr)
+        {
+            Execute(pTask);
+            idleCount = 0;
+            epoch = m_workEpoch.load();
+            continue;
+        }
+
+        if (++idleCount < kIdleSpinCount)
+        {
+            YieldProcessor();
+            continue;
+        }
+
+        //
+        // Park.
+        // We register as a sleeper *before* checking the epoch, while NotifyWork bumps
+        // the epoch *before* checking for sleepers (all seq_cst): so either we see the new
+        // epoch and don't sleep, or NotifyWork sees us and wakes us up (it needs the mutex
+        // we hold until we actually wait).
+        //
+        std::unique_lock<std::mutex> lock(m_parkMutex);
+        m_sleeperCount.fetch_add(1);
+        if (!m_bStop.load() && m_workEpoch.load() == epoch)
+        {
+            CTimelineScope timelineScope("parked");
+            m_parkCondition.wait(lock);
+        }
+        m_sleeperCount.fetch_sub(1);
+
+        idleCount = 0;
+        epoch = m_workEpoch.load();
+    }
+}
@@ -0,0 +1,240 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Thread Pool Benchmark
+//
+// 1. Scheduling overhead of CWorkStealingThreadPool::ParallelFor vs. one std::thread
+//    per chunk vs. one std::async per chunk, with (almost) empty chunks.
+//
+// 2. Parallel creation, sort and lookup phases for STL strings and pooled strings,
+//    all driven by the work-stealing pool.
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::binary_search
+#include <atomic>       // std::atomic
+#include <future>       // std::async
+#include <iostream>     // std::cout
+#include <memory>       // std::unique_ptr
+#include <string>       // std::wstring
+#include <thread>       // std::thread
+#include <vector>       // std::vector
+
+#include <windows.h>    // Windows SDK API
+
+#include "StringPool.h"         // Custom string pool allocator
+#include "ThreadPool.h"         // Work-stealing thread pool
+#include "BenchmarkCommon.h"    // Common benchmark helpers
+#include "BenchmarkEnvironment.h"   // Thread pinning
+#include "Benchmarks.h"         // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+using std::wstring;
+
+
+namespace
+{
+
+// Tiny amount of work per chunk, so that the measurement is dominated by scheduling
+void TouchChunk(std::atomic<unsigned long long>& sink, size_t chunk)
+{
+    sink.fetch_add(chunk, std::memory_order_relaxed);
+}
+
+void PrintOverhead(const char* name, long long start, long long finish, int iterations)
+{
+    cout << name << ": "
+         << (finish - start) * 1000000.0 / PerfFrequency() / iterations << " us per parallel region\n";
+}
+
+
+//---------------------------------------------------------------------------------------
+// Scheduling overhead
+//---------------------------------------------------------------------------------------
+void MeasureSchedulingOverhead(CWorkStealingThreadPool& threadPool, size_t chunkCount, int iterations)
+{
+    cout << "--- " << chunkCount << " chunks, " << iterations << " iterations ---\n";
+
+    std::atomic<unsigned long long> sink(0);
+    long long start = 0;
+    long long finish = 0;
+
+    start = PerfCounter();
+    for (int i = 0; i < iterations; ++i)
+    {
+        threadPool.ParallelFor(0, chunkCount, 1, [&](size_t first, size_t last)
+        {
+            for (size_t chunk = first; chunk < last; ++chunk)
+            {
+                TouchChunk(sink, chunk);
+            }
+        });
+    }
+    finish = PerfCounter();
+    PrintOverhead("Work-stealing pool", start, finish, iterations);
+
+    start = PerfCounter();
+    for (int i = 0; i < iterations; ++i)
+    {
+        vector<std::thread> threads;
+        threads.reserve(chunkCount);
+        for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+        {
+            threads.emplace_back([&sink, chunk] { TouchChunk(sink, chunk); });
+        }
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+    }
+    finish = PerfCounter();
+    PrintOverhead("std::thread per chunk", start, finish, iterations);
+
+    start = PerfCounter();
+    for (int i = 0; i < iterations; ++i)
+    {
+        vector<std::future<void>> futures;
+        futures.reserve(chunkCount);
+        for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+        {
+            futures.push_back(std::async(std::launch::async, [&sink, chunk] { TouchChunk(sink, chunk); }));
+        }
+        for (auto& f : futures)
+        {
+            f.get();
+        }
+    }
+    finish = PerfCounter();
+    PrintOverhead("std::async per chunk", start, finish, iterations);
+}
+
+
+//---------------------------------------------------------------------------------------
+// Parallel phases driven by the pool
+//---------------------------------------------------------------------------------------
+bool RunParallelPhases(CWorkStealingThreadPool& threadPool)
+{
+    const auto shuffled = BuildShuffledStrings();
+    const auto shuffled_ptrs = BuildStringPointers(shuffled);
+    const size_t count = shuffled_ptrs.size();
+
+    constexpr size_t kGrainSize = 4096;
+
+    long long start = 0;
+    long long finish = 0;
+
+    cout << "=== Parallel Creation === \n";
+
+    start = PerfCounter();
+    vector<wstring> stl(count);
+    threadPool.ParallelFor(0, count, kGrainSize, [&](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; ++i)
+        {
+            stl[i] = shuffled_ptrs[i];
+        }
+    });
+    finish = PerfCounter();
+    PrintTime(start, finish, "STL");
+
+    // One string pool per thread: no synchronization on the allocation path
+    vector<std::unique_ptr<CStringPoolAllocator>> stringPools;
+    for (unsigned i = 0; i < threadPool.GetThreadCount(); ++i)
+    {
+        stringPools.emplace_back(new CStringPoolAllocator());
+    }
+
+    start = PerfCounter();
+    vector<const wchar_t*> pool(count);
+    threadPool.ParallelFor(0, count, kGrainSize, [&](size_t first, size_t last)
+    {
+        CStringPoolAllocator& stringPool = *stringPools[CWorkStealingThreadPool::GetCurrentThreadIndex()];
+        for (size_t i = first; i < last; ++i)
+        {
+            pool[i] = stringPool.AllocString(shuffled_ptrs[i]);
+        }
+    });
+    finish = PerfCounter();
+    PrintTime(start, finish, "POL");
+
+    cout << "\n=== Parallel Sorting === \n";
+
+    start = PerfCounter();
+    ParallelSort(threadPool, stl.begin(), stl.end(),
+        [](const wstring& s1, const wstring& s2) { return wcscmp(s1.c_str(), s2.c_str()) < 0; });
+    finish = PerfCounter();
+    PrintTime(start, finish, "STL");
+
+    start = PerfCounter();
+    ParallelSort(threadPool, pool.begin(), pool.end(),
+        [](const wchar_t* psz1, const wchar_t* psz2) { return wcscmp(psz1, psz2) < 0; });
+    finish = PerfCounter();
+    PrintTime(start, finish, "POL");
+
+    cout << "\n=== Parallel Lookup === \n";
+
+    std::atomic<size_t> found(0);
+
+    start = PerfCounter();
+    threadPool.ParallelFor(0, count, kGrainSize, [&](size_t first, size_t last)
+    {
+        size_t localFound = 0;
+        for (size_t i = first; i < last; ++i)
+        {
+            if (std::binary_search(stl.begin(), stl.end(), shuffled[i],
+                    [](const wstring& s1, const wstring& s2) { return wcscmp(s1.c_str(), s2.c_str()) < 0; }))
+            {
+                ++localFound;
+            }
+        }
+        found += localFound;
+    });
+    finish = PerfCounter();
+    PrintTime(start, finish, "STL");
+
+    start = PerfCounter();
+    threadPool.ParallelFor(0, count, kGrainSize, [&](size_t first, size_t last)
+    {
+        size_t localFound = 0;
+        for (size_t i = first; i < last; ++i)
+        {
+            if (std::binary_search(pool.begin(), pool.end(), shuffled_ptrs[i],
+                    [](const wchar_t* psz1, const wchar_t* psz2) { return wcscmp(psz1, psz2) < 0; }))
+            {
+                ++localFound;
+            }
+        }
+        found += localFound;
+    });
+    finish = PerfCounter();
+    PrintTime(start, finish, "POL");
+
+    // Every shuffled string is in both sorted copies
+    if (found != 2 * count)
+    {
+        cout << "Lookup results mismatch!\n";
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+
+int RunThreadPoolBenchmark(const CCommandLine& cmdLine)
+{
+    // Pool workers are benchmark threads #1.., pinned with /pin
+    const unsigned requestedThreads = static_cast<unsigned>(cmdLine.GetNumber(L"/threads", 0));
+    CWorkStealingThreadPool threadPool(requestedThreads != 0 ? requestedThreads : GetDefaultThreadCount(),
+                                       PinBenchmarkThread);
+    const size_t threadCount = threadPool.GetThreadCount();
+
+    cout << "=== Scheduling Overhead (" << threadCount << " threads) === \n";
+    MeasureSchedulingOverhead(threadPool, threadCount, 200);
+    MeasureSchedulingOverhead(threadPool, threadCount * 16, 50);
+    cout << '\n';
+
+    return RunParallelPhases(threadPool) ? 0 : 1;
+}
@@ -0,0 +1,432 @@
+#pragma once
+
+/////////////////////////////////////////////////////////////////////////////////////////
+// Timeline Trace: phases, pool slow-path events and thread activity, recorded into
+// per-thread buffers and written as Chrome trace-event JSON (chrome://tracing, Perfetto)
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <atomic>       // std::atomic
+#include <new>          // std::nothrow
+#include <stdexcept>    // std::runtime_error
+#include <string>       // std::string, std::to_string
+
+#include <stdio.h>      // snprintf
+
+#include <atlbase.h>    // CHandle
+
+#include <Windows.h>    // Windows Platform SDK
+
+
+//---------------------------------------------------------------------------------------
+// Timeline Tracer
+//
+// Disabled (the default), recording an event costs a relaxed load and a branch, and no
+// memory is allocated. Once enabled, each thread appends its events to a buffer of its
+// own, allocated at its first event and linked to the others with a compare-and-swap:
+// recording takes no lock. Events beyond the capacity of a buffer are dropped (and
+// counted).
+//
+// Write() must be called once the traced threads are done (e.g. at exit): it reads all
+// the buffers.
+//
+// Complete events (a name, a start and a finish, in performance counter ticks) cover
+// phases and slow operations; instant events mark points in time.
+//---------------------------------------------------------------------------------------
+class CTimelineTracer
+{
+public:
+    CTimelineTracer() noexcept;
+
+    // Free the thread buffers
+    ~CTimelineTracer() noexcept;
+
+    // Start recording; timestamps are relative to the first Enable call
+    void Enable() noexcept;
+
+    bool IsEnabled() const noexcept;
+
+    // Record an event of the calling thread, if enabled; name is copied (and truncated to
+    // kcchMaxName - 1 chars). argName, if not nullptr, must be a string literal: it names
+    // the argument value shown with the event.
+    void RecordComplete(const char* name, long long start, long long finish,
+                        const char* argName = nullptr, unsigned long long argValue = 0) noexcept;
+    void RecordInstant(const char* name) noexcept;
+
+    // Name the calling thread on the timeline, if enabled
+    void SetThreadName(const char* name) noexcept;
+
+    // Number of events dropped because a thread buffer was full
+    unsigned long long GetDroppedCount() const noexcept;
+
+    // Write the events recorded so far as Chrome trace-event JSON.
+    // Throw std::runtime_error on failure.
+    void Write(const wchar_t* path) const;
+
+
+    //
+    // Ban Copy
+    //
+private:
+    CTimelineTracer(const CTimelineTracer&) = delete;
+    CTimelineTracer& operator=(const CTimelineTracer&) = delete;
+
+
+    //
+    // IMPLEMENTATION
+    //
+private:
+    enum
+    {
+        kcchMaxName      = 40,
+        kEventsPerThread = 64 * 1024
+    };
+
+    struct Event
+    {
+        char                name[kcchMaxName];
+        long long           start;
+        long long           finish;     // == start for instant events
+        const char*         argName;
+        unsigned long long  argValue;
+        bool                bInstant;
+    };
+
+    struct ThreadBuffer
+    {
+        ThreadBuffer*       pNext;
+        DWORD               threadId;
+        char                threadName[kcchMaxName];
+
+        // Written by the owner thread only
+        std::atomic<size_t> count;
+        size_t              droppedCount;
+        Event               events[kEventsPerThread];
+    };
+
+    std::atomic<bool>           m_bEnabled;
+    std::atomic<ThreadBuffer*>  m_pFirstBuffer;
+    long long                   m_origin;       // Performance counter at Enable()
+
+    // Append an event to the calling thread's buffer
+    void Record(const char* name, long long start, long long finish,
+                const char* argName, unsigned long long argValue, bool bInstant) noexcept;
+
+    // The calling thread's buffer, allocated and linked at its first call;
+    // nullptr if out of memory
+    ThreadBuffer* GetThreadBuffer() noexcept;
+
+    static void CopyName(char* pszDest, const char* pszSource) noexcept;
+    static void AppendJsonString(std::string& json, const char* psz);
+};
+
+
+//---------------------------------------------------------------------------------------
+// The tracer of the benchmark process
+//---------------------------------------------------------------------------------------
+inline CTimelineTracer& GetTimelineTracer() noexcept
+{
+    static CTimelineTracer s_tracer;
+    return s_tracer;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Timeline Scope: records a complete event from construction to destruction, if the
+// timeline tracer is enabled (name and argName must outlive the scope)
+//---------------------------------------------------------------------------------------
+class CTimelineScope
+{
+public:
+    explicit CTimelineScope(const char* name, const char* argName = nullptr,
+                            unsigned long long argValue = 0) noexcept;
+    ~CTimelineScope() noexcept;
+
+
+    //
+    // Ban Copy
+    //
+private:
+    CTimelineScope(const CTimelineScope&) = delete;
+    CTimelineScope& operator=(const CTimelineScope&) = delete;
+
+
+    //
+    // IMPLEMENTATION
+    //
+private:
+    const char*         m_name;
+    const char*         m_argName;
+    unsigned long long  m_argValue;
+    long long           m_start;    // 0 if the tracer is disabled
+};
+
+
+//=======================================================================================
+//                          Inline Method Implementations
+//=======================================================================================
+
+inline CTimelineTracer::CTimelineTracer() noexcept
+    : m_bEnabled(false)
+    , m_pFirstBuffer(nullptr)
+    , m_origin(0)
+{
+}
+
+
+inline CTimelineTracer::~CTimelineTracer() noexcept
+{
+    ThreadBuffer* pBuffer = m_pFirstBuffer.load();
+    while (pBuffer != nullptr)
+    {
+        ThreadBuffer* const pNext = pBuffer->pNext;
+        delete pBuffer;
+        pBuffer = pNext;
+    }
+}
+
+
+inline void CTimelineTracer::Enable() noexcept
+{
+    if (!m_bEnabled.load())
+    {
+        LARGE_INTEGER li;
+        QueryPerformanceCounter(&li);
+        m_origin = li.QuadPart;
+        m_bEnabled.store(true);
+    }
+}
+
+
+inline bool CTimelineTracer::IsEnabled() const noexcept
+{
+    return m_bEnabled.load(std::memory_order_relaxed);
+}
+
+
+inline void CTimelineTracer::RecordComplete(const char* name, long long start, long long finish,
+                                            const char* argName, unsigned long long argValue) noexcept
+{
+    if (IsEnabled())
+    {
+        Record(name, start, finish, argName, argValue, false);
+    }
+}
+
+
+inline void CTimelineTracer::RecordInstant(const char* name) noexcept
+{
+    if (IsEnabled())
+    {
+        LARGE_INTEGER li;
+        QueryPerformanceCounter(&li);
+        Record(name, li.QuadPart, li.QuadPart, nullptr, 0, true);
+    }
+}
+
+
+inline void CTimelineTracer::Record(const char* name, long long start, long long finish,
+                                    const char* argName, unsigned long long argValue, bool bInstant) noexcept
+{
+    ThreadBuffer* const pBuffer = GetThreadBuffer();
+    if (pBuffer == nullptr)
+    {
+        return;
+    }
+
+    const size_t index = pBuffer->count.load(std::memory_order_relaxed);
+    if (index == kEventsPerThread)
+    {
+        ++pBuffer->droppedCount;
+        return;
+    }
+
+    Event& event = pBuffer->events[index];
+    CopyName(event.name, name);
+    event.start    = start;
+    event.finish   = finish;
+    event.argName  = argName;
+    event.argValue = argValue;
+    event.bInstant = bInstant;
+
+    // Publish the event
+    pBuffer->count.store(index + 1, std::memory_order_release);
+}
+
+
+inline void CTimelineTracer::SetThreadName(const char* name) noexcept
+{
+    if (!IsEnabled())
+    {
+        return;
+    }
+
+    ThreadBuffer* const pBuffer = GetThreadBuffer();
+    if (pBuffer != nullptr)
+    {
+        CopyName(pBuffer->threadName, name);
+    }
+}
+
+
+inline unsigned long long CTimelineTracer::GetDroppedCount() const noexcept
+{
+    unsigned long long droppedCount = 0;
+    for (const ThreadBuffer* pBuffer = m_pFirstBuffer.load(); pBuffer != nullptr; pBuffer = pBuffer->pNext)
+    {
+        droppedCount += pBuffer->droppedCount;
+    }
+    return droppedCount;
+}
+
+
+inline void CTimelineTracer::Write(const wchar_t* path) const
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    const double usPerTick = 1e6 / frequency.QuadPart;
+    const std::string pid = std::to_string(GetCurrentProcessId());
+
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool bFirst = true;
+    char number[64];
+
+    for (const ThreadBuffer* pBuffer = m_pFirstBuffer.load(); pBuffer != nullptr; pBuffer = pBuffer->pNext)
+    {
+        const std::string tid = std::to_string(pBuffer->threadId);
+
+        if (pBuffer->threadName[0] != '\0')
+        {
+            json += bFirst ? "" : ",\n";
+            json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + tid + ",\"args\":{\"name\":";
+            AppendJsonString(json, pBuffer->threadName);
+            json += "}}";
+            bFirst = false;
+        }
+
+        const size_t count = pBuffer->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Event& event = pBuffer->events[i];
+
+            json += bFirst ? "" : ",\n";
+            json += "{\"name\":";
+            AppendJsonString(json, event.name);
+            json += event.bInstant ? ",\"ph\":\"i\",\"s\":\"t\"" : ",\"ph\":\"X\"";
+            snprintf(number, sizeof(number), ",\"ts\":%.3f", (event.start - m_origin) * usPerTick);
+            json += number;
+            if (!event.bInstant)
+            {
+                snprintf(number, sizeof(number), ",\"dur\":%.3f", (event.finish - event.start) * usPerTick);
+                json += number;
+            }
+            json += ",\"pid\":" + pid + ",\"tid\":" + tid;
+            if (event.argName != nullptr)
+            {
+                json += ",\"args\":{";
+                AppendJsonString(json, event.argName);
+                json += ":" + std::to_string(event.argValue) + "}";
+            }
+            json += "}";
+            bFirst = false;
+        }
+    }
+    json += "\n]}\n";
+
+    ATL::CHandle file(CreateFileW(path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        file.Detach();
+        throw std::runtime_error("Can't create the timeline trace file.");
+    }
+
+    DWORD cbWritten = 0;
+    if (!WriteFile(file, json.data(), static_cast<DWORD>(json.size()), &cbWritten, nullptr)
+        || cbWritten != json.size())
+    {
+        throw std::runtime_error("Can't write the timeline trace file.");
+    }
+}
+
+
+inline CTimelineTracer::ThreadBuffer* CTimelineTracer::GetThreadBuffer() noexcept
+{
+    // There is a single tracer per process, so one pointer per thread is enough
+    static thread_local ThreadBuffer* t_pBuffer = nullptr;
+    if (t_pBuffer != nullptr)
+    {
+        return t_pBuffer;
+    }
+
+    ThreadBuffer* const pBuffer = new (std::nothrow) ThreadBuffer;
+    if (pBuffer == nullptr)
+    {
+        return nullptr;
+    }
+    pBuffer->threadId      = GetCurrentThreadId();
+    pBuffer->threadName[0] = '\0';
+    pBuffer->count.store(0);
+    pBuffer->droppedCount  = 0;
+
+    // Push the buffer on the list
+    pBuffer->pNext = m_pFirstBuffer.load();
+    while (!m_pFirstBuffer.compare_exchange_weak(pBuffer->pNext, pBuffer))
+    {
+    }
+
+    t_pBuffer = pBuffer;
+    return pBuffer;
+}
+
+
+inline void CTimelineTracer::CopyName(char* pszDest, const char* pszSource) noexcept
+{
+    size_t i = 0;
+    for (; i < kcchMaxName - 1 && pszSource[i] != '\0'; ++i)
+    {
+        pszDest[i] = pszSource[i];
+    }
+    pszDest[i] = '\0';
+}
+
+
+inline void CTimelineTracer::AppendJsonString(std::string& json, const char* psz)
+{
+    json += '"';
+    for (; *psz != '\0'; ++psz)
+    {
+        if (*psz == '"' || *psz == '\\')
+        {
+            json += '\\';
+        }
+        json += (static_cast<unsigned char>(*psz) < 0x20) ? ' ' : *psz;
+    }
+    json += '"';
+}
+
+
+inline CTimelineScope::CTimelineScope(const char* name, const char* argName,
+                                      unsigned long long argValue) noexcept
+    : m_name(name)
+    , m_argName(argName)
+    , m_argValue(argValue)
+    , m_start(0)
+{
+    if (GetTimelineTracer().IsEnabled())
+    {
+        LARGE_INTEGER li;
+        QueryPerformanceCounter(&li);
+        m_start = li.QuadPart;
+    }
+}
+
+
+inline CTimelineScope::~CTimelineScope() noexcept
+{
+    if (m_start != 0)
+    {
+        LARGE_INTEGER li;
+        QueryPerformanceCounter(&li);
+        GetTimelineTracer().RecordComplete(m_name, m_start, li.QuadPart, m_argName, m_argValue);
+    }
+}
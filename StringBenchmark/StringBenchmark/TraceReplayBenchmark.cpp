@@ -0,0 +1,413 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Allocation Trace Replay Benchmark
+//
+// Replays an allocation trace (see AllocationTrace.h) against the ATL, STL and POL
+// contenders. The trace is loaded from a file (/trace:path), or generated synthetically;
+// the records of each trace thread are replayed in order on a thread of their own.
+//
+// Each lifetime of the trace maps to:
+//
+//  - ATL: a std::vector<CStringW>
+//  - STL: a std::vector<std::wstring>
+//  - POL: a CStringPoolAllocator (plus the vector of its string pointers), destroyed
+//         when the lifetime is released -- or Reset, and reused for the next lifetime
+//         replayed in the same slot
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::min
+#include <climits>      // INT_MAX
+#include <iostream>     // std::cout
+#include <memory>       // std::unique_ptr
+#include <string>       // std::wstring
+#include <thread>       // std::thread
+#include <unordered_map>    // std::unordered_map
+#include <vector>       // std::vector
+
+#include <wchar.h>      // wcslen
+
+#include <atlstr.h>     // CString
+
+#include <windows.h>    // Windows SDK API
+
+#include "StringPool.h"         // Custom string pool allocator
+#include "AllocationTrace.h"    // Allocation trace format
+#include "BenchmarkCommon.h"    // Common benchmark helpers
+#include "BenchmarkEnvironment.h"   // Thread pinning
+#include "Benchmarks.h"         // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+using std::wstring;
+
+
+namespace
+{
+
+#ifdef _DEBUG
+constexpr unsigned long long kDefaultLifetimesPerThread = 100;
+#else
+constexpr unsigned long long kDefaultLifetimesPerThread = 100 * 1000;   // 100K
+#endif // _DEBUG
+
+
+//---------------------------------------------------------------------------------------
+// Replay program: the trace records of one thread, with the lifetime ids mapped to dense
+// slots (reused after release), so that replaying needs no hash lookups.
+//---------------------------------------------------------------------------------------
+
+struct ReplayOp
+{
+    UINT32  slot;
+    UINT32  cch;
+    UINT32  textOffset;     // Alloc: where the string contents are taken from
+    TraceOp op;
+};
+
+struct ReplayProgram
+{
+    vector<ReplayOp>    ops;
+    size_t              slotCount;
+};
+
+vector<ReplayProgram> CompileTrace(const vector<TraceRecord>& records, size_t cchText, size_t cchMaxString)
+{
+    vector<ReplayProgram> programs;
+    vector<std::unordered_map<UINT32, UINT32>> liveSlots;  // Per thread: lifetime id -> slot
+    vector<vector<UINT32>> freeSlots;                       // Per thread
+
+    size_t index = 0;
+    for (const TraceRecord& record : records)
+    {
+        if (record.thread >= programs.size())
+        {
+            programs.resize(record.thread + 1, ReplayProgram{ {}, 0 });
+            liveSlots.resize(record.thread + 1);
+            freeSlots.resize(record.thread + 1);
+        }
+
+        ReplayProgram& program = programs[record.thread];
+        auto& live = liveSlots[record.thread];
+        auto& freeList = freeSlots[record.thread];
+
+        ReplayOp op = {};
+        op.op = static_cast<TraceOp>(record.op);
+
+        auto it = live.find(record.lifetimeId);
+        if (op.op == TraceOp::Alloc)
+        {
+            if (it == live.end())
+            {
+                UINT32 slot = static_cast<UINT32>(program.slotCount);
+                if (!freeList.empty())
+                {
+                    slot = freeList.back();
+                    freeList.pop_back();
+                }
+                else
+                {
+                    ++program.slotCount;
+                }
+                it = live.emplace(record.lifetimeId, slot).first;
+            }
+
+            op.slot       = it->second;
+            op.cch        = static_cast<UINT32>((std::min)(static_cast<size_t>(record.cch), cchMaxString));
+            op.textOffset = static_cast<UINT32>((index * 7919) % (cchText - op.cch));
+        }
+        else
+        {
+            // Lifetimes with no allocations (e.g. unused pools) have nothing to release
+            if (it == live.end())
+            {
+                continue;
+            }
+
+            op.slot = it->second;
+            freeList.push_back(it->second);
+            live.erase(it);
+        }
+
+        program.ops.push_back(op);
+        ++index;
+    }
+
+    return programs;
+}
+
+
+//---------------------------------------------------------------------------------------
+// Contenders: Alloc() adds a string to a slot, Release() frees all the strings of a slot
+// and returns the sum of their lengths (reading them, as a checksum)
+//---------------------------------------------------------------------------------------
+
+class CAtlReplay
+{
+public:
+    CAtlReplay(size_t slotCount, SIZE_T /* cbChunkSize */)
+        : m_slots(slotCount)
+    {
+    }
+
+    void Alloc(UINT32 slot, const wchar_t* pch, UINT32 cch)
+    {
+        // CString lengths are ints: CompileTrace caps cch at cchMaxString (64K)
+        _ASSERTE(cch <= INT_MAX);
+        m_slots[slot].emplace_back(pch, static_cast<int>(cch));
+    }
+
+    unsigned long long Release(UINT32 slot)
+    {
+        unsigned long long checksum = 0;
+        for (const auto& s : m_slots[slot])
+        {
+            checksum += wcslen(s.GetString());
+        }
+        m_slots[slot].clear();
+        return checksum;
+    }
+
+private:
+    vector<vector<ATL::CStringW>> m_slots;
+};
+
+class CStlReplay
+{
+public:
+    CStlReplay(size_t slotCount, SIZE_T /* cbChunkSize */)
+        : m_slots(slotCount)
+    {
+    }
+
+    void Alloc(UINT32 slot, const wchar_t* pch, UINT32 cch)
+    {
+        m_slots[slot].emplace_back(pch, cch);
+    }
+
+    unsigned long long Release(UINT32 slot)
+    {
+        unsigned long long checksum = 0;
+        for (const auto& s : m_slots[slot])
+        {
+            checksum += wcslen(s.c_str());
+        }
+        m_slots[slot].clear();
+        return checksum;
+    }
+
+private:
+    vector<vector<wstring>> m_slots;
+};
+
+class CPoolReplay
+{
+public:
+    CPoolReplay(size_t slotCount, SIZE_T cbChunkSize, bool bReusePools = false)
+        : m_slots(slotCount)
+        , m_cbChunkSize(cbChunkSize)
+        , m_bReusePools(bReusePools)
+    {
+    }
+
+    void Alloc(UINT32 slot, const wchar_t* pch, UINT32 cch)
+    {
+        Lifetime& lifetime = m_slots[slot];
+        if (!lifetime.pool)
+        {
+            lifetime.pool.reset(new CStringPoolAllocator(m_cbChunkSize));
+        }
+        lifetime.strings.push_back(lifetime.pool->AllocString(pch, pch + cch));
+    }
+
+    unsigned long long Release(UINT32 slot)
+    {
+        Lifetime& lifetime = m_slots[slot];
+        unsigned long long checksum = 0;
+        for (const wchar_t* psz : lifetime.strings)
+        {
+            checksum += wcslen(psz);
+        }
+        lifetime.strings.clear();
+
+        // The next lifetime in this slot either reuses the pool, or gets a new one
+        if (m_bReusePools && lifetime.pool)
+        {
+            lifetime.pool->Reset();
+        }
+        else
+        {
+            lifetime.pool.reset();
+        }
+        return checksum;
+    }
+
+private:
+    struct Lifetime
+    {
+        std::unique_ptr<CStringPoolAllocator>   pool;
+        vector<const wchar_t*>                  strings;
+    };
+
+    vector<Lifetime>    m_slots;
+    SIZE_T              m_cbChunkSize;
+    bool                m_bReusePools;
+};
+
+class CReusedPoolReplay : public CPoolReplay
+{
+public:
+    CReusedPoolReplay(size_t slotCount, SIZE_T cbChunkSize)
+        : CPoolReplay(slotCount, cbChunkSize, true)
+    {
+    }
+};
+
+
+//---------------------------------------------------------------------------------------
+// Replay all the programs, each on its own thread, and print the throughput.
+// Return the checksum of all the released strings.
+//---------------------------------------------------------------------------------------
+template <typename Contender>
+unsigned long long Replay(const char* name, const vector<ReplayProgram>& programs,
+                          const wstring& text, SIZE_T cbChunkSize)
+{
+    vector<unsigned long long> checksums(programs.size());
+    vector<std::thread> threads;
+    size_t opCount = 0;
+
+    const long long start = PerfCounter();
+
+    for (size_t t = 0; t < programs.size(); ++t)
+    {
+        opCount += programs[t].ops.size();
+        threads.emplace_back([&, t]
+        {
+            // The main thread just waits for the replay threads
+            PinBenchmarkThread(static_cast<unsigned>(t));
+
+            const ReplayProgram& program = programs[t];
+            Contender contender(program.slotCount, cbChunkSize);
+            unsigned long long checksum = 0;
+
+            for (const ReplayOp& op : program.ops)
+            {
+                if (op.op == TraceOp::Alloc)
+                {
+                    contender.Alloc(op.slot, text.c_str() + op.textOffset, op.cch);
+                }
+                else
+                {
+                    checksum += contender.Release(op.slot);
+                }
+            }
+
+            // Lifetimes never released in the trace end with it
+            for (size_t slot = 0; slot < program.slotCount; ++slot)
+            {
+                checksum += contender.Release(static_cast<UINT32>(slot));
+            }
+
+            checksums[t] = checksum;
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    const long long finish = PerfCounter();
+    const double seconds = static_cast<double>(finish - start) / PerfFrequency();
+    cout << name << ": " << seconds * 1000.0 << " ms, " << opCount / seconds / 1e6 << " M ops/s\n";
+
+    unsigned long long checksum = 0;
+    for (unsigned long long c : checksums)
+    {
+        checksum += c;
+    }
+    return checksum;
+}
+
+} // namespace
+
+
+int RunTraceReplayBenchmark(const CCommandLine& cmdLine)
+{
+    const SIZE_T cbChunkSize = static_cast<SIZE_T>(cmdLine.GetNumber(L"/chunk", 32000));
+    if (cbChunkSize < 32000)
+    {
+        cout << "/chunk must be at least 32000 bytes.\n";
+        return 1;
+    }
+
+    vector<TraceRecord> records;
+    const wchar_t* const tracePath = cmdLine.Find(L"/trace");
+    if (tracePath != nullptr && *tracePath != L'\0')
+    {
+        records = LoadAllocationTrace(tracePath);
+        cout << "=== Allocation Trace Replay (" << records.size() << " records from file) === \n";
+    }
+    else
+    {
+        const unsigned threadCount = static_cast<unsigned>(cmdLine.GetNumber(L"/trace-threads", 4));
+        const unsigned lifetimes = static_cast<unsigned>(cmdLine.GetNumber(L"/lifetimes", kDefaultLifetimesPerThread));
+        const unsigned seed = static_cast<unsigned>(cmdLine.GetNumber(L"/seed", 1987));
+        if (threadCount == 0 || threadCount > kMaxTraceThreads)
+        {
+            cout << "/trace-threads must be in [1, 65535].\n";
+            return 1;
+        }
+
+        records = GenerateSyntheticTrace(threadCount, lifetimes, seed);
+        cout << "=== Allocation Trace Replay (" << records.size() << " synthetic records, "
+             << threadCount << " threads) === \n";
+
+        // Keep the synthetic trace, e.g. to replay it with another build
+        const wchar_t* const savePath = cmdLine.Find(L"/save-trace");
+        if (savePath != nullptr && *savePath != L'\0')
+        {
+            SaveAllocationTrace(savePath, records);
+        }
+    }
+
+    return ReplayAllocationTrace(records, cbChunkSize);
+}
+
+
+int ReplayAllocationTrace(const vector<TraceRecord>& records, SIZE_T cbChunkSize)
+{
+    // The string contents are slices of a long text: only the lengths come from the trace
+    // (longer strings are truncated to kcchMaxString)
+    constexpr size_t kcchMaxString = 64 * 1024;
+    wstring text;
+    for (const auto& s : BuildShuffledStrings())
+    {
+        text += s;
+        if (text.size() > 2 * kcchMaxString)
+        {
+            break;
+        }
+    }
+    while (text.size() <= 2 * kcchMaxString)
+    {
+        text += text;
+    }
+
+    const auto programs = CompileTrace(records, text.size(), kcchMaxString);
+
+    const unsigned long long atlChecksum = Replay<CAtlReplay>("ATL", programs, text, cbChunkSize);
+    const unsigned long long stlChecksum = Replay<CStlReplay>("STL", programs, text, cbChunkSize);
+    const unsigned long long poolChecksum = Replay<CPoolReplay>("POL", programs, text, cbChunkSize);
+    const unsigned long long reuseChecksum = Replay<CReusedPoolReplay>("POL (reset and reuse)", programs, text, cbChunkSize);
+
+    if (atlChecksum != stlChecksum || stlChecksum != poolChecksum || poolChecksum != reuseChecksum)
+    {
+        cout << "Checksum mismatch!\n";
+        return 1;
+    }
+
+    return 0;
+}
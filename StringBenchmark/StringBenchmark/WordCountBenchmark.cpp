@@ -0,0 +1,480 @@
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Word-Frequency Application Benchmark
+//
+// End-to-end workload over a large text corpus:
+//
+//  1. Tokenize the text into words
+//  2. Count the occurrences of each distinct word in a hash map
+//  3. Output the top N words by frequency
+//
+// STL copies each token into a std::wstring and counts them in an
+// std::unordered_map<std::wstring, size_t>. POL keeps zero-copy tokens (pointers into
+// the text) and interns each distinct word in a string pool the first time it is seen.
+//
+// Both run single-threaded, and multi-threaded on the work-stealing pool (the text is
+// split at word boundaries, each part is counted separately, then the counts are merged).
+// Reports the time of each stage and the throughput in MB/s of text.
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <algorithm>    // std::partial_sort, std::min, std::max
+#include <iostream>     // std::cout
+#include <memory>       // std::unique_ptr
+#include <string>       // std::wstring
+#include <unordered_map>    // std::unordered_map
+#include <utility>      // std::pair
+#include <vector>       // std::vector
+
+#include <wchar.h>      // wcscmp, wmemcmp
+
+#include <windows.h>    // Windows SDK API
+
+#include "StringPool.h"         // Custom string pool allocator
+#include "StringHashTable.h"    // HashString
+#include "ThreadPool.h"         // Work-stealing thread pool
+#include "BenchmarkCommon.h"    // Common benchmark helpers
+#include "BenchmarkEnvironment.h"   // Thread pinning
+#include "Benchmarks.h"         // Benchmark entry points
+
+
+using std::cout;
+using std::vector;
+using std::wstring;
+
+
+namespace
+{
+
+#ifdef _DEBUG
+constexpr unsigned long long kDefaultCorpusMB = 1;
+#else
+constexpr unsigned long long kDefaultCorpusMB = 64;
+#endif // _DEBUG
+
+
+inline bool IsWordChar(wchar_t ch) noexcept
+{
+    return (ch >= L'a' && ch <= L'z') || (ch >= L'A' && ch <= L'Z') || (ch >= L'0' && ch <= L'9');
+}
+
+// Call onWord(begin, end) for each word in [pchBegin, pchEnd)
+template <typename OnWord>
+void ForEachWord(const wchar_t* pchBegin, const wchar_t* pchEnd, const OnWord& onWord)
+{
+    const wchar_t* pch = pchBegin;
+    for (;;)
+    {
+        while (pch != pchEnd && !IsWordChar(*pch))
+        {
+            ++pch;
+        }
+        if (pch == pchEnd)
+        {
+            return;
+        }
+
+        const wchar_t* const pchWord = pch;
+        while (pch != pchEnd && IsWordChar(*pch))
+        {
+            ++pch;
+        }
+        onWord(pchWord, pch);
+    }
+}
+
+
+// One line of the output
+struct WordFrequency
+{
+    wstring word;
+    size_t  count;
+
+    bool operator==(const WordFrequency& other) const
+    {
+        return count == other.count && word == other.word;
+    }
+};
+
+// Top-N order: most frequent first, ties in alphabetical order
+template <typename Entry, typename GetWord>
+void SortTop(vector<Entry>& entries, size_t n, const GetWord& getWord)
+{
+    n = (std::min)(n, entries.size());
+    std::partial_sort(entries.begin(), entries.begin() + n, entries.end(),
+        [&](const Entry& e1, const Entry& e2)
+        {
+            if (e1.second != e2.second)
+            {
+                return e1.second > e2.second;
+            }
+            return wcscmp(getWord(e1), getWord(e2)) < 0;
+        });
+    entries.resize(n);
+}
+
+
+//---------------------------------------------------------------------------------------
+// STL: std::wstring tokens, counted in std::unordered_map
+//---------------------------------------------------------------------------------------
+class CStlWordCount
+{
+public:
+    explicit CStlWordCount(size_t partCount)
+        : m_tokens(partCount)
+        , m_counts(partCount)
+    {
+    }
+
+    void Tokenize(size_t part, const wchar_t* pchBegin, const wchar_t* pchEnd)
+    {
+        ForEachWord(pchBegin, pchEnd, [&](const wchar_t* pchWord, const wchar_t* pchWordEnd)
+        {
+            m_tokens[part].emplace_back(pchWord, pchWordEnd);
+        });
+    }
+
+    void Count(size_t part)
+    {
+        auto& counts = m_counts[part];
+        for (const auto& token : m_tokens[part])
+        {
+            ++counts[token];
+        }
+    }
+
+    // Merge the counts of all the parts into the first one
+    void Merge()
+    {
+        for (size_t part = 1; part < m_counts.size(); ++part)
+        {
+            for (const auto& entry : m_counts[part])
+            {
+                m_counts[0][entry.first] += entry.second;
+            }
+        }
+    }
+
+    vector<WordFrequency> Top(size_t n) const
+    {
+        vector<std::pair<const wstring*, size_t>> entries;
+        entries.reserve(m_counts[0].size());
+        for (const auto& entry : m_counts[0])
+        {
+            entries.emplace_back(&entry.first, entry.second);
+        }
+
+        SortTop(entries, n, [](const std::pair<const wstring*, size_t>& e) { return e.first->c_str(); });
+
+        vector<WordFrequency> top;
+        for (const auto& entry : entries)
+        {
+            top.push_back(WordFrequency{ *entry.first, entry.second });
+        }
+        return top;
+    }
+
+private:
+    vector<vector<wstring>>                             m_tokens;   // Per part
+    vector<std::unordered_map<wstring, size_t>>         m_counts;   // Per part
+};
+
+
+//---------------------------------------------------------------------------------------
+// POL: zero-copy tokens, counted in an open-addressing table whose keys are interned in
+// a string pool
+//---------------------------------------------------------------------------------------
+
+// Word counts; each distinct word is copied once, into the pool, when first seen
+class CWordCounter
+{
+public:
+    struct Entry
+    {
+        ULONGLONG   hash;   // 0 for empty slots
+        PCWSTR      psz;    // Interned, NUL-terminated word
+        size_t      cch;
+        size_t      count;
+    };
+
+    explicit CWordCounter(CStringPoolAllocator& stringPool)
+        : m_stringPool(stringPool)
+        , m_slots(1024)
+    {
+    }
+
+    // Count one more occurrence of the [pchBegin, pchEnd) word
+    void Add(const wchar_t* pchBegin, const wchar_t* pchEnd)
+    {
+        const size_t cch = pchEnd - pchBegin;
+        const ULONGLONG hash = HashString(pchBegin, pchEnd);
+        Entry& entry = Find(pchBegin, cch, hash);
+        if (entry.hash != 0)
+        {
+            ++entry.count;
+            return;
+        }
+
+        // New word: intern it (Grow may rehash, so entry must not be used after it)
+        entry = Entry{ hash, m_stringPool.AllocString(pchBegin, pchEnd), cch, 1 };
+        Grow();
+    }
+
+    // Add the counts of another counter; its interned words are referenced, not copied,
+    // so its pool must outlive this counter
+    void Merge(const CWordCounter& other)
+    {
+        for (const Entry& otherEntry : other.m_slots)
+        {
+            if (otherEntry.hash == 0)
+            {
+                continue;
+            }
+
+            Entry& entry = Find(otherEntry.psz, otherEntry.cch, otherEntry.hash);
+            if (entry.hash == 0)
+            {
+                entry = otherEntry;
+                Grow();
+            }
+            else
+            {
+                entry.count += otherEntry.count;
+            }
+        }
+    }
+
+    const vector<Entry>& GetSlots() const noexcept
+    {
+        return m_slots;
+    }
+
+private:
+    CStringPoolAllocator&   m_stringPool;
+    vector<Entry>           m_slots;        // Power-of-two number of slots
+    size_t                  m_count = 0;    // Distinct words
+
+    // Return the slot holding the word, or the empty slot where it belongs
+    Entry& Find(const wchar_t* pch, size_t cch, ULONGLONG hash)
+    {
+        const size_t mask = m_slots.size() - 1;
+        for (size_t i = static_cast<size_t>(hash) & mask; ; i = (i + 1) & mask)
+        {
+            Entry& entry = m_slots[i];
+            if (entry.hash == 0
+                || (entry.hash == hash && entry.cch == cch && wmemcmp(entry.psz, pch, cch) == 0))
+            {
+                return entry;
+            }
+        }
+    }
+
+    // Account for a new word, rehashing when the load factor would exceed 1/2
+    void Grow()
+    {
+        if (++m_count * 2 <= m_slots.size())
+        {
+            return;
+        }
+
+        vector<Entry> oldSlots(m_slots.size() * 2);
+        oldSlots.swap(m_slots);
+        for (const Entry& entry : oldSlots)
+        {
+            if (entry.hash != 0)
+            {
+                Find(entry.psz, entry.cch, entry.hash) = entry;
+            }
+        }
+    }
+};
+
+
+class CPooledWordCount
+{
+public:
+    struct Token
+    {
+        const wchar_t*  pch;    // Points into the text: no copy
+        size_t          cch;
+    };
+
+    explicit CPooledWordCount(size_t partCount)
+        : m_tokens(partCount)
+    {
+        for (size_t part = 0; part < partCount; ++part)
+        {
+            m_pools.emplace_back(new CStringPoolAllocator());
+            m_counters.emplace_back(new CWordCounter(*m_pools.back()));
+        }
+    }
+
+    void Tokenize(size_t part, const wchar_t* pchBegin, const wchar_t* pchEnd)
+    {
+        ForEachWord(pchBegin, pchEnd, [&](const wchar_t* pchWord, const wchar_t* pchWordEnd)
+        {
+            m_tokens[part].push_back(Token{ pchWord, static_cast<size_t>(pchWordEnd - pchWord) });
+        });
+    }
+
+    void Count(size_t part)
+    {
+        CWordCounter& counter = *m_counters[part];
+        for (const Token& token : m_tokens[part])
+        {
+            counter.Add(token.pch, token.pch + token.cch);
+        }
+    }
+
+    // Merge the counts of all the parts into the first one
+    void Merge()
+    {
+        for (size_t part = 1; part < m_counters.size(); ++part)
+        {
+            m_counters[0]->Merge(*m_counters[part]);
+        }
+    }
+
+    vector<WordFrequency> Top(size_t n) const
+    {
+        vector<std::pair<PCWSTR, size_t>> entries;
+        for (const auto& entry : m_counters[0]->GetSlots())
+        {
+            if (entry.hash != 0)
+            {
+                entries.emplace_back(entry.psz, entry.count);
+            }
+        }
+
+        SortTop(entries, n, [](const std::pair<PCWSTR, size_t>& e) { return e.first; });
+
+        vector<WordFrequency> top;
+        for (const auto& entry : entries)
+        {
+            top.push_back(WordFrequency{ entry.first, entry.second });
+        }
+        return top;
+    }
+
+private:
+    vector<vector<Token>>                           m_tokens;   // Per part
+    vector<std::unique_ptr<CStringPoolAllocator>>   m_pools;    // Per part
+    vector<std::unique_ptr<CWordCounter>>           m_counters; // Per part
+};
+
+
+//---------------------------------------------------------------------------------------
+// Run the three stages with one part per thread of the pool, printing the time of each
+//---------------------------------------------------------------------------------------
+template <typename WordCount>
+vector<WordFrequency> RunWordCount(const char* name, CWorkStealingThreadPool& threadPool,
+                                   const wstring& text, size_t topCount)
+{
+    // Split the text at word boundaries
+    const size_t partCount = threadPool.GetThreadCount();
+    vector<const wchar_t*> bounds;
+    bounds.push_back(text.c_str());
+    for (size_t part = 1; part < partCount; ++part)
+    {
+        const wchar_t* pch = text.c_str() + text.size() * part / partCount;
+        while (pch != text.c_str() + text.size() && IsWordChar(*pch))
+        {
+            ++pch;
+        }
+        bounds.push_back((std::max)(pch, bounds.back()));
+    }
+    bounds.push_back(text.c_str() + text.size());
+
+    WordCount wordCount(partCount);
+
+    const long long start = PerfCounter();
+
+    threadPool.ParallelFor(0, partCount, 1, [&](size_t first, size_t last)
+    {
+        for (size_t part = first; part < last; ++part)
+        {
+            wordCount.Tokenize(part, bounds[part], bounds[part + 1]);
+        }
+    });
+    const long long tokenized = PerfCounter();
+
+    threadPool.ParallelFor(0, partCount, 1, [&](size_t first, size_t last)
+    {
+        for (size_t part = first; part < last; ++part)
+        {
+            wordCount.Count(part);
+        }
+    });
+    wordCount.Merge();
+    const long long counted = PerfCounter();
+
+    vector<WordFrequency> top = wordCount.Top(topCount);
+    const long long finish = PerfCounter();
+
+    const double totalMs = (finish - start) * 1000.0 / PerfFrequency();
+    const double mb = text.size() * sizeof(wchar_t) / kMB;
+
+    cout << name << ": tokenize " << (tokenized - start) * 1000.0 / PerfFrequency() << " ms, "
+         << "count " << (counted - tokenized) * 1000.0 / PerfFrequency() << " ms, "
+         << "top-" << topCount << ' ' << (finish - counted) * 1000.0 / PerfFrequency() << " ms; "
+         << "total " << totalMs << " ms, " << mb / (totalMs / 1000.0) << " MB/s\n";
+
+    return top;
+}
+
+} // namespace
+
+
+int RunWordCountBenchmark(const CCommandLine& cmdLine)
+{
+    const size_t corpusMB = static_cast<size_t>(cmdLine.GetNumber(L"/mb", kDefaultCorpusMB));
+    const size_t topCount = static_cast<size_t>(cmdLine.GetNumber(L"/top", 10));
+    CWorkStealingThreadPool singleThread(1);
+    // Pool workers are benchmark threads #1.., pinned with /pin
+    const unsigned requestedThreads = static_cast<unsigned>(cmdLine.GetNumber(L"/threads", 0));
+    CWorkStealingThreadPool threadPool(requestedThreads != 0 ? requestedThreads : GetDefaultThreadCount(),
+                                       PinBenchmarkThread);
+    if (corpusMB == 0 || topCount == 0)
+    {
+        cout << "/mb and /top must be at least 1.\n";
+        return 1;
+    }
+
+    // Corpus: the test strings, one per line, repeated up to the requested size
+    wstring text;
+    {
+        const auto shuffled = BuildShuffledStrings();
+        const size_t cchCorpus = corpusMB * 1024 * 1024 / sizeof(wchar_t);
+        text.reserve(cchCorpus + 1024);
+        for (size_t i = 0; text.size() < cchCorpus; i = (i + 1) % shuffled.size())
+        {
+            text += shuffled[i];
+            text += L'\n';
+        }
+    }
+
+    cout << "=== Word Frequency (" << text.size() * sizeof(wchar_t) / kMB << " MB of text) === \n";
+
+    cout << "--- 1 thread ---\n";
+    const auto stlTop = RunWordCount<CStlWordCount>("STL", singleThread, text, topCount);
+    const auto poolTop = RunWordCount<CPooledWordCount>("POL", singleThread, text, topCount);
+
+    cout << "--- " << threadPool.GetThreadCount() << " threads ---\n";
+    const auto stlParallelTop = RunWordCount<CStlWordCount>("STL", threadPool, text, topCount);
+    const auto poolParallelTop = RunWordCount<CPooledWordCount>("POL", threadPool, text, topCount);
+
+    cout << "\nTop " << topCount << " words:\n";
+    for (const auto& entry : poolTop)
+    {
+        cout << "  " << NarrowAscii(entry.word.c_str()) << ' ' << entry.count << '\n';
+    }
+
+    if (!(stlTop == poolTop && stlTop == stlParallelTop && stlTop == poolParallelTop))
+    {
+        cout << "Top words mismatch!\n";
+        return 1;
+    }
+
+    return 0;
+}